@@ -1,114 +1,117 @@
 
 import React, { useState, useEffect, useRef, useCallback } from 'react';
-import { ConnectionStatus, IMUData } from './types';
+import { ConnectionStatus } from './types';
 import IMUChart from './components/IMUChart';
-
-// WebUSB Vendor Specific Class Constants
-const USB_VENDOR_SPECIFIC_CLASS = 0xFF;
+import CanRxView, { CanRxStat } from './components/CanRxView';
+import TerminalLog from './components/TerminalLog';
+import DiagnosticsPanel from './components/DiagnosticsPanel';
+import CalibrationPanel, { CalibrationState, CalibrationStatus, CALIBRATION_POSES } from './components/CalibrationPanel';
+import { ClockSyncInfo, nowUs } from './services/clockSync';
+import { UsbLink } from './services/usbLink';
+import { LogRing } from './services/logRing';
+import { SensorSource, SENSOR_FREQUENCIES, isGenericSensorSupported } from './services/sensorSource';
+import {
+  ImuHistory, CH_ALPHA, CH_BETA, CH_GAMMA, CH_AX, CH_AY, CH_AZ, CH_RATE_ALPHA, CH_RATE_BETA, CH_RATE_GAMMA,
+} from './services/imuHistory';
+import { DEFAULT_SEND_POLICY, LinkStats, SendPolicy } from './services/usbProtocol';
+
+// Pico IDs: default firmware, and the gs_usb build (candleLight ID)
+const USB_FILTERS = [{ vendorId: 0x2E8A }, { vendorId: 0x1D50, productId: 0x606F }];
+
+// CAN output = USB input rate / ratio, filtered on the Pico
+const DECIMATION_RATIOS = [1, 2, 4, 8, 16];
+
+// USB send queue choices: transfers in flight, and the age after which a
+// sample is dropped rather than sent late (control use wants fresh data)
+const MAX_IN_FLIGHT_CHOICES = [1, 2, 4];
+const LATENCY_BUDGET_CHOICES_MS = [20, 50, 100, 250];
+
+// Calibration captures last about this long at the current transmit rate
+const CALIBRATION_CAPTURE_MS = 2000;
 
 const App: React.FC = () => {
   // State
   const [status, setStatus] = useState<ConnectionStatus>(ConnectionStatus.DISCONNECTED);
-  const [imuDataBuffer, setImuDataBuffer] = useState<IMUData[]>([]);
   const [insight] = useState<string>("USB (Vendor Class)に接続してセンサーを有効にすると、AI解析が始まります。");
   const [isStreaming, setIsStreaming] = useState(false);
   const [isTestMode, setIsTestMode] = useState(false); // Default to OFF
   const [transmissionInterval, setTransmissionInterval] = useState<number>(50); // Default 50ms (20Hz)
   const [error, setError] = useState<string | null>(null);
   const [showGuide, setShowGuide] = useState(false);
+  const [canRxStats, setCanRxStats] = useState<CanRxStat[]>([]);
+  const [clockInfo, setClockInfo] = useState<ClockSyncInfo | null>(null);
+  const [decimation, setDecimation] = useState<number>(1);
+  const [calibState, setCalibState] = useState<CalibrationState | null>(null);
+  const [calibStatus, setCalibStatus] = useState<CalibrationStatus>({ capturing: null, message: '' });
+  const [linkStats, setLinkStats] = useState<LinkStats | null>(null);
+  const [sampleLogging, setSampleLogging] = useState(false);
+  // 0 = deviceorientation/devicemotion events, else Generic Sensor API rate (Hz)
+  const [sensorFrequency, setSensorFrequency] = useState<number>(0);
+  const [sendPolicy, setSendPolicy] = useState<SendPolicy>(DEFAULT_SEND_POLICY);
 
   // System capability checks
   const isWebUSBSupported = 'usb' in navigator;
+  const isSensorApiSupported = isGenericSensorSupported();
 
-  // Refs for WebUSB persistence
-  const deviceRef = useRef<USBDevice | null>(null);
-  const endpointInRef = useRef<number>(0);
-  const endpointOutRef = useRef<number>(0);
-  const interfaceNumberRef = useRef<number>(0);
-  const encoderRef = useRef(new TextEncoder());
-  const bufferRef = useRef<IMUData[]>([]);
-  const isReadingRef = useRef(false);
-  const rxLogRef = useRef<HTMLDivElement>(null);
+  // The USB worker link lives for the whole page
+  const linkRef = useRef<UsbLink | null>(null);
+  const historyRef = useRef(new ImuHistory());
+  // Terminal lines, rendered by TerminalLog at its own pace
+  const logRingRef = useRef(new LogRing());
   const lastTransmitTimeRef = useRef<number>(0);
+  // Pose captures need acceleration including gravity
+  const calibGravityRef = useRef(false);
+
+  const resetDeviceState = () => {
+    calibGravityRef.current = false;
+    setCalibState(null);
+    setCalibStatus({ capturing: null, message: '' });
+    setClockInfo(null);
+    setLinkStats(null);
+    setStatus(ConnectionStatus.DISCONNECTED);
+  };
 
-  // Unified Terminal Logging
-  const addLog = useCallback((type: 'tx' | 'rx', text: string) => {
-    if (rxLogRef.current) {
-      const div = document.createElement('div');
-      div.className = `border-l-2 pl-2 mb-1 flex gap-2 ${type === 'tx' ? 'border-emerald-600 text-emerald-400' : 'border-pink-600 text-pink-400'}`;
-      const time = new Date().toLocaleTimeString('ja-JP', { hour12: false, hour: '2-digit', minute: '2-digit', second: '2-digit' });
-      div.innerHTML = `<span class="opacity-40 text-[10px] w-16">${time}</span><span class="font-bold w-8 uppercase">${type}</span><span class="flex-1">${text}</span>`;
-      rxLogRef.current.prepend(div);
-
-      // Limit to 100 lines
-      if (rxLogRef.current.children.length > 100) {
-        rxLogRef.current.lastElementChild?.remove();
-      }
-    }
-  }, []);
-
-  // Function to initialize WebUSB
-  const initializeWebUSB = async (device: USBDevice) => {
-    try {
-      setStatus(ConnectionStatus.CONNECTING);
-      await device.open();
-
-      if (device.configuration === null) {
-        await device.selectConfiguration(1);
-      }
-
-      const config = device.configuration;
-      let vendorInterface = config?.interfaces.find(i =>
-        i.alternates[0].interfaceClass === USB_VENDOR_SPECIFIC_CLASS
-      );
-
-      if (!vendorInterface && config?.interfaces.length) {
-        vendorInterface = config.interfaces[0];
-      }
-
-      if (!vendorInterface) throw new Error("Vendor Interface not found");
-
-      const ifaceNum = vendorInterface.interfaceNumber;
-      await device.claimInterface(ifaceNum);
-      interfaceNumberRef.current = ifaceNum;
-
-      // Enable DTR (SET_CONTROL_LINE_STATE)
-      await device.controlTransferOut({
-        requestType: 'class',
-        recipient: 'interface',
-        request: 0x22,
-        value: 0x01,
-        index: ifaceNum
-      });
-
-      const endpoints = vendorInterface.alternates[0].endpoints;
-      const inEp = endpoints.find(e => e.direction === 'in');
-      const outEp = endpoints.find(e => e.direction === 'out');
-
-      if (!inEp || !outEp) throw new Error("Endpoints not found");
-
-      endpointInRef.current = inEp.endpointNumber;
-      endpointOutRef.current = outEp.endpointNumber;
-      deviceRef.current = device;
-
-      setStatus(ConnectionStatus.CONNECTED);
-      setError(null);
-      startReading();
-
-      (navigator as any).usb.onconnect = null;
-      (navigator as any).usb.ondisconnect = (event: any) => {
-        if (event.device === device) {
-          disconnectWebUSB();
+  // USB I/O runs in a worker (services/usbWorker.ts), so renders and
+  // terminal updates here cannot delay it. The worker reports status,
+  // batched terminal lines and aggregated stats.
+  useEffect(() => {
+    const link = new UsbLink({
+      onStatus: (linkStatus, message) => {
+        if (linkStatus === 'connected') {
+          setStatus(ConnectionStatus.CONNECTED);
+          setError(null);
+          return;
+        }
+        resetDeviceState();
+        if (linkStatus === 'error') {
+          setError("WebUSB接続エラー: " + message);
+        } else if (message === 'removed') {
           setError("マイコンが取り外されました。");
         }
-      };
+      },
+      onLog: (entries, suppressed) => {
+        for (const e of entries) {
+          if (e.dir === 'rx' && (e.text.startsWith('CAL') || e.text.startsWith('ERR:CAL'))) handleCalibrationLine(e.text);
+          logRingRef.current.push(e.dir, e.text);
+        }
+        logRingRef.current.addSuppressed(suppressed);
+      },
+      onStats: (stats) => {
+        setLinkStats(stats);
+        setCanRxStats(stats.canRx);
+        if (stats.clock.exchanges > 0) setClockInfo(stats.clock);
+      },
+    });
+    linkRef.current = link;
+    return () => {
+      link.terminate();
+      linkRef.current = null;
+    };
+  }, []);
 
-    } catch (err: any) {
-      console.error(err);
-      setError("WebUSB接続エラー: " + err.message);
-      disconnectWebUSB();
-    }
-  };
+  useEffect(() => {
+    linkRef.current?.setSendPolicy(sendPolicy);
+  }, [sendPolicy]);
 
   const connectWebUSB = async () => {
     if (!isWebUSBSupported) {
@@ -116,110 +119,121 @@ const App: React.FC = () => {
       return;
     }
     try {
-      const device = await (navigator as any).usb.requestDevice({ filters: [{ vendorId: 0x2E8A }] });
-      await initializeWebUSB(device);
+      const device = await (navigator as any).usb.requestDevice({ filters: USB_FILTERS });
+      setStatus(ConnectionStatus.CONNECTING);
+      linkRef.current?.open(device);
     } catch (err: any) {
       if (err.name !== 'NotFoundError') setError(`接続エラー: ${err.message}`);
     }
   };
 
-  const disconnectWebUSB = async () => {
-    isReadingRef.current = false;
-    const device = deviceRef.current;
-    if (device && device.opened) {
-      try { await device.close(); } catch (e) { console.warn(e); }
+  const disconnectWebUSB = () => {
+    linkRef.current?.close();
+  };
+
+  // Calibration replies (see "cal" in the Pico README)
+  const handleCalibrationLine = (line: string) => {
+    const f = line.split(',');
+    if (f[0] === 'CAL' && (f[1] === 'flash' || f[1] === 'ram') && f.length >= 9) {
+      const v = f.slice(2, 8).map(Number);
+      setCalibState({ source: f[1] as CalibrationState['source'], bias: v.slice(0, 3), scale: v.slice(3, 6), poses: Number(f[8]) });
+    } else if (f[0] === 'CAL' && f[1] === 'STILL') {
+      setCalibStatus({ capturing: null, message: `Bias ${f.slice(3, 6).join(' / ')} m/s², drift ${f.slice(7, 10).map(d => (Number(d) * 180 / Math.PI).toFixed(3)).join(' / ')} °/s` });
+      sendCommand('cal');
+    } else if (f[0] === 'CAL' && f[1] === 'POSE') {
+      calibGravityRef.current = false;
+      setCalibStatus({ capturing: null, message: `Pose ${Number(f[2]) + 1}: ${f.slice(3, 6).join(' / ')} m/s² (${f[7]} captured)` });
+      sendCommand('cal');
+    } else if (f[0] === 'CAL' && f[1] === 'FIT') {
+      setCalibStatus({ capturing: null, message: `Fit residual ${f[8]} m/s²` });
+      sendCommand('cal');
+    } else if (f[0] === 'ERR:CAL_MOTION' || f[0] === 'ERR:CAL') {
+      calibGravityRef.current = false;
+      setCalibStatus({ capturing: null, message: f[0] === 'ERR:CAL' ? 'Rejected by the Pico (a fit needs six still poses)' : `Moved too much (${f[1]} m/s² RMS), retry` });
     }
-    deviceRef.current = null;
-    setStatus(ConnectionStatus.DISCONNECTED);
   };
 
-  const startReading = async () => {
-    if (isReadingRef.current) return;
-    isReadingRef.current = true;
-    const device = deviceRef.current;
-    const decoder = new TextDecoder();
-
-    while (isReadingRef.current && device && device.opened) {
-      try {
-        const result = await device.transferIn(endpointInRef.current, 64);
-        if (result.status === 'ok' && result.data) {
-          const text = decoder.decode(result.data).trim();
-          if (text) addLog('rx', text);
-        }
-      } catch (error) {
-        if (!isReadingRef.current || !device.opened) break;
-        await new Promise(r => setTimeout(r, 100));
-      }
+  // Text command to the Pico (one line)
+  const sendCommand = (cmd: string) => {
+    linkRef.current?.command(cmd);
+  };
+
+  const changeSampleLogging = (enabled: boolean) => {
+    setSampleLogging(enabled);
+    linkRef.current?.setSampleLogging(enabled);
+  };
+
+  const applyCanRxIds = (ids: number[]) => {
+    sendCommand(['rxids', ...ids.map(id => '0x' + id.toString(16))].join(','));
+  };
+
+  // Decimation ratio on the Pico, re-sent after every (re)connect
+  useEffect(() => {
+    if (status === ConnectionStatus.CONNECTED) sendCommand(`decim,${decimation}`);
+  }, [status, decimation]);
+
+  // Calibration: fetch the stored values after every (re)connect
+  useEffect(() => {
+    if (status === ConnectionStatus.CONNECTED) sendCommand('cal');
+  }, [status]);
+
+  // Enough samples for about CALIBRATION_CAPTURE_MS at the current rate
+  const calibrationSamples = () =>
+    Math.min(200, Math.max(20, Math.round(CALIBRATION_CAPTURE_MS / Math.max(transmissionInterval, 10))));
+
+  const calibrationCommand = (cmd: string) => {
+    if (cmd === 'still') {
+      setCalibStatus({ capturing: 'still', message: 'Capturing, keep the phone still…' });
+      sendCommand(`cal,still,${calibrationSamples()}`);
+    } else {
+      sendCommand(`cal,${cmd}`);
     }
-    isReadingRef.current = false;
+  };
+
+  const calibrationPose = (pose: number) => {
+    calibGravityRef.current = true;
+    setCalibStatus({ capturing: 'pose', message: `Capturing "${CALIBRATION_POSES[pose]}", keep the phone still…` });
+    sendCommand(`cal,pose,${pose},${calibrationSamples()}`);
   };
 
   // Use refs to avoid stale closure issues in event listeners
   const isStreamingRef = useRef(isStreaming);
+  const transmissionIntervalRef = useRef(transmissionInterval);
   const isTestModeRef = useRef(isTestMode);
   const statusRef = useRef(status);
 
   useEffect(() => { isStreamingRef.current = isStreaming; }, [isStreaming]);
   useEffect(() => { isTestModeRef.current = isTestMode; }, [isTestMode]);
   useEffect(() => { statusRef.current = status; }, [status]);
-
-  const updateBuffer = (partialData: Partial<IMUData>) => {
-    const now = Date.now();
-    const last = bufferRef.current[bufferRef.current.length - 1];
-
-    // Helper to merge nested objects while avoiding null/undefined overwrites
-    const merge = (prev: any, next: any) => {
-      const result = { ...prev };
-      if (!next) return result;
-      for (const key in next) {
-        if (next[key] !== null && next[key] !== undefined) {
-          result[key] = next[key];
-        }
-      }
-      return result;
-    };
-
-    let newData: IMUData;
-    if (last && now - last.timestamp < 15) {
-      // Update the current entry if it's very recent, keeping data continuity
-      newData = {
-        timestamp: last.timestamp,
-        orientation: merge(last.orientation, partialData.orientation),
-        acceleration: merge(last.acceleration, partialData.acceleration),
-        rotationRate: merge(last.rotationRate, partialData.rotationRate),
-      };
-      bufferRef.current[bufferRef.current.length - 1] = newData;
+  useEffect(() => { transmissionIntervalRef.current = transmissionInterval; }, [transmissionInterval]);
+
+  // Inputs only update their own channels in history.current. Legacy
+  // events have no common clock, so one that arrives within 15 ms of the
+  // last sample is folded into it; Generic Sensor samples come complete
+  // with a sensor timestamp (performance.now() timebase) and are kept as is.
+  const commitSample = (sensorTimeMs?: number) => {
+    const history = historyRef.current;
+    let now: number;
+    let stampUs: number;
+    if (sensorTimeMs !== undefined) {
+      now = performance.timeOrigin + sensorTimeMs;
+      stampUs = Math.round(sensorTimeMs * 1000);
+      history.push(now);
     } else {
-      // Create a new entry, but base it on the last known state to prevent 0-resets
-      const baseEntry = last || {
-        orientation: { alpha: 0, beta: 0, gamma: 0 },
-        acceleration: { x: 0, y: 0, z: 0 },
-        rotationRate: { alpha: 0, beta: 0, gamma: 0 }
-      };
-
-      newData = {
-        timestamp: now,
-        orientation: merge(baseEntry.orientation, partialData.orientation),
-        acceleration: merge(baseEntry.acceleration, partialData.acceleration),
-        rotationRate: merge(baseEntry.rotationRate, partialData.rotationRate),
-      };
-      bufferRef.current.push(newData);
+      now = Date.now();
+      stampUs = nowUs();
+      if (now - history.lastTime < 15) {
+        history.replaceLast();
+      } else {
+        history.push(now);
+      }
     }
 
-    if (bufferRef.current.length > 50) bufferRef.current.shift();
-
-    // Data Streaming (WebUSB) - Only if connected and interval has passed
-    if (deviceRef.current && deviceRef.current.opened && statusRef.current === ConnectionStatus.CONNECTED) {
-      if (now - lastTransmitTimeRef.current >= transmissionInterval) {
-        lastTransmitTimeRef.current = now;
-        const csv = `${newData.orientation.alpha?.toFixed(2)},${newData.orientation.beta?.toFixed(2)},${newData.orientation.gamma?.toFixed(2)},${newData.acceleration.x?.toFixed(2)},${newData.acceleration.y?.toFixed(2)},${newData.acceleration.z?.toFixed(2)}\n`;
-        const encoded = encoderRef.current.encode(csv);
-        deviceRef.current.transferOut(endpointOutRef.current, encoded)
-          .then(() => {
-            addLog('tx', csv.trim());
-          })
-          .catch(e => console.error("TX Fail", e));
-      }
+    // Data Streaming (USB worker) - Only if connected and interval has passed
+    if (statusRef.current === ConnectionStatus.CONNECTED &&
+        now - lastTransmitTimeRef.current >= transmissionIntervalRef.current) {
+      lastTransmitTimeRef.current = now;
+      linkRef.current?.pushSample(stampUs, history.current);
     }
   };
 
@@ -227,41 +241,52 @@ const App: React.FC = () => {
     if (!isTestModeRef.current && isStreamingRef.current) {
       // Convert degrees to radians as requested
       const toRad = (deg: number | null) => (deg !== null ? (deg * Math.PI) / 180 : 0);
-      updateBuffer({
-        timestamp: Date.now(),
-        orientation: {
-          alpha: toRad(e.alpha),
-          beta: toRad(e.beta),
-          gamma: toRad(e.gamma)
-        }
-      });
+      const c = historyRef.current.current;
+      c[CH_ALPHA] = toRad(e.alpha);
+      c[CH_BETA] = toRad(e.beta);
+      c[CH_GAMMA] = toRad(e.gamma);
+      commitSample();
     }
   }, []);
 
   const handleMotion = useCallback((e: DeviceMotionEvent) => {
     if (!isTestModeRef.current && isStreamingRef.current) {
-      updateBuffer({
-        timestamp: Date.now(),
-        acceleration: { x: e.acceleration?.x || 0, y: e.acceleration?.y || 0, z: e.acceleration?.z || 0 },
-        rotationRate: { alpha: e.rotationRate?.alpha || 0, beta: e.rotationRate?.beta || 0, gamma: e.rotationRate?.gamma || 0 }
-      });
+      const c = historyRef.current.current;
+      const acc = calibGravityRef.current ? e.accelerationIncludingGravity : e.acceleration;
+      c[CH_AX] = acc?.x || 0;
+      c[CH_AY] = acc?.y || 0;
+      c[CH_AZ] = acc?.z || 0;
+      c[CH_RATE_ALPHA] = e.rotationRate?.alpha || 0;
+      c[CH_RATE_BETA] = e.rotationRate?.beta || 0;
+      c[CH_RATE_GAMMA] = e.rotationRate?.gamma || 0;
+      commitSample();
     }
   }, []);
 
   // Manage Event Listeners based on isStreaming
   useEffect(() => {
-    if (isStreaming) {
-      window.addEventListener('deviceorientation', handleOrientation);
-      window.addEventListener('devicemotion', handleMotion);
-    } else {
-      window.removeEventListener('deviceorientation', handleOrientation);
-      window.removeEventListener('devicemotion', handleMotion);
-    }
+    if (!isStreaming || sensorFrequency !== 0) return;
+    window.addEventListener('deviceorientation', handleOrientation);
+    window.addEventListener('devicemotion', handleMotion);
     return () => {
       window.removeEventListener('deviceorientation', handleOrientation);
       window.removeEventListener('devicemotion', handleMotion);
     };
-  }, [isStreaming, handleOrientation, handleMotion]);
+  }, [isStreaming, sensorFrequency, handleOrientation, handleMotion]);
+
+  // Generic Sensor API input at the selected frequency
+  useEffect(() => {
+    if (!isStreaming || sensorFrequency === 0) return;
+    const source = new SensorSource(historyRef.current.current, {
+      includeGravity: () => calibGravityRef.current,
+      onSample: (timestampMs) => {
+        if (!isTestModeRef.current) commitSample(timestampMs);
+      },
+      onError: (message) => setError("センサーエラー: " + message),
+    });
+    source.start(sensorFrequency).catch(e => setError("センサーエラー: " + e.message));
+    return () => source.stop();
+  }, [isStreaming, sensorFrequency]);
 
   // Test Mode Loop - Now works regardless of status
   useEffect(() => {
@@ -270,22 +295,19 @@ const App: React.FC = () => {
       timer = window.setInterval(() => {
         const v = Math.sin(Date.now() / 500); // v in [-1, 1]
         // Test mode: Send sin wave as absolute orientation (rad)
-        updateBuffer({
-          timestamp: Date.now(),
-          acceleration: { x: v * 5, y: v * 2, z: 0 },
-          orientation: { alpha: v * Math.PI, beta: (v * Math.PI) / 4, gamma: 0 }
-        });
+        const c = historyRef.current.current;
+        c[CH_AX] = v * 5;
+        c[CH_AY] = v * 2;
+        c[CH_AZ] = 0;
+        c[CH_ALPHA] = v * Math.PI;
+        c[CH_BETA] = (v * Math.PI) / 4;
+        c[CH_GAMMA] = 0;
+        commitSample();
       }, 50);
     }
     return () => clearInterval(timer);
   }, [isTestMode]);
 
-  // Chart Update
-  useEffect(() => {
-    const i = setInterval(() => setImuDataBuffer([...bufferRef.current]), 100);
-    return () => clearInterval(i);
-  }, []);
-
   const toggleStreaming = async () => {
     if (!isStreaming) {
       if (typeof (DeviceOrientationEvent as any).requestPermission === 'function') {
@@ -361,11 +383,11 @@ const App: React.FC = () => {
               <div className="pt-2">
                 <div className="flex justify-between items-center mb-1">
                   <label className="text-[10px] font-bold text-slate-500 uppercase">Transmit Interval</label>
-                  <span className="text-xs font-mono text-indigo-400">{transmissionInterval}ms ({Math.round(1000 / transmissionInterval)}Hz)</span>
+                  <span className="text-xs font-mono text-indigo-400">{transmissionInterval === 0 ? 'every event' : `${transmissionInterval}ms (${Math.round(1000 / transmissionInterval)}Hz)`}</span>
                 </div>
                 <input
                   type="range"
-                  min="10"
+                  min="0"
                   max="500"
                   step="10"
                   value={transmissionInterval}
@@ -373,9 +395,88 @@ const App: React.FC = () => {
                   className="w-full h-1.5 bg-slate-700 rounded-lg appearance-none cursor-pointer accent-indigo-500"
                 />
               </div>
+
+              <div className="flex justify-between items-center">
+                <label className="text-[10px] font-bold text-slate-500 uppercase">Sensor Input</label>
+                <select
+                  value={sensorFrequency}
+                  onChange={(e) => setSensorFrequency(Number(e.target.value))}
+                  className="bg-slate-900 border border-slate-700 rounded-lg px-2 py-1 text-xs font-mono text-indigo-400"
+                >
+                  <option value={0}>events</option>
+                  {SENSOR_FREQUENCIES.map(f => (
+                    <option key={f} value={f} disabled={!isSensorApiSupported}>sensor {f}Hz</option>
+                  ))}
+                </select>
+              </div>
+
+              <div className="flex justify-between items-center">
+                <label className="text-[10px] font-bold text-slate-500 uppercase">CAN Decimation</label>
+                <select
+                  value={decimation}
+                  onChange={(e) => setDecimation(Number(e.target.value))}
+                  className="bg-slate-900 border border-slate-700 rounded-lg px-2 py-1 text-xs font-mono text-indigo-400"
+                >
+                  {DECIMATION_RATIOS.map(r => (
+                    <option key={r} value={r}>{r === 1 ? 'off' : `1/${r}`}</option>
+                  ))}
+                </select>
+              </div>
+
+              <div className="flex justify-between items-center">
+                <label className="text-[10px] font-bold text-slate-500 uppercase">USB Send Queue</label>
+                <div className="flex gap-2">
+                  <select
+                    value={sendPolicy.maxInFlight}
+                    onChange={(e) => setSendPolicy(p => ({ ...p, maxInFlight: Number(e.target.value) }))}
+                    className="bg-slate-900 border border-slate-700 rounded-lg px-2 py-1 text-xs font-mono text-indigo-400"
+                  >
+                    {MAX_IN_FLIGHT_CHOICES.map(n => (
+                      <option key={n} value={n}>{n} in flight</option>
+                    ))}
+                  </select>
+                  <select
+                    value={sendPolicy.latencyBudgetMs}
+                    onChange={(e) => setSendPolicy(p => ({ ...p, latencyBudgetMs: Number(e.target.value) }))}
+                    className="bg-slate-900 border border-slate-700 rounded-lg px-2 py-1 text-xs font-mono text-indigo-400"
+                  >
+                    {LATENCY_BUDGET_CHOICES_MS.map(ms => (
+                      <option key={ms} value={ms}>drop &gt;{ms}ms</option>
+                    ))}
+                  </select>
+                </div>
+              </div>
+
+              {clockInfo && (
+                <div className="flex justify-between items-center text-[10px] font-mono text-slate-500">
+                  <span className="font-bold uppercase">Clock Sync</span>
+                  <span>RTT {clockInfo.rttMs.toFixed(2)}ms (min {clockInfo.minRttMs.toFixed(2)}) / offset {(clockInfo.offsetMs / 1000).toFixed(3)}s</span>
+                </div>
+              )}
+
+              {linkStats && (
+                <div className="flex justify-between items-center text-[10px] font-mono text-slate-500">
+                  <span className="font-bold uppercase">USB Link ({linkStats.codec})</span>
+                  <span>latency {linkStats.latencyAvgMs.toFixed(2)}ms (max {linkStats.latencyMaxMs.toFixed(2)}) / {linkStats.samplesSent} sent{linkStats.samplesDropped ? `, ${linkStats.samplesDropped} dropped` : ''}{linkStats.txErrors ? `, ${linkStats.txErrors} errors` : ''}</span>
+                </div>
+              )}
             </div>
           </div>
 
+          <DiagnosticsPanel
+            stats={linkStats}
+            transmissionInterval={transmissionInterval}
+            onReset={() => linkRef.current?.resetDiagnostics()}
+          />
+
+          <CalibrationPanel
+            state={calibState}
+            status={calibStatus}
+            connected={status === ConnectionStatus.CONNECTED}
+            onCommand={calibrationCommand}
+            onPose={calibrationPose}
+          />
+
           <div className="bg-slate-800/50 p-6 rounded-2xl border border-slate-700">
             <h2 className="text-lg font-semibold mb-3 text-indigo-300">Gemini Insight</h2>
             <div className="bg-slate-950/60 p-4 rounded-xl italic text-slate-300 text-sm border border-slate-800 min-h-[80px] flex items-center">
@@ -385,23 +486,26 @@ const App: React.FC = () => {
         </div>
 
         <div className="lg:col-span-2 space-y-6">
-          <IMUChart data={imuDataBuffer} type="acceleration" />
+          <IMUChart history={historyRef.current} type="acceleration" />
 
           <div className="bg-slate-800/50 p-6 rounded-2xl border border-slate-700 shadow-2xl">
             <h2 className="text-lg font-semibold mb-4 flex items-center gap-2">
               <i className="fas fa-terminal text-emerald-400"></i> Terminal
             </h2>
-            <div className="bg-slate-950 p-4 rounded-xl border border-slate-800 font-mono text-xs relative">
-              <div
-                ref={rxLogRef}
-                className="flex flex-col-reverse h-64 overflow-y-auto scrollbar-thin scrollbar-thumb-slate-700 p-2"
-              >
-                <div className="text-slate-700 italic">Logs will appear here...</div>
-              </div>
-            </div>
+            <TerminalLog
+              ring={logRingRef.current}
+              sampleLogging={sampleLogging}
+              onSampleLoggingChange={changeSampleLogging}
+            />
           </div>
 
-          <IMUChart data={imuDataBuffer} type="orientation" />
+          <IMUChart history={historyRef.current} type="orientation" />
+
+          <CanRxView
+            stats={canRxStats}
+            connected={status === ConnectionStatus.CONNECTED}
+            onApplyIds={applyCanRxIds}
+          />
         </div>
       </div>
     </div>
@@ -0,0 +1,83 @@
+
+import React from 'react';
+
+export interface CalibrationState {
+  source: 'flash' | 'ram';
+  bias: number[];   // m/s^2, x y z
+  scale: number[];
+  poses: number;
+}
+
+// Progress of the running capture, and the outcome of the last one
+export interface CalibrationStatus {
+  capturing: 'still' | 'pose' | null;
+  message: string;
+}
+
+interface CalibrationPanelProps {
+  state: CalibrationState | null;
+  status: CalibrationStatus;
+  connected: boolean;
+  onCommand: (cmd: string) => void;
+  onPose: (pose: number) => void;
+}
+
+// The six faces used by "cal,pose,<i>"; the Pico needs them all for a fit
+export const CALIBRATION_POSES = ['Screen up', 'Screen down', 'Top up', 'Top down', 'Right side up', 'Left side up'];
+
+const CalibrationPanel: React.FC<CalibrationPanelProps> = ({ state, status, connected, onCommand, onPose }) => {
+  const busy = !connected || status.capturing !== null;
+  const button = 'px-2 py-1 text-xs font-bold rounded-lg border border-cyan-500/50 text-cyan-400 disabled:opacity-40';
+
+  return (
+    <div className="bg-slate-800/50 p-6 rounded-2xl border border-slate-700">
+      <h2 className="text-lg font-semibold mb-4 flex items-center gap-2">
+        <i className="fas fa-balance-scale text-cyan-400"></i> Calibration
+      </h2>
+
+      <div className="bg-slate-950 rounded-xl border border-slate-800 font-mono text-xs p-3 mb-3 text-slate-300">
+        {state ? (
+          <>
+            <div className="flex justify-between text-[10px] text-slate-500 uppercase mb-1">
+              <span>{state.source === 'flash' ? 'Stored in flash' : 'Not saved'}</span>
+              <span>{state.poses} poses</span>
+            </div>
+            {['x', 'y', 'z'].map((axis, i) => (
+              <div key={axis} className="flex justify-between">
+                <span className="text-slate-500">{axis}</span>
+                <span>bias {state.bias[i].toFixed(3)}</span>
+                <span>scale {state.scale[i].toFixed(4)}</span>
+              </div>
+            ))}
+          </>
+        ) : (
+          <div className="text-slate-700 italic">Not connected</div>
+        )}
+      </div>
+
+      <div className="space-y-2">
+        <button onClick={() => onCommand('still')} disabled={busy} className={`w-full ${button}`}>
+          Stationary bias (lay the phone flat)
+        </button>
+        <div className="grid grid-cols-2 gap-2">
+          {CALIBRATION_POSES.map((name, i) => (
+            <button key={name} onClick={() => onPose(i)} disabled={busy} className={button}>
+              {i + 1}. {name}
+            </button>
+          ))}
+        </div>
+        <div className="grid grid-cols-3 gap-2">
+          <button onClick={() => onCommand('fit')} disabled={busy} className={button}>Fit</button>
+          <button onClick={() => onCommand('save')} disabled={busy} className={button}>Save</button>
+          <button onClick={() => onCommand('reset')} disabled={busy} className={button}>Reset</button>
+        </div>
+      </div>
+
+      {status.message && (
+        <div className="mt-3 text-[10px] font-mono text-slate-400">{status.message}</div>
+      )}
+    </div>
+  );
+};
+
+export default CalibrationPanel;
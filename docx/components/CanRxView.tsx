@@ -0,0 +1,87 @@
+
+import React, { useState } from 'react';
+
+export interface CanRxStat {
+  id: number;
+  extended: boolean;
+  count: number;
+  rateHz: number;
+  lastData: Uint8Array;
+  lastTimestampUs: number;
+}
+
+interface CanRxViewProps {
+  stats: CanRxStat[];
+  connected: boolean;
+  onApplyIds: (ids: number[]) => void;
+}
+
+const hex = (data: Uint8Array) =>
+  Array.from(data, b => b.toString(16).padStart(2, '0').toUpperCase()).join(' ');
+
+const CanRxView: React.FC<CanRxViewProps> = ({ stats, connected, onApplyIds }) => {
+  const [idText, setIdText] = useState('0x100,0x101,0x200');
+
+  const apply = () => {
+    const ids = idText
+      .split(',')
+      .map(s => s.trim())
+      .filter(s => s.length > 0)
+      .map(s => Number(s))
+      .filter(n => Number.isInteger(n) && n >= 0);
+    onApplyIds(ids);
+  };
+
+  return (
+    <div className="bg-slate-800/50 p-6 rounded-2xl border border-slate-700">
+      <h2 className="text-lg font-semibold mb-4 flex items-center gap-2">
+        <i className="fas fa-network-wired text-pink-400"></i> CAN RX
+      </h2>
+
+      <div className="flex gap-2 mb-3">
+        <input
+          value={idText}
+          onChange={(e) => setIdText(e.target.value)}
+          placeholder="0x100,0x200 (empty: all)"
+          className="flex-1 bg-slate-950 border border-slate-700 rounded-lg px-2 py-1 text-xs font-mono text-slate-200"
+        />
+        <button
+          onClick={apply}
+          disabled={!connected}
+          className="px-3 py-1 text-xs font-bold rounded-lg border border-pink-500/50 text-pink-400 disabled:opacity-40"
+        >
+          Filter
+        </button>
+      </div>
+
+      <div className="bg-slate-950 rounded-xl border border-slate-800 font-mono text-xs max-h-64 overflow-y-auto">
+        {stats.length === 0 ? (
+          <div className="p-3 text-slate-700 italic">No frames received</div>
+        ) : (
+          <table className="w-full">
+            <thead className="text-slate-500 text-[10px] uppercase">
+              <tr>
+                <th className="text-left p-2">ID</th>
+                <th className="text-left p-2">Data</th>
+                <th className="text-right p-2">Hz</th>
+                <th className="text-right p-2">Count</th>
+              </tr>
+            </thead>
+            <tbody>
+              {stats.map(s => (
+                <tr key={`${s.extended ? 'x' : 's'}${s.id}`} className="border-t border-slate-800 text-pink-300">
+                  <td className="p-2">{s.id.toString(16).toUpperCase().padStart(s.extended ? 8 : 3, '0')}</td>
+                  <td className="p-2 text-slate-300">{hex(s.lastData)}</td>
+                  <td className="p-2 text-right">{s.rateHz.toFixed(1)}</td>
+                  <td className="p-2 text-right text-slate-500">{s.count}</td>
+                </tr>
+              ))}
+            </tbody>
+          </table>
+        )}
+      </div>
+    </div>
+  );
+};
+
+export default CanRxView;
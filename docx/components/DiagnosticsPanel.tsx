@@ -0,0 +1,82 @@
+import React from 'react';
+import { HISTOGRAM_EDGES_MS, LinkStats } from '../services/usbProtocol';
+
+interface DiagnosticsPanelProps {
+  stats: LinkStats | null;
+  transmissionInterval: number; // ms, 0 = every event
+  onReset: () => void;
+}
+
+const binLabel = (i: number) =>
+  i < HISTOGRAM_EDGES_MS.length ? `<${HISTOGRAM_EDGES_MS[i]}` : `≥${HISTOGRAM_EDGES_MS[i - 1]}`;
+
+const Histogram: React.FC<{ title: string; bins: number[]; color: string }> = ({ title, bins, color }) => {
+  const total = bins.reduce((a, b) => a + b, 0);
+  const peak = Math.max(1, ...bins);
+  return (
+    <div>
+      <div className="flex justify-between text-[10px] text-slate-500 mb-1">
+        <span className="font-bold uppercase">{title}</span>
+        <span>n = {total}, ms bins</span>
+      </div>
+      <div className="flex items-end gap-1 h-16">
+        {bins.map((n, i) => (
+          <div key={i} className="flex-1 flex flex-col items-center justify-end h-full" title={`${binLabel(i)} ms: ${n}`}>
+            <div className={`w-full rounded-t ${color}`} style={{ height: `${(n / peak) * 100}%` }} />
+          </div>
+        ))}
+      </div>
+      <div className="flex gap-1 text-[9px] text-slate-600 font-mono">
+        {bins.map((_, i) => <span key={i} className="flex-1 text-center">{binLabel(i)}</span>)}
+      </div>
+    </div>
+  );
+};
+
+// Link health for tuning the transmit interval per phone: round trip,
+// achieved send and device receive rates, losses and device queue depths
+const DiagnosticsPanel: React.FC<DiagnosticsPanelProps> = ({ stats, transmissionInterval, onReset }) => {
+  const row = (label: string, value: string) => (
+    <div className="flex justify-between">
+      <span className="text-slate-500 uppercase">{label}</span>
+      <span className="text-slate-300">{value}</span>
+    </div>
+  );
+  const dev = stats?.device;
+
+  return (
+    <div className="bg-slate-800/50 p-6 rounded-2xl border border-slate-700">
+      <div className="flex justify-between items-center mb-4">
+        <h2 className="text-lg font-semibold flex items-center gap-2">
+          <i className="fas fa-stethoscope text-amber-400"></i> Diagnostics
+        </h2>
+        <button
+          onClick={onReset}
+          disabled={!stats}
+          className="px-3 py-1 text-xs font-bold rounded-lg border border-amber-500/50 text-amber-400 disabled:opacity-40"
+        >
+          Reset
+        </button>
+      </div>
+
+      {!stats ? (
+        <div className="text-xs text-slate-600 italic">Connect to measure the link</div>
+      ) : (
+        <div className="space-y-4">
+          <div className="text-[10px] font-mono space-y-1">
+            {row('RTT', `${stats.clock.rttMs.toFixed(2)} ms (min ${Number.isFinite(stats.clock.minRttMs) ? stats.clock.minRttMs.toFixed(2) : '-'})`)}
+            {row('Send rate', `${stats.txRateHz.toFixed(1)} Hz${transmissionInterval ? ` / target ${(1000 / transmissionInterval).toFixed(0)} Hz` : ''}`)}
+            {row('Device rate', dev ? `${dev.rxRateHz.toFixed(1)} Hz` : '-')}
+            {row('Dropped (browser)', `${stats.samplesDropped}`)}
+            {row('Lost (seq gaps)', dev ? `${dev.seqMissed} / ${dev.rxSamples}` : '-')}
+            {row('Device queues', dev ? `USB ${dev.usbBacklog} B / CAN RX ${dev.canRxDepth}` : '-')}
+          </div>
+          <Histogram title="Sample latency" bins={stats.latencyHist} color="bg-emerald-500/70" />
+          <Histogram title="Round trip" bins={stats.rttHist} color="bg-indigo-500/70" />
+        </div>
+      )}
+    </div>
+  );
+};
+
+export default DiagnosticsPanel;
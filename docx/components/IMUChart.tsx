@@ -1,43 +1,137 @@
-
-import React from 'react';
-import {
-  LineChart,
-  Line,
-  XAxis,
-  YAxis,
-  CartesianGrid,
-  Tooltip,
-  ResponsiveContainer,
-  Legend
-} from 'recharts';
-import { IMUData } from '../types';
+import React, { useEffect, useRef } from 'react';
+import { ImuHistory, CH_ALPHA, CH_AX } from '../services/imuHistory';
 
 interface IMUChartProps {
-  data: IMUData[];
+  history: ImuHistory;
   type: 'acceleration' | 'orientation';
 }
 
-const IMUChart: React.FC<IMUChartProps> = ({ data, type }) => {
-  // Create a fixed-size buffer of 50 points for the chart to prevent "stretching" effect
-  const MAX_POINTS = 50;
-  const chartData = Array.from({ length: MAX_POINTS }, (_, i) => {
-    // Fill from the right: the latest data is at the end of the array
-    const dataIndex = data.length - MAX_POINTS + i;
-    const d = dataIndex >= 0 ? data[dataIndex] : null;
-
-    return {
-      name: i,
-      x: d ? (type === 'acceleration' ? d.acceleration.x : d.orientation.alpha) : null,
-      y: d ? (type === 'acceleration' ? d.acceleration.y : d.orientation.beta) : null,
-      z: d ? (type === 'acceleration' ? d.acceleration.z : d.orientation.gamma) : null,
+// Newest samples shown; about 10 s at 200 Hz
+const WINDOW_POINTS = 2000;
+
+const colors = {
+  x: '#ef4444', // Red
+  y: '#22c55e', // Green
+  z: '#3b82f6', // Blue
+};
+
+const GRID_COLOR = '#334155';
+const AXIS_COLOR = '#94a3b8';
+const AXIS_WIDTH = 35;
+
+// Canvas line chart read straight from the history ring. It draws on
+// requestAnimationFrame only when the history changed, and each pixel
+// column is one min/max pair, so the cost follows the canvas width
+// rather than the sample count.
+const IMUChart: React.FC<IMUChartProps> = ({ history, type }) => {
+  const canvasRef = useRef<HTMLCanvasElement>(null);
+
+  useEffect(() => {
+    const canvas = canvasRef.current;
+    const ctx = canvas?.getContext('2d');
+    if (!canvas || !ctx) return;
+
+    const first = type === 'acceleration' ? CH_AX : CH_ALPHA;
+    const series = [colors.x, colors.y, colors.z];
+    let drawnRevision = -1;
+    let drawnWidth = 0;
+    let drawnHeight = 0;
+    let frame = 0;
+    // Auto range for acceleration, only ever widened while shown
+    let lo = -1;
+    let hi = 1;
+
+    const draw = () => {
+      frame = requestAnimationFrame(draw);
+      const dpr = window.devicePixelRatio || 1;
+      const w = Math.round(canvas.clientWidth * dpr);
+      const h = Math.round(canvas.clientHeight * dpr);
+      if (history.revision === drawnRevision && w === drawnWidth && h === drawnHeight) return;
+      if (canvas.width !== w || canvas.height !== h) {
+        canvas.width = w;
+        canvas.height = h;
+      }
+      drawnRevision = history.revision;
+      drawnWidth = w;
+      drawnHeight = h;
+
+      const views = [history.view(first), history.view(first + 1), history.view(first + 2)]
+        .map(v => v.subarray(Math.max(0, v.length - WINDOW_POINTS)));
+      const n = views[0].length;
+
+      if (type === 'orientation') {
+        lo = -6.3;
+        hi = 6.3;
+      } else {
+        for (const v of views) {
+          for (let i = 0; i < n; i++) {
+            if (v[i] < lo) lo = Math.floor(v[i]);
+            if (v[i] > hi) hi = Math.ceil(v[i]);
+          }
+        }
+      }
+
+      const plotX = AXIS_WIDTH * dpr;
+      const plotW = w - plotX;
+      const yOf = (v: number) => h - ((v - lo) / (hi - lo)) * h;
+
+      ctx.clearRect(0, 0, w, h);
+      ctx.lineWidth = dpr;
+      ctx.strokeStyle = GRID_COLOR;
+      ctx.fillStyle = AXIS_COLOR;
+      ctx.font = `${10 * dpr}px sans-serif`;
+      ctx.textBaseline = 'middle';
+      ctx.setLineDash([3 * dpr, 3 * dpr]);
+      for (let k = 0; k <= 4; k++) {
+        const v = lo + ((hi - lo) * k) / 4;
+        const y = Math.min(h - 5 * dpr, Math.max(5 * dpr, yOf(v)));
+        ctx.beginPath();
+        ctx.moveTo(plotX, yOf(v));
+        ctx.lineTo(w, yOf(v));
+        ctx.stroke();
+        ctx.fillText(v.toFixed(1), 0, y);
+      }
+      ctx.setLineDash([]);
+      if (n < 2) return;
+
+      // Samples fill the plot from the right, WINDOW_POINTS across
+      const perPx = WINDOW_POINTS / plotW;
+      const x0 = plotX + plotW - (n / WINDOW_POINTS) * plotW;
+      ctx.lineWidth = 2 * dpr;
+      for (let s = 0; s < 3; s++) {
+        const v = views[s];
+        ctx.strokeStyle = series[s];
+        ctx.beginPath();
+        if (perPx <= 1) {
+          for (let i = 0; i < n; i++) {
+            const x = x0 + i / perPx;
+            if (i === 0) ctx.moveTo(x, yOf(v[i])); else ctx.lineTo(x, yOf(v[i]));
+          }
+        } else {
+          // Min/max decimation: one vertical span per pixel column
+          const columns = Math.ceil(n / perPx);
+          for (let c = 0; c < columns; c++) {
+            const start = Math.floor(c * perPx);
+            const end = Math.min(n, Math.floor((c + 1) * perPx));
+            let min = v[start];
+            let max = v[start];
+            for (let i = start + 1; i < end; i++) {
+              if (v[i] < min) min = v[i];
+              if (v[i] > max) max = v[i];
+            }
+            const x = x0 + c;
+            if (c === 0) ctx.moveTo(x, yOf(v[start])); else ctx.lineTo(x, yOf(v[start]));
+            ctx.lineTo(x, yOf(min));
+            ctx.lineTo(x, yOf(max));
+          }
+        }
+        ctx.stroke();
+      }
     };
-  });
 
-  const colors = {
-    x: '#ef4444', // Red
-    y: '#22c55e', // Green
-    z: '#3b82f6', // Blue
-  };
+    frame = requestAnimationFrame(draw);
+    return () => cancelAnimationFrame(frame);
+  }, [history, type]);
 
   const labels = type === 'acceleration'
     ? { x: 'Acc X', y: 'Acc Y', z: 'Acc Z' }
@@ -46,55 +140,19 @@ const IMUChart: React.FC<IMUChartProps> = ({ data, type }) => {
   const unit = type === 'acceleration' ? 'm/s²' : 'rad';
 
   return (
-    <div className="h-64 w-full bg-slate-800/50 rounded-xl p-4 border border-slate-700">
+    <div className="h-64 w-full bg-slate-800/50 rounded-xl p-4 border border-slate-700 flex flex-col">
       <h3 className="text-sm font-semibold mb-2 text-slate-400 uppercase tracking-wider">
         {type === 'acceleration' ? `Linear Acceleration (${unit})` : `Device Orientation (${unit})`}
       </h3>
-      <ResponsiveContainer width="100%" height="100%">
-        <LineChart data={chartData}>
-          <CartesianGrid strokeDasharray="3 3" stroke="#334155" vertical={false} />
-          <XAxis dataKey="name" hide />
-          <YAxis
-            stroke="#94a3b8"
-            fontSize={10}
-            width={35}
-            domain={type === 'orientation' ? [-6.3, 6.3] : ['auto', 'auto']}
-          />
-          <Tooltip
-            contentStyle={{ backgroundColor: '#1e293b', border: 'none', borderRadius: '8px', fontSize: '12px' }}
-            itemStyle={{ padding: '0px' }}
-            formatter={(value: number) => [value?.toFixed(3), '']}
-          />
-          <Legend iconType="circle" wrapperStyle={{ fontSize: '10px', paddingTop: '10px' }} />
-          <Line
-            type="monotone"
-            dataKey="x"
-            name={labels.x}
-            stroke={colors.x}
-            strokeWidth={2}
-            dot={false}
-            isAnimationActive={false}
-          />
-          <Line
-            type="monotone"
-            dataKey="y"
-            name={labels.y}
-            stroke={colors.y}
-            strokeWidth={2}
-            dot={false}
-            isAnimationActive={false}
-          />
-          <Line
-            type="monotone"
-            dataKey="z"
-            name={labels.z}
-            stroke={colors.z}
-            strokeWidth={2}
-            dot={false}
-            isAnimationActive={false}
-          />
-        </LineChart>
-      </ResponsiveContainer>
+      <canvas ref={canvasRef} className="flex-1 w-full min-h-0" />
+      <div className="flex justify-center gap-4 pt-2 text-[10px]">
+        {(['x', 'y', 'z'] as const).map(k => (
+          <span key={k} className="flex items-center gap-1" style={{ color: colors[k] }}>
+            <span className="w-2 h-2 rounded-full" style={{ backgroundColor: colors[k] }} />
+            {labels[k]}
+          </span>
+        ))}
+      </div>
     </div>
   );
 };
@@ -0,0 +1,84 @@
+import React, { useEffect, useState } from 'react';
+import { LogRing } from '../services/logRing';
+
+interface TerminalLogProps {
+  ring: LogRing;
+  sampleLogging: boolean;
+  onSampleLoggingChange: (enabled: boolean) => void;
+}
+
+// Rows are one line each so the list can be virtualized by offset
+const ROW_HEIGHT = 18;
+const VIEW_HEIGHT = 256;
+const OVERSCAN = 5;
+// The view picks up new lines at most this often
+const REFRESH_MS = 250;
+
+const formatTime = (t: number) =>
+  new Date(t).toLocaleTimeString('ja-JP', { hour12: false, hour: '2-digit', minute: '2-digit', second: '2-digit' });
+
+// Terminal over a LogRing: only the rows in view exist in the DOM, newest
+// at the top, refreshed on a timer rather than per line
+const TerminalLog: React.FC<TerminalLogProps> = ({ ring, sampleLogging, onSampleLoggingChange }) => {
+  const [, setRevision] = useState(0);
+  const [scrollTop, setScrollTop] = useState(0);
+
+  useEffect(() => {
+    const i = setInterval(() => setRevision(ring.revision), REFRESH_MS);
+    return () => clearInterval(i);
+  }, [ring]);
+
+  const first = Math.max(0, Math.floor(scrollTop / ROW_HEIGHT) - OVERSCAN);
+  const last = Math.min(ring.length, Math.ceil((scrollTop + VIEW_HEIGHT) / ROW_HEIGHT) + OVERSCAN);
+  const rows = [];
+  for (let i = first; i < last; i++) {
+    const dir = ring.dir(i);
+    rows.push(
+      <div
+        key={i}
+        className={`absolute left-0 right-0 border-l-2 pl-2 flex gap-2 whitespace-nowrap overflow-hidden ${dir === 'tx' ? 'border-emerald-600 text-emerald-400' : 'border-pink-600 text-pink-400'}`}
+        style={{ top: i * ROW_HEIGHT, height: ROW_HEIGHT - 2 }}
+      >
+        <span className="opacity-40 text-[10px] w-16 shrink-0">{formatTime(ring.time(i))}</span>
+        <span className="font-bold w-8 uppercase shrink-0">{dir}</span>
+        <span className="flex-1 truncate">{ring.text(i)}</span>
+      </div>
+    );
+  }
+
+  return (
+    <div className="bg-slate-950 p-4 rounded-xl border border-slate-800 font-mono text-xs relative">
+      <div className="flex justify-between items-center pb-2 mb-2 border-b border-slate-800 text-[10px] text-slate-500">
+        <label className="flex items-center gap-2 cursor-pointer">
+          <input
+            type="checkbox"
+            checked={sampleLogging}
+            onChange={e => onSampleLoggingChange(e.target.checked)}
+            className="accent-emerald-500"
+          />
+          Log every sample
+        </label>
+        <span>
+          {ring.length} lines
+          {ring.suppressed > 0 && ` / ${ring.suppressed} samples not logged`}
+          {ring.evicted > 0 && ` / ${ring.evicted} dropped`}
+        </span>
+      </div>
+      <div
+        onScroll={e => setScrollTop(e.currentTarget.scrollTop)}
+        className="overflow-y-auto scrollbar-thin scrollbar-thumb-slate-700 p-2"
+        style={{ height: VIEW_HEIGHT }}
+      >
+        {ring.length === 0 ? (
+          <div className="text-slate-700 italic">Logs will appear here...</div>
+        ) : (
+          <div className="relative" style={{ height: ring.length * ROW_HEIGHT }}>
+            {rows}
+          </div>
+        )}
+      </div>
+    </div>
+  );
+};
+
+export default TerminalLog;
@@ -0,0 +1,67 @@
+
+// Browser side of the ping/PONG clock exchange (pico/src/clock_sync.h).
+//
+//   -> ping,<t1>[,<t1'>,<t4'>]     t1 = browser send time
+//   <- PONG,<t1>,<t2>,<t3>         t2/t3 = device receive/reply time
+//
+// t4 is taken when the PONG line arrives and handed back with the next
+// ping, so the device can fit its own offset/drift. All times are
+// integer microseconds; the browser clock is performance.now() of the
+// page, also inside the USB worker (see alignClock).
+export interface ClockSyncInfo {
+  rttMs: number;      // last round trip minus device hold time
+  minRttMs: number;
+  offsetMs: number;   // device - browser, from the latest low-delay exchange
+  exchanges: number;
+}
+
+let originShiftMs = 0;
+
+export const nowUs = () => Math.round((performance.now() + originShiftMs) * 1000);
+
+// A worker's performance.now() starts at its own creation; shift it onto
+// the page's time origin so samples and pings share one clock
+export const alignClock = (pageTimeOrigin: number) => {
+  originShiftMs = performance.timeOrigin - pageTimeOrigin;
+};
+
+export class ClockSyncClient {
+  private lastT1 = 0;
+  private lastT4 = 0;
+  info: ClockSyncInfo = { rttMs: 0, minRttMs: Infinity, offsetMs: 0, exchanges: 0 };
+
+  reset() {
+    this.lastT1 = 0;
+    this.lastT4 = 0;
+    this.info = { rttMs: 0, minRttMs: Infinity, offsetMs: 0, exchanges: 0 };
+  }
+
+  nextPing(): string {
+    const t1 = nowUs();
+    const prev = this.lastT4 ? `,${this.lastT1},${this.lastT4}` : '';
+    this.lastT1 = t1;
+    this.lastT4 = 0;
+    return `ping,${t1}${prev}`;
+  }
+
+  // Returns true when the line was a sync reply (and should not be logged)
+  handleLine(line: string): boolean {
+    if (!line.startsWith('PONG,')) return false;
+    const t4 = nowUs();
+    const [t1, t2, t3] = line.slice(5).split(',').map(Number);
+    if (t1 !== this.lastT1 || !Number.isFinite(t2) || !Number.isFinite(t3)) return true;
+
+    this.lastT4 = t4;
+    const delay = (t4 - t1) - (t3 - t2);
+    const offset = ((t2 - t1) + (t3 - t4)) / 2;
+    this.info.exchanges++;
+    this.info.rttMs = delay / 1000;
+    // Within 1 ms of the best round trip: little queueing, so the offset
+    // error (at most half the asymmetry) stays small
+    if (this.info.rttMs <= this.info.minRttMs + 1) {
+      this.info.minRttMs = Math.min(this.info.minRttMs, this.info.rttMs);
+      this.info.offsetMs = offset / 1000;
+    }
+    return true;
+  }
+}
@@ -0,0 +1,101 @@
+import { CanRxFrame } from '../types';
+
+// Mirrors pico/src/usb_frame.h:
+//   [0xA5][type][len][payload][crc8(type, len, payload)]
+// Binary frames are interleaved with ASCII text lines (PONG, ACK, ...)
+// and raw UART bytes, so a frame that fails its CRC may have started on a
+// stray 0xA5: the bytes after it are parsed again.
+export const USB_FRAME_SYNC = 0xA5;
+export const USB_FRAME_CAN_RX = 0x01;
+const CAN_RX_RECORD_SIZE = 17;
+
+export const crc8 = (data: Uint8Array, start = 0, end = data.length, crc = 0): number => {
+  for (let i = start; i < end; i++) {
+    crc ^= data[i];
+    for (let b = 0; b < 8; b++) {
+      crc = crc & 0x80 ? ((crc << 1) ^ 0x07) & 0xFF : (crc << 1) & 0xFF;
+    }
+  }
+  return crc;
+};
+
+export interface DeviceStreamHandlers {
+  onLine: (line: string) => void;
+  onFrame: (type: number, payload: Uint8Array) => void;
+}
+
+export interface StreamParser {
+  feed(bytes: Uint8Array): void;
+  readonly crcErrors: number;
+}
+
+// Incremental splitter for the device -> browser byte stream. Frames and
+// lines may be cut at any USB packet boundary. Fallback for the
+// firmware's usbFrameDecode compiled to WebAssembly (wasmCodec.ts).
+export class DeviceStreamParser implements StreamParser {
+  private line: number[] = [];
+  private frame = new Uint8Array(3 + 255 + 1);
+  private frameLen = 0; // bytes collected, 0 = not inside a frame
+  private decoder = new TextDecoder();
+  crcErrors = 0;
+
+  constructor(private handlers: DeviceStreamHandlers) {}
+
+  feed(bytes: Uint8Array) {
+    for (let i = 0; i < bytes.length; i++) {
+      const b = bytes[i];
+      if (this.frameLen > 0) {
+        this.frame[this.frameLen++] = b;
+        if (this.frameLen >= 3 && this.frameLen === 3 + this.frame[2] + 1) {
+          this.finishFrame();
+        }
+      } else if (b === USB_FRAME_SYNC) {
+        this.frame[0] = b;
+        this.frameLen = 1;
+      } else if (b === 0x0A) {
+        this.flushLine();
+      } else if (b !== 0x0D && b < 0x80) {
+        this.line.push(b);
+      }
+    }
+  }
+
+  private flushLine() {
+    if (this.line.length === 0) return;
+    const text = this.decoder.decode(new Uint8Array(this.line)).trim();
+    this.line = [];
+    if (text) this.handlers.onLine(text);
+  }
+
+  private finishFrame() {
+    const len = this.frame[2];
+    const end = 3 + len;
+    this.frameLen = 0;
+    if (crc8(this.frame, 1, end) !== this.frame[end]) {
+      this.crcErrors++;
+      this.feed(this.frame.slice(1, end + 1));
+      return;
+    }
+    this.handlers.onFrame(this.frame[1], this.frame.slice(3, end));
+  }
+}
+
+export const decodeCanRx = (payload: Uint8Array): CanRxFrame[] => {
+  const view = new DataView(payload.buffer, payload.byteOffset, payload.byteLength);
+  const count = payload[0];
+  const frames: CanRxFrame[] = [];
+  for (let i = 0; i < count; i++) {
+    const off = 1 + i * CAN_RX_RECORD_SIZE;
+    if (off + CAN_RX_RECORD_SIZE > payload.length) break;
+    const rawId = view.getUint32(off + 4, true);
+    const dlc = Math.min(payload[off + 8], 8);
+    frames.push({
+      timestampUs: view.getUint32(off, true),
+      id: rawId & 0x1FFFFFFF,
+      extended: (rawId & 0x80000000) !== 0,
+      dlc,
+      data: payload.slice(off + 9, off + 9 + dlc),
+    });
+  }
+  return frames;
+};
@@ -0,0 +1,81 @@
+// IMU history as a struct-of-arrays ring: one Float32Array per channel
+// and Float64Array timestamps. Every sample is written twice, at slot and
+// slot + capacity, so the newest n samples are always one contiguous
+// subarray and windowed reads never copy.
+export const CH_ALPHA = 0;
+export const CH_BETA = 1;
+export const CH_GAMMA = 2;
+export const CH_AX = 3;
+export const CH_AY = 4;
+export const CH_AZ = 5;
+export const CH_RATE_ALPHA = 6;
+export const CH_RATE_BETA = 7;
+export const CH_RATE_GAMMA = 8;
+export const IMU_CHANNELS = 9;
+
+// About five minutes at 200 Hz
+export const IMU_HISTORY_CAPACITY = 1 << 16;
+
+export class ImuHistory {
+  // Latest value of every channel; partial events update it in place,
+  // so a channel keeps its last value until a new one arrives
+  readonly current = new Float64Array(IMU_CHANNELS);
+  private channels: Float32Array[] = [];
+  private times: Float64Array;
+  private head = 0; // next slot
+  length = 0;
+  // Bumped on every change, for render triggers
+  revision = 0;
+
+  constructor(readonly capacity = IMU_HISTORY_CAPACITY) {
+    for (let c = 0; c < IMU_CHANNELS; c++) this.channels.push(new Float32Array(capacity * 2));
+    this.times = new Float64Array(capacity * 2);
+  }
+
+  get lastTime() {
+    return this.length ? this.times[this.head + this.capacity - 1] : -Infinity;
+  }
+
+  // Appends `current` as a new sample
+  push(time: number) {
+    this.write(this.head, time);
+    this.head = (this.head + 1) % this.capacity;
+    if (this.length < this.capacity) this.length++;
+  }
+
+  // Rewrites the newest sample with `current`, keeping its time
+  replaceLast() {
+    if (!this.length) return;
+    const slot = (this.head + this.capacity - 1) % this.capacity;
+    this.write(slot, this.times[slot]);
+  }
+
+  private write(slot: number, time: number) {
+    for (let c = 0; c < IMU_CHANNELS; c++) {
+      const v = this.current[c];
+      this.channels[c][slot] = v;
+      this.channels[c][slot + this.capacity] = v;
+    }
+    this.times[slot] = time;
+    this.times[slot + this.capacity] = time;
+    this.revision++;
+  }
+
+  // Newest n samples of a channel, oldest first (n <= length)
+  view(channel: number, n = this.length) {
+    const end = this.head + this.capacity;
+    return this.channels[channel].subarray(end - Math.min(n, this.length), end);
+  }
+
+  timeView(n = this.length) {
+    const end = this.head + this.capacity;
+    return this.times.subarray(end - Math.min(n, this.length), end);
+  }
+
+  clear() {
+    this.current.fill(0);
+    this.head = 0;
+    this.length = 0;
+    this.revision++;
+  }
+}
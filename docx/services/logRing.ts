@@ -0,0 +1,56 @@
+import type { LogEntry } from './usbProtocol';
+
+export const LOG_RING_CAPACITY = 2000;
+
+// Terminal history of fixed capacity. Pushing only stores the line; the
+// terminal view reads the newest rows when it refreshes.
+export class LogRing {
+  private dirs: LogEntry['dir'][];
+  private texts: string[];
+  private times: Float64Array;
+  private head = 0;
+  length = 0;
+  // Lines that fell out of the ring, and sample lines the worker did not
+  // send (per-sample logging off)
+  evicted = 0;
+  suppressed = 0;
+  revision = 0;
+
+  constructor(readonly capacity = LOG_RING_CAPACITY) {
+    this.dirs = new Array(capacity);
+    this.texts = new Array(capacity);
+    this.times = new Float64Array(capacity);
+  }
+
+  push(dir: LogEntry['dir'], text: string, time = Date.now()) {
+    this.dirs[this.head] = dir;
+    this.texts[this.head] = text;
+    this.times[this.head] = time;
+    this.head = (this.head + 1) % this.capacity;
+    if (this.length < this.capacity) this.length++; else this.evicted++;
+    this.revision++;
+  }
+
+  addSuppressed(n: number) {
+    if (n === 0) return;
+    this.suppressed += n;
+    this.revision++;
+  }
+
+  // i = 0 is the newest line
+  dir(i: number) { return this.dirs[this.slot(i)]; }
+  text(i: number) { return this.texts[this.slot(i)]; }
+  time(i: number) { return this.times[this.slot(i)]; }
+
+  private slot(i: number) {
+    return (this.head - 1 - i + this.capacity * 2) % this.capacity;
+  }
+
+  clear() {
+    this.head = 0;
+    this.length = 0;
+    this.evicted = 0;
+    this.suppressed = 0;
+    this.revision++;
+  }
+}
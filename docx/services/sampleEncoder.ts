@@ -0,0 +1,87 @@
+import { SAMPLE_BATCH_MAX, SAMPLE_STRIDE } from './usbProtocol';
+
+// Writes IMU samples as the Pico's CSV lines
+//   alpha,beta,gamma,ax,ay,az,t_us,seq\n
+// straight into one reusable byte buffer, two decimals per value like
+// toFixed(2), without building strings. The line stays ASCII because the
+// Pico forwards it to the UART as-is.
+//
+// transferOut() copies its data when called, so the buffer can be
+// reused as soon as the call returns.
+//
+// This is the fallback for the firmware's own encoder compiled to
+// WebAssembly (wasmCodec.ts). Both round |v| * 100 of the same double
+// half up, so they produce the same lines.
+
+// Longest line: six "-9999999.99," fields, a 20 digit time and a u32 seq
+export const MAX_LINE_BYTES = 6 * 12 + 21 + 11;
+// Values are clamped to what fits the field width
+const VALUE_LIMIT = 9999999.99;
+// Times outside [0, 2^53) us are written as 0
+const TIME_LIMIT = 2 ** 53;
+
+const MINUS = 0x2D;
+const DOT = 0x2E;
+const COMMA = 0x2C;
+const ZERO = 0x30;
+const LF = 0x0A;
+
+export interface SampleCodec {
+  // Up to SAMPLE_BATCH_MAX samples, laid out as in usbProtocol.ts
+  readonly input: Float64Array;
+  // Lines for input samples [0, count), numbered from seq (u32, wraps);
+  // the view is reused by the next call
+  encode(count: number, seq: number): Uint8Array;
+}
+
+export class SampleEncoder implements SampleCodec {
+  readonly input = new Float64Array(SAMPLE_BATCH_MAX * SAMPLE_STRIDE);
+  readonly bytes = new Uint8Array(SAMPLE_BATCH_MAX * MAX_LINE_BYTES);
+  length = 0;
+  private digits = new Uint8Array(20);
+
+  encode(count: number, seq: number) {
+    this.length = 0;
+    for (let i = 0; i < count; i++) this.append(this.input, i, (seq + i) >>> 0);
+    return this.bytes.subarray(0, this.length);
+  }
+
+  // Appends sample i of a Float64Array batch
+  private append(s: Float64Array, i: number, seq: number) {
+    if (this.length + MAX_LINE_BYTES > this.bytes.length) return false;
+    const o = i * SAMPLE_STRIDE;
+    for (let k = 1; k <= 6; k++) {
+      this.writeFixed2(s[o + k]);
+      this.bytes[this.length++] = COMMA;
+    }
+    const t = s[o];
+    this.writeUint(t > 0 && t < TIME_LIMIT ? Math.round(t) : 0);
+    this.bytes[this.length++] = COMMA;
+    this.writeUint(seq);
+    this.bytes[this.length++] = LF;
+    return true;
+  }
+
+  private writeFixed2(v: number) {
+    if (!Number.isFinite(v)) v = 0;
+    if (v > VALUE_LIMIT) v = VALUE_LIMIT;
+    if (v < -VALUE_LIMIT) v = -VALUE_LIMIT;
+    const cents = Math.round(Math.abs(v) * 100);
+    if (v < 0 && cents !== 0) this.bytes[this.length++] = MINUS;
+    this.writeUint(Math.floor(cents / 100));
+    const frac = cents % 100;
+    this.bytes[this.length++] = DOT;
+    this.bytes[this.length++] = ZERO + Math.floor(frac / 10);
+    this.bytes[this.length++] = ZERO + frac % 10;
+  }
+
+  // Integers up to 2^53, digit by digit
+  private writeUint(n: number) {
+    let d = 0;
+    do {
+      this.digits[d++] = ZERO + n % 10;
+      n = Math.floor(n / 10);
+    } while (n > 0);
+    while (d > 0) this.bytes[this.length++] = this.digits[--d];
+  }
+}
@@ -0,0 +1,133 @@
+import {
+  CH_ALPHA, CH_BETA, CH_GAMMA, CH_AX, CH_AY, CH_AZ, CH_RATE_ALPHA, CH_RATE_BETA, CH_RATE_GAMMA,
+} from './imuHistory';
+
+// IMU input through the Generic Sensor API at a requested frequency,
+// instead of deviceorientation/devicemotion at whatever rate the browser
+// picks. Orientation and gyroscope readings update their channels; each
+// accelerometer reading completes a sample, stamped with its own sensor
+// timestamp (performance.now() timebase, ms).
+//
+// Both accelerometers run so the pose captures can switch to gravity
+// included without restarting; only the selected one completes samples.
+export interface SensorSourceHandlers {
+  includeGravity: () => boolean;
+  onSample: (timestampMs: number) => void;
+  onError: (message: string) => void;
+}
+
+export const SENSOR_FREQUENCIES = [60, 100, 200];
+
+const RAD_TO_DEG = 180 / Math.PI;
+
+export const isGenericSensorSupported = () =>
+  'Accelerometer' in window && 'LinearAccelerationSensor' in window &&
+  'Gyroscope' in window && 'AbsoluteOrientationSensor' in window;
+
+// Sensors stay silent without these; browsers that do not know a name
+// throw, which leaves the decision to sensor.start()
+const requestPermissions = async () => {
+  for (const name of ['accelerometer', 'gyroscope', 'magnetometer']) {
+    try {
+      const res = await navigator.permissions.query({ name } as any);
+      if (res.state === 'denied') throw new Error(`${name} permission denied`);
+    } catch (e: any) {
+      if (e.message?.endsWith('permission denied')) throw e;
+    }
+  }
+};
+
+// Quaternion [x, y, z, w] to deviceorientation angles (rad): intrinsic
+// Z-X'-Y'' rotation with the event's ranges, alpha in [0, 2pi), beta in
+// [-pi, pi), gamma in [-pi/2, pi/2). Follows the rotation matrix
+// conversion in the DeviceOrientation spec: when the device is upside
+// down (m33 < 0) beta continues past +-pi/2 and gamma stays in range.
+const quaternionToEuler = (q: number[], out: Float64Array) => {
+  const [x, y, z, w] = q;
+  const m11 = 1 - 2 * (y * y + z * z);
+  const m12 = 2 * (x * y - z * w);
+  const m21 = 2 * (x * y + z * w);
+  const m22 = 1 - 2 * (x * x + z * z);
+  const m31 = 2 * (x * z - y * w);
+  const m32 = 2 * (y * z + x * w);
+  const m33 = 1 - 2 * (x * x + y * y);
+  const sinBeta = Math.max(-1, Math.min(1, m32));
+  let alpha: number, beta: number, gamma: number;
+  if (m33 > 0 || (m33 === 0 && m31 > 0)) {
+    alpha = Math.atan2(-m12, m22);
+    beta = Math.asin(sinBeta);
+    gamma = m33 > 0 ? Math.atan2(-m31, m33) : -Math.PI / 2;
+  } else if (m33 < 0 || m31 < 0) {
+    alpha = Math.atan2(m12, -m22);
+    beta = -Math.asin(sinBeta);
+    beta += beta >= 0 ? -Math.PI : Math.PI;
+    gamma = m33 < 0 ? Math.atan2(m31, -m33) : -Math.PI / 2;
+  } else {
+    // Gimbal lock: beta = +-pi/2, alpha and gamma share one axis
+    alpha = Math.atan2(m21, m11);
+    beta = m32 > 0 ? Math.PI / 2 : -Math.PI / 2;
+    gamma = 0;
+  }
+  if (alpha < 0) alpha += 2 * Math.PI;
+  // atan2 returns +pi for -0 inputs; keep the half-open ranges
+  if (alpha >= 2 * Math.PI) alpha -= 2 * Math.PI;
+  if (beta >= Math.PI) beta -= 2 * Math.PI;
+  if (gamma >= Math.PI / 2) gamma -= Math.PI;
+  out[CH_ALPHA] = alpha;
+  out[CH_BETA] = beta;
+  out[CH_GAMMA] = gamma;
+};
+
+export class SensorSource {
+  private sensors: any[] = [];
+  // Bumped by stop(), so a start() still waiting for permissions gives up
+  private generation = 0;
+
+  constructor(private current: Float64Array, private handlers: SensorSourceHandlers) {}
+
+  async start(frequency: number) {
+    const generation = ++this.generation;
+    await requestPermissions();
+    if (generation !== this.generation) return;
+    const w = window as any;
+    const opts = { frequency, referenceFrame: 'device' };
+    const orientation = new w.AbsoluteOrientationSensor(opts);
+    const gyro = new w.Gyroscope(opts);
+    const linear = new w.LinearAccelerationSensor(opts);
+    const accel = new w.Accelerometer(opts);
+    const c = this.current;
+
+    orientation.onreading = () => quaternionToEuler(orientation.quaternion, c);
+    // devicemotion reports rotation rate in deg/s; keep the channel unit
+    gyro.onreading = () => {
+      c[CH_RATE_ALPHA] = (gyro.z ?? 0) * RAD_TO_DEG;
+      c[CH_RATE_BETA] = (gyro.x ?? 0) * RAD_TO_DEG;
+      c[CH_RATE_GAMMA] = (gyro.y ?? 0) * RAD_TO_DEG;
+    };
+    const onAccel = (sensor: any, gravity: boolean) => () => {
+      if (this.handlers.includeGravity() !== gravity) return;
+      c[CH_AX] = sensor.x ?? 0;
+      c[CH_AY] = sensor.y ?? 0;
+      c[CH_AZ] = sensor.z ?? 0;
+      this.handlers.onSample(sensor.timestamp);
+    };
+    linear.onreading = onAccel(linear, false);
+    accel.onreading = onAccel(accel, true);
+
+    this.sensors = [orientation, gyro, linear, accel];
+    for (const s of this.sensors) {
+      s.onerror = (e: any) => this.handlers.onError(`${e.error?.name ?? 'Error'}: ${e.error?.message ?? ''}`);
+      s.start();
+    }
+  }
+
+  stop() {
+    this.generation++;
+    for (const s of this.sensors) {
+      s.onreading = null;
+      s.onerror = null;
+      s.stop();
+    }
+    this.sensors = [];
+  }
+}
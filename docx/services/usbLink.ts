@@ -0,0 +1,102 @@
+
+import {
+  SAMPLE_BATCH_MAX, SAMPLE_STRIDE, LinkStats, LogEntry, SendPolicy, WorkerEvent, WorkerRequest,
+} from './usbProtocol';
+
+export interface UsbLinkHandlers {
+  onStatus: (status: 'connected' | 'disconnected' | 'error', message?: string) => void;
+  onLog: (entries: LogEntry[], suppressed: number) => void;
+  onStats: (stats: LinkStats) => void;
+}
+
+// UI-thread side of the USB worker. Samples pushed during one task are
+// posted together as a single transferable batch at the end of it.
+export class UsbLink {
+  private worker: Worker;
+  private pool: ArrayBuffer[] = [];
+  private batch: Float64Array | null = null;
+  private count = 0;
+  private flushQueued = false;
+
+  constructor(private handlers: UsbLinkHandlers) {
+    this.worker = new Worker(new URL('./usbWorker.ts', import.meta.url), { type: 'module' });
+    this.worker.onmessage = (e: MessageEvent<WorkerEvent>) => {
+      const msg = e.data;
+      switch (msg.type) {
+        case 'status': this.handlers.onStatus(msg.status, msg.message); break;
+        case 'log': this.handlers.onLog(msg.entries, msg.suppressed); break;
+        case 'stats': this.handlers.onStats(msg.stats); break;
+        case 'recycle': this.pool.push(msg.buffer); break;
+      }
+    };
+    this.post({ type: 'codec', url: new URL('codec.wasm', document.baseURI).href });
+  }
+
+  private post(msg: WorkerRequest, transfer: Transferable[] = []) {
+    this.worker.postMessage(msg, transfer);
+  }
+
+  // The device must already be permitted (requestDevice on this page)
+  open(device: USBDevice) {
+    this.post({
+      type: 'open',
+      vendorId: device.vendorId,
+      productId: device.productId,
+      serialNumber: device.serialNumber ?? null,
+      timeOrigin: performance.timeOrigin,
+    });
+  }
+
+  close() {
+    this.post({ type: 'close' });
+  }
+
+  command(text: string) {
+    this.post({ type: 'command', text });
+  }
+
+  setSendPolicy(policy: SendPolicy) {
+    this.post({ type: 'sendPolicy', policy });
+  }
+
+  resetDiagnostics() {
+    this.post({ type: 'resetDiagnostics' });
+  }
+
+  setSampleLogging(enabled: boolean) {
+    this.post({ type: 'logSamples', enabled });
+  }
+
+  // values: alpha, beta, gamma, ax, ay, az (ImuHistory channel order)
+  pushSample(timeUs: number, values: ArrayLike<number>) {
+    if (!this.batch) {
+      const buffer = this.pool.pop() ?? new ArrayBuffer(SAMPLE_BATCH_MAX * SAMPLE_STRIDE * 8);
+      this.batch = new Float64Array(buffer);
+      this.count = 0;
+    }
+    const s = this.batch;
+    const o = this.count * SAMPLE_STRIDE;
+    s[o] = timeUs;
+    for (let k = 0; k < SAMPLE_STRIDE - 1; k++) s[o + 1 + k] = values[k];
+
+    if (++this.count === SAMPLE_BATCH_MAX) {
+      this.flush();
+    } else if (!this.flushQueued) {
+      this.flushQueued = true;
+      queueMicrotask(() => this.flush());
+    }
+  }
+
+  private flush() {
+    this.flushQueued = false;
+    if (!this.batch || this.count === 0) return;
+    const buffer = this.batch.buffer as ArrayBuffer;
+    this.post({ type: 'samples', buffer, count: this.count }, [buffer]);
+    this.batch = null;
+    this.count = 0;
+  }
+
+  terminate() {
+    this.worker.terminate();
+  }
+}
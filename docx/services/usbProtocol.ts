@@ -0,0 +1,85 @@
+
+import type { CanRxStat } from '../components/CanRxView';
+import type { ClockSyncInfo } from './clockSync';
+
+// Messages between the UI thread (usbLink.ts) and the worker that owns
+// the USBDevice (usbWorker.ts).
+//
+// Samples travel in transferable Float64Array batches, SAMPLE_STRIDE
+// values per sample: browser time (us), alpha, beta, gamma (rad),
+// ax, ay, az (m/s^2). The worker hands each buffer back with
+// 'recycle' once it is encoded, so batches do not allocate.
+export const SAMPLE_STRIDE = 7;
+export const SAMPLE_BATCH_MAX = 32;
+
+// Sample send queue in the worker. At most maxInFlight transferOut calls
+// are outstanding; samples that arrive meanwhile are coalesced into the
+// next transfer, and any older than latencyBudgetMs when it goes out
+// are dropped. Fresh data wins over complete data.
+export interface SendPolicy {
+  maxInFlight: number;
+  latencyBudgetMs: number;
+}
+
+export const DEFAULT_SEND_POLICY: SendPolicy = { maxInFlight: 2, latencyBudgetMs: 50 };
+
+export type WorkerRequest =
+  // Firmware codec built to WebAssembly (pico/wasm/build.sh); optional
+  | { type: 'codec'; url: string }
+  // USBDevice objects cannot be posted; the worker finds the same
+  // device among the origin's permitted ones
+  | { type: 'open'; vendorId: number; productId: number; serialNumber: string | null; timeOrigin: number }
+  | { type: 'close' }
+  | { type: 'samples'; buffer: ArrayBuffer; count: number }
+  | { type: 'command'; text: string }
+  | { type: 'sendPolicy'; policy: SendPolicy }
+  // Every sample line to the terminal, or only the newest per log flush
+  | { type: 'logSamples'; enabled: boolean }
+  // Zero the histograms and device counters in LinkStats
+  | { type: 'resetDiagnostics' };
+
+export interface LogEntry {
+  dir: 'tx' | 'rx';
+  text: string;
+}
+
+// Histogram bins in ms: bin i counts values below HISTOGRAM_EDGES_MS[i]
+// (and at least the previous edge), the last bin everything above
+export const HISTOGRAM_EDGES_MS = [0.5, 1, 2, 4, 8, 16, 32, 64];
+
+// From the Pico's "stat" reply, polled every DEVICE_STAT_INTERVAL_MS
+export interface DeviceStats {
+  rxRateHz: number;       // samples parsed per second, last poll
+  rxSamples: number;      // since reset
+  seqMissed: number;      // sequence gaps seen by the Pico since reset
+  usbBacklog: number;     // bytes waiting in the OUT FIFO
+  canRxDepth: number;     // CAN RX ring entries
+}
+
+export const DEVICE_STAT_INTERVAL_MS = 1000;
+
+// Aggregated once per WORKER_STATS_INTERVAL_MS
+export interface LinkStats {
+  codec: 'wasm' | 'js';   // who encodes samples and splits the stream
+  samplesSent: number;    // since connect
+  samplesDropped: number; // too old or queue full
+  txErrors: number;
+  rxBytes: number;
+  latencyAvgMs: number;   // sample time -> transferOut done, sent samples, last interval
+  latencyMaxMs: number;
+  txRateHz: number;       // samples sent per second, smoothed
+  latencyHist: number[];  // per sample, binned by its own sample time -> transferOut latency
+  rttHist: number[];      // clock sync round trips
+  device: DeviceStats | null;
+  clock: ClockSyncInfo;
+  canRx: CanRxStat[];
+}
+
+export type WorkerEvent =
+  | { type: 'status'; status: 'connected' | 'disconnected' | 'error'; message?: string }
+  // suppressed: sample lines sent but not logged since the last batch
+  | { type: 'log'; entries: LogEntry[]; suppressed: number }
+  | { type: 'stats'; stats: LinkStats }
+  | { type: 'recycle'; buffer: ArrayBuffer };
+
+export const WORKER_STATS_INTERVAL_MS = 250;
@@ -0,0 +1,472 @@
+
+// Dedicated worker that owns the Pico's USBDevice: it reads the device
+// stream, runs the clock sync, encodes and sends IMU samples and posts
+// aggregated stats, so USB timing does not depend on React renders or
+// terminal DOM updates on the UI thread.
+import type { CanRxStat } from '../components/CanRxView';
+import { DeviceStreamHandlers, DeviceStreamParser, StreamParser, USB_FRAME_CAN_RX, decodeCanRx } from './deviceStream';
+import { ClockSyncClient, alignClock, nowUs } from './clockSync';
+import { MAX_LINE_BYTES, SampleCodec, SampleEncoder } from './sampleEncoder';
+import { loadWasmCodec } from './wasmCodec';
+import {
+  DEFAULT_SEND_POLICY, DEVICE_STAT_INTERVAL_MS, HISTOGRAM_EDGES_MS, DeviceStats, SAMPLE_BATCH_MAX, SAMPLE_STRIDE, WORKER_STATS_INTERVAL_MS,
+  LogEntry, SendPolicy, WorkerEvent, WorkerRequest,
+} from './usbProtocol';
+
+// WebUSB Vendor Specific Class Constants
+const USB_VENDOR_SPECIFIC_CLASS = 0xFF;
+
+// Interface string of the IMU stream in the composite descriptor
+const IMU_STREAM_INTERFACE_NAME = 'IMU Stream';
+
+// gs_usb build (candleLight ID): vendor interface 0 belongs to the
+// kernel's gs_usb driver
+const isGsUsbDevice = (device: USBDevice) => device.vendorId === 0x1D50 && device.productId === 0x606F;
+
+// Clock sync ping period while connected
+const CLOCK_SYNC_INTERVAL_MS = 1000;
+
+// IN transfers kept in flight, each a multiple of the 64 byte packet
+// size, so the device always has somewhere to put its next packet
+const READ_DEPTH = 4;
+const READ_SIZE = 512;
+
+// Read errors back off from 1 ms, doubling up to this
+const READ_BACKOFF_MAX_MS = 100;
+
+// Log entries are batched to the UI at this period
+const LOG_FLUSH_MS = 50;
+
+const usb = (navigator as any).usb;
+const post = (msg: WorkerEvent, transfer: Transferable[] = []) => (self as any).postMessage(msg, transfer);
+
+let device: USBDevice | null = null;
+let endpointIn = 0;
+let endpointOut = 0;
+let reading = false;
+let timers: number[] = [];
+
+const encoder = new TextEncoder();
+// TypeScript codec until the firmware's WASM build has loaded
+let sampleCodec: SampleCodec = new SampleEncoder();
+let createStreamParser = (h: DeviceStreamHandlers): StreamParser => new DeviceStreamParser(h);
+let codecKind: 'wasm' | 'js' = 'js';
+let codecReady: Promise<void> = Promise.resolve();
+const textDecoder = new TextDecoder();
+// Unless every sample is logged, the last sample line sent is shown once
+// per log flush and the rest are only counted
+let logSamples = false;
+const lastTx = new Uint8Array(MAX_LINE_BYTES);
+let lastTxLength = 0;
+let suppressedTx = 0;
+const clockSync = new ClockSyncClient();
+const canStats = new Map<number, CanRxStat>();
+let pendingLog: LogEntry[] = [];
+
+// Send queue: samples waiting for a free transfer slot, oldest first
+let policy: SendPolicy = { ...DEFAULT_SEND_POLICY };
+const pending = new Float64Array(SAMPLE_BATCH_MAX * SAMPLE_STRIDE);
+let pendingHead = 0;
+let pendingCount = 0;
+let sendsInFlight = 0;
+// Capture times of the samples in each transfer in flight
+const sendTimesPool: Float64Array[] = [];
+
+// Sequence number of the next sample line, for loss counting on the Pico
+let txSeq = 0;
+
+// Diagnostics: rates, histograms and the Pico's "stat" replies
+let txRateHz = 0;
+let lastStatsSent = 0;
+const latencyHist: number[] = HISTOGRAM_EDGES_MS.map(() => 0).concat(0);
+const rttHist: number[] = HISTOGRAM_EDGES_MS.map(() => 0).concat(0);
+let deviceStats: DeviceStats | null = null;
+let lastStatUs = 0;
+
+let samplesSent = 0;
+let samplesDropped = 0;
+let txErrors = 0;
+let rxBytes = 0;
+let latencySumMs = 0;
+let latencyCount = 0;
+let latencyMaxMs = 0;
+
+const log = (dir: LogEntry['dir'], text: string) => pendingLog.push({ dir, text });
+
+const flushLog = () => {
+  if (lastTxLength > 0) {
+    log('tx', textDecoder.decode(lastTx.subarray(0, lastTxLength - 1)));
+    lastTxLength = 0;
+    suppressedTx--;
+  }
+  if (pendingLog.length === 0 && suppressedTx === 0) return;
+  post({ type: 'log', entries: pendingLog, suppressed: suppressedTx });
+  pendingLog = [];
+  suppressedTx = 0;
+};
+
+const logSampleLines = (bytes: Uint8Array, count: number) => {
+  if (logSamples) {
+    for (const line of textDecoder.decode(bytes).split('\n')) {
+      if (line) log('tx', line);
+    }
+    return;
+  }
+  // Terminal shows the newest line of the transfer
+  const lastLine = bytes.lastIndexOf(0x0A, bytes.length - 2) + 1;
+  lastTxLength = bytes.length - lastLine;
+  lastTx.set(bytes.subarray(lastLine));
+  suppressedTx += count;
+};
+
+const histBin = (ms: number) => {
+  let i = 0;
+  while (i < HISTOGRAM_EDGES_MS.length && ms >= HISTOGRAM_EDGES_MS[i]) i++;
+  return i;
+};
+
+const resetDiagnostics = () => {
+  latencyHist.fill(0);
+  rttHist.fill(0);
+  deviceStats = null;
+  lastStatUs = 0;
+};
+
+// STAT,<samples>,<seq missed>,<usb backlog>,<can rx depth>, counts since
+// the previous poll; false if the line is something else
+const handleStatLine = (line: string) => {
+  if (!line.startsWith('STAT,')) return false;
+  const [samples, missed, backlog, canDepth] = line.slice(5).split(',').map(Number);
+  const now = nowUs();
+  const dt = lastStatUs ? (now - lastStatUs) / 1e6 : 0;
+  lastStatUs = now;
+  deviceStats = {
+    rxRateHz: dt > 0 ? samples / dt : 0,
+    rxSamples: (deviceStats?.rxSamples ?? 0) + samples,
+    seqMissed: (deviceStats?.seqMissed ?? 0) + missed,
+    usbBacklog: backlog,
+    canRxDepth: canDepth,
+  };
+  return true;
+};
+
+const postStats = () => {
+  const inst = (samplesSent - lastStatsSent) * 1000 / WORKER_STATS_INTERVAL_MS;
+  lastStatsSent = samplesSent;
+  txRateHz = txRateHz * 0.75 + inst * 0.25;
+  post({
+    type: 'stats',
+    stats: {
+      codec: codecKind,
+      samplesSent,
+      samplesDropped,
+      txErrors,
+      rxBytes,
+      latencyAvgMs: latencyCount ? latencySumMs / latencyCount : 0,
+      latencyMaxMs,
+      txRateHz,
+      latencyHist: latencyHist.slice(),
+      rttHist: rttHist.slice(),
+      device: deviceStats,
+      clock: { ...clockSync.info },
+      canRx: Array.from(canStats.values()).sort((a, b) => a.id - b.id),
+    },
+  });
+  latencySumMs = 0;
+  latencyCount = 0;
+  latencyMaxMs = 0;
+};
+
+const sendText = (text: string) => {
+  if (!device || !device.opened) return Promise.reject(new Error('not connected'));
+  return device.transferOut(endpointOut, encoder.encode(text));
+};
+
+// CAN RX batches update per-ID stats
+const handleCanRx = (payload: Uint8Array) => {
+  for (const f of decodeCanRx(payload)) {
+    const key = f.extended ? f.id + 0x20000000 : f.id;
+    const prev = canStats.get(key);
+    let rateHz = 0;
+    if (prev) {
+      const dt = (f.timestampUs - prev.lastTimestampUs) >>> 0; // u32 wrap
+      const inst = dt > 0 ? 1e6 / dt : prev.rateHz;
+      rateHz = prev.rateHz ? prev.rateHz * 0.9 + inst * 0.1 : inst;
+    }
+    canStats.set(key, {
+      id: f.id,
+      extended: f.extended,
+      count: (prev?.count ?? 0) + 1,
+      rateHz,
+      lastData: f.data,
+      lastTimestampUs: f.timestampUs,
+    });
+  }
+};
+
+// Results are taken in submission order (transfers on one endpoint
+// complete in order), and the parser reassembles frames and lines split
+// across them
+const startReading = async () => {
+  if (reading || !device) return;
+  reading = true;
+  const dev = device;
+  const ep = endpointIn;
+  const parser = createStreamParser({
+    onLine: (line) => {
+      const exchanges = clockSync.info.exchanges;
+      if (clockSync.handleLine(line)) {
+        if (clockSync.info.exchanges !== exchanges) rttHist[histBin(clockSync.info.rttMs)]++;
+      } else if (!handleStatLine(line)) {
+        log('rx', line);
+      }
+    },
+    onFrame: (type, payload) => {
+      if (type === USB_FRAME_CAN_RX) handleCanRx(payload);
+    },
+  });
+
+  const inFlight: Promise<USBInTransferResult>[] = [];
+  let backoffMs = 0;
+
+  while (reading && dev.opened) {
+    while (inFlight.length < READ_DEPTH) {
+      const p = dev.transferIn(ep, READ_SIZE);
+      p.catch(() => {}); // left over when the loop stops
+      inFlight.push(p);
+    }
+    try {
+      const result = await inFlight.shift()!;
+      if (result.status === 'ok' && result.data) {
+        rxBytes += result.data.byteLength;
+        parser.feed(new Uint8Array(result.data.buffer, result.data.byteOffset, result.data.byteLength));
+        backoffMs = 0;
+      } else if (result.status === 'stall') {
+        await dev.clearHalt('in', ep);
+      }
+    } catch (error) {
+      if (!reading || !dev.opened) break;
+      backoffMs = Math.min(backoffMs ? backoffMs * 2 : 1, READ_BACKOFF_MAX_MS);
+      await new Promise(r => setTimeout(r, backoffMs));
+    }
+  }
+  reading = false;
+};
+
+const pendingTime = (i: number) => pending[((pendingHead + i) % SAMPLE_BATCH_MAX) * SAMPLE_STRIDE];
+
+const dropOldest = (n: number) => {
+  pendingHead = (pendingHead + n) % SAMPLE_BATCH_MAX;
+  pendingCount -= n;
+  samplesDropped += n;
+};
+
+// Queue a batch from the UI; a full queue loses its oldest samples
+const queueSamples = (buffer: ArrayBuffer, count: number) => {
+  const s = new Float64Array(buffer);
+  for (let i = 0; i < count; i++) {
+    if (pendingCount === SAMPLE_BATCH_MAX) dropOldest(1);
+    const slot = (pendingHead + pendingCount++) % SAMPLE_BATCH_MAX;
+    pending.set(s.subarray(i * SAMPLE_STRIDE, (i + 1) * SAMPLE_STRIDE), slot * SAMPLE_STRIDE);
+  }
+  post({ type: 'recycle', buffer }, [buffer]);
+  pumpSamples();
+};
+
+// Sends everything pending as one transfer while a slot is free. Runs
+// again whenever a transfer completes.
+const pumpSamples = () => {
+  while (pendingCount > 0 && sendsInFlight < policy.maxInFlight && device && device.opened) {
+    const now = nowUs();
+    let stale = 0;
+    while (stale < pendingCount && now - pendingTime(stale) > policy.latencyBudgetMs * 1000) stale++;
+    if (stale > 0) dropOldest(stale);
+    if (pendingCount === 0) return;
+
+    const count = pendingCount;
+    const input = sampleCodec.input;
+    // Capture times stay with the transfer so each sample is binned by
+    // its own latency; the codec input is reused by the next send
+    const times = sendTimesPool.pop() ?? new Float64Array(SAMPLE_BATCH_MAX);
+    for (let i = 0; i < count; i++) {
+      const from = ((pendingHead + i) % SAMPLE_BATCH_MAX) * SAMPLE_STRIDE;
+      for (let k = 0; k < SAMPLE_STRIDE; k++) input[i * SAMPLE_STRIDE + k] = pending[from + k];
+      times[i] = pending[from];
+    }
+    pendingHead = (pendingHead + count) % SAMPLE_BATCH_MAX;
+    pendingCount = 0;
+
+    const bytes = sampleCodec.encode(count, txSeq);
+    txSeq = (txSeq + count) >>> 0;
+    sendsInFlight++;
+    device.transferOut(endpointOut, bytes)
+      .then(() => {
+        const t = nowUs();
+        samplesSent += count;
+        latencyCount += count;
+        for (let i = 0; i < count; i++) {
+          const ms = (t - times[i]) / 1000;
+          latencySumMs += ms;
+          if (ms > latencyMaxMs) latencyMaxMs = ms;
+          latencyHist[histBin(ms)]++;
+        }
+      })
+      .catch(e => {
+        txErrors++;
+        console.error("TX Fail", e);
+      })
+      .finally(() => {
+        sendTimesPool.push(times);
+        sendsInFlight--;
+        pumpSamples();
+      });
+    logSampleLines(bytes, count);
+  }
+};
+
+const close = async (status: 'disconnected' | 'error', message?: string) => {
+  reading = false;
+  timers.forEach(t => clearInterval(t));
+  timers = [];
+  const dev = device;
+  device = null;
+  if (dev && dev.opened) {
+    try { await dev.close(); } catch (e) { console.warn(e); }
+  }
+  flushLog();
+  post({ type: 'status', status, message });
+};
+
+const open = async (req: Extract<WorkerRequest, { type: 'open' }>) => {
+  if (!usb) {
+    post({ type: 'status', status: 'error', message: 'WebUSB is not available in workers on this browser' });
+    return;
+  }
+  alignClock(req.timeOrigin);
+  await codecReady;
+  try {
+    const devices: USBDevice[] = await usb.getDevices();
+    const dev = devices.find(d =>
+      d.vendorId === req.vendorId && d.productId === req.productId &&
+      (req.serialNumber === null || d.serialNumber === req.serialNumber));
+    if (!dev) throw new Error("Device not found");
+
+    await dev.open();
+    if (dev.configuration === null) {
+      await dev.selectConfiguration(1);
+    }
+
+    const config = dev.configuration;
+    let vendorInterface = config?.interfaces.find(i =>
+      i.alternates[0].interfaceName === IMU_STREAM_INTERFACE_NAME
+    ) ?? config?.interfaces.find(i =>
+      i.alternates[0].interfaceClass === USB_VENDOR_SPECIFIC_CLASS &&
+      !(isGsUsbDevice(dev) && i.interfaceNumber === 0)
+    );
+
+    if (!vendorInterface && config?.interfaces.length) {
+      vendorInterface = config.interfaces[0];
+    }
+
+    if (!vendorInterface) throw new Error("Vendor Interface not found");
+
+    const ifaceNum = vendorInterface.interfaceNumber;
+    await dev.claimInterface(ifaceNum);
+
+    // Enable DTR (SET_CONTROL_LINE_STATE)
+    await dev.controlTransferOut({
+      requestType: 'class',
+      recipient: 'interface',
+      request: 0x22,
+      value: 0x01,
+      index: ifaceNum
+    });
+
+    const endpoints = vendorInterface.alternates[0].endpoints;
+    const inEp = endpoints.find(e => e.direction === 'in');
+    const outEp = endpoints.find(e => e.direction === 'out');
+
+    if (!inEp || !outEp) throw new Error("Endpoints not found");
+
+    endpointIn = inEp.endpointNumber;
+    endpointOut = outEp.endpointNumber;
+    device = dev;
+
+    samplesSent = 0;
+    samplesDropped = 0;
+    txErrors = 0;
+    pendingCount = 0;
+    lastStatsSent = 0;
+    txRateHz = 0;
+    rxBytes = 0;
+    resetDiagnostics();
+    canStats.clear();
+    clockSync.reset();
+
+    usb.ondisconnect = (event: USBConnectionEvent) => {
+      if (event.device === device) close('disconnected', 'removed');
+    };
+
+    post({ type: 'status', status: 'connected' });
+    startReading();
+
+    // Clock sync: periodic ping exchange, kept out of the terminal
+    timers.push(self.setInterval(() => {
+      sendText(`${clockSync.nextPing()}\n`).catch(e => console.error("TX Fail", e));
+    }, CLOCK_SYNC_INTERVAL_MS));
+    // Device counters and queue depths, kept out of the terminal
+    timers.push(self.setInterval(() => {
+      sendText('stat\n').catch(e => console.error("TX Fail", e));
+    }, DEVICE_STAT_INTERVAL_MS));
+    timers.push(self.setInterval(postStats, WORKER_STATS_INTERVAL_MS));
+    timers.push(self.setInterval(flushLog, LOG_FLUSH_MS));
+  } catch (err: any) {
+    console.error(err);
+    await close('error', err.message);
+  }
+};
+
+self.onmessage = (e: MessageEvent<WorkerRequest>) => {
+  const msg = e.data;
+  switch (msg.type) {
+    case 'codec':
+      codecReady = loadWasmCodec(msg.url)
+        .then(codec => {
+          sampleCodec = codec.encoder;
+          createStreamParser = codec.createParser;
+          codecKind = 'wasm';
+        })
+        .catch(e => console.warn("WASM codec unavailable, using the TypeScript one", e));
+      break;
+    case 'open':
+      open(msg);
+      break;
+    case 'close':
+      close('disconnected');
+      break;
+    case 'samples':
+      if (device) {
+        queueSamples(msg.buffer, msg.count);
+      } else {
+        post({ type: 'recycle', buffer: msg.buffer }, [msg.buffer]);
+      }
+      break;
+    case 'sendPolicy':
+      policy = msg.policy;
+      pumpSamples();
+      break;
+    case 'resetDiagnostics':
+      resetDiagnostics();
+      break;
+    case 'logSamples':
+      logSamples = msg.enabled;
+      break;
+    case 'command':
+      // A new acceptance list starts the per-ID stats over
+      if (msg.text.startsWith('rxids')) canStats.clear();
+      sendText(`${msg.text}\n`)
+        .then(() => log('tx', msg.text))
+        .catch(e => console.error("TX Fail", e));
+      break;
+  }
+};
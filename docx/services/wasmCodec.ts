@@ -0,0 +1,84 @@
+import { DeviceStreamHandlers, StreamParser } from './deviceStream';
+import { SampleCodec } from './sampleEncoder';
+import { SAMPLE_BATCH_MAX, SAMPLE_STRIDE } from './usbProtocol';
+
+// The Pico's codec (imuFormatCsv, usbFrameDecode) built to WebAssembly by
+// pico/wasm/build.sh, so the browser encodes and splits the stream with
+// the firmware's own code. See pico/wasm/codec_wasm.cpp for the exports.
+// The module has fixed buffers and never grows its memory, so views on
+// it stay valid.
+interface CodecExports {
+  memory: WebAssembly.Memory;
+  codec_samples(): number;
+  codec_out(): number;
+  codec_in(): number;
+  codec_events(): number;
+  codec_crc_errors(): number;
+  codec_encode(count: number, seq: number): number;
+  codec_reset(): void;
+  codec_feed(n: number): number;
+}
+
+const CODEC_IN_SIZE = 512;
+const EVENT_LINE = 0;
+
+export interface WasmCodec {
+  encoder: SampleCodec;
+  createParser(handlers: DeviceStreamHandlers): StreamParser;
+}
+
+export const loadWasmCodec = async (url: string): Promise<WasmCodec> => {
+  const module = await WebAssembly.compileStreaming(fetch(url));
+  // Standalone builds may still import a few WASI calls that the codec
+  // never reaches; stub whatever is asked for
+  const imports: Record<string, Record<string, () => number>> = {};
+  for (const imp of WebAssembly.Module.imports(module)) {
+    if (imp.kind !== 'function') continue;
+    (imports[imp.module] ??= {})[imp.name] = () => 0;
+  }
+  const instance = await WebAssembly.instantiate(module, imports);
+  const x = instance.exports as unknown as CodecExports;
+  (instance.exports as any)._initialize?.();
+
+  const heap = new Uint8Array(x.memory.buffer);
+  const input = new Float64Array(x.memory.buffer, x.codec_samples(), SAMPLE_BATCH_MAX * SAMPLE_STRIDE);
+  const out = x.codec_out();
+  const inBytes = heap.subarray(x.codec_in(), x.codec_in() + CODEC_IN_SIZE);
+  const events = x.codec_events();
+  const decoder = new TextDecoder();
+
+  const encoder: SampleCodec = {
+    input,
+    encode: (count, seq) => heap.subarray(out, out + x.codec_encode(count, seq >>> 0)),
+  };
+
+  // One decoder state in the module, so one parser at a time
+  const createParser = (handlers: DeviceStreamHandlers): StreamParser => {
+    x.codec_reset();
+    return {
+      get crcErrors() { return x.codec_crc_errors(); },
+      feed(bytes: Uint8Array) {
+        for (let off = 0; off < bytes.length; off += CODEC_IN_SIZE) {
+          const chunk = bytes.subarray(off, off + CODEC_IN_SIZE);
+          inBytes.set(chunk);
+          const end = events + x.codec_feed(chunk.length);
+          for (let p = events; p < end;) {
+            const kind = heap[p];
+            const type = heap[p + 1];
+            const len = heap[p + 2];
+            const data = heap.subarray(p + 3, p + 3 + len);
+            p += 3 + len;
+            if (kind === EVENT_LINE) {
+              const text = decoder.decode(data).trim();
+              if (text) handlers.onLine(text);
+            } else {
+              handlers.onFrame(type, data.slice());
+            }
+          }
+        }
+      },
+    };
+  };
+
+  return { encoder, createParser };
+};
@@ -29,3 +29,11 @@ export interface SerialSettings {
   baudRate: number;
   bufferSize: number;
 }
+
+export interface CanRxFrame {
+  timestampUs: number; // device micros() at reception
+  id: number;
+  extended: boolean;
+  dlc: number;
+  data: Uint8Array;
+}
@@ -0,0 +1,177 @@
+#include "can_filter.h"
+#include <string.h>
+
+static const uint16_t kIdMask = 0x7FF;
+static const size_t kMaxIds = 32;
+static const size_t kExhaustiveIds = 10;
+static const uint8_t kBankFilters[2] = {2, 4};
+
+// One bank (mask + up to `slots` filter values) for a set of IDs
+struct Bank {
+  uint16_t mask;
+  uint16_t values[4];
+  uint8_t used;
+  uint32_t cost;  // IDs accepted by this bank
+};
+
+static int popcount11(uint16_t v) {
+  int n = 0;
+  for (v &= kIdMask; v; v &= (uint16_t)(v - 1)) n++;
+  return n;
+}
+
+// Distinct values of ids & mask, written to `values` (up to `cap`);
+// returns the full distinct count even when it exceeds cap.
+static size_t distinctMasked(const uint16_t* ids, size_t n, uint16_t mask,
+                             uint16_t* values, size_t cap) {
+  size_t distinct = 0;
+  uint16_t seen[kMaxIds];
+  for (size_t i = 0; i < n; i++) {
+    const uint16_t v = ids[i] & mask;
+    bool dup = false;
+    for (size_t k = 0; k < distinct; k++) {
+      if (seen[k] == v) { dup = true; break; }
+    }
+    if (dup) continue;
+    seen[distinct] = v;
+    if (distinct < cap) values[distinct] = v;
+    distinct++;
+  }
+  return distinct;
+}
+
+static void solveBank(const uint16_t* ids, size_t n, uint8_t slots, Bank* bank) {
+  bank->mask = kIdMask;
+  bank->used = 0;
+  bank->cost = 0;
+  if (n == 0) return;
+
+  uint16_t tmp[4];
+  size_t distinct = distinctMasked(ids, n, bank->mask, tmp, 0);
+  while (distinct > slots) {
+    // Drop the mask bit that merges the most values
+    uint16_t best_mask = 0;
+    size_t best = (size_t)-1;
+    for (int b = 0; b < 11; b++) {
+      const uint16_t bit = (uint16_t)(1u << b);
+      if (!(bank->mask & bit)) continue;
+      const uint16_t m = bank->mask & (uint16_t)~bit;
+      const size_t d = distinctMasked(ids, n, m, tmp, 0);
+      if (d < best) { best = d; best_mask = m; }
+    }
+    bank->mask = best_mask;
+    distinct = best;
+  }
+  bank->used = (uint8_t)distinctMasked(ids, n, bank->mask, bank->values, 4);
+  bank->cost = (uint32_t)bank->used << (11 - popcount11(bank->mask));
+}
+
+// Cost of assigning ids with bit i of `sel` set to bank 0, rest to bank 1
+static uint32_t splitCost(const uint16_t* ids, size_t n, uint32_t sel, Bank banks[2]) {
+  uint16_t part[2][kMaxIds];
+  size_t len[2] = {0, 0};
+  for (size_t i = 0; i < n; i++) {
+    const int b = (sel >> i) & 1 ? 0 : 1;
+    part[b][len[b]++] = ids[i];
+  }
+  for (int b = 0; b < 2; b++) solveBank(part[b], len[b], kBankFilters[b], &banks[b]);
+  return banks[0].cost + banks[1].cost;
+}
+
+bool canFilterAccepts(const CanFilterConfig& cfg, uint16_t id) {
+  if (cfg.accept_all) return true;
+  for (int n = 0; n < 6; n++) {
+    const uint16_t m = cfg.mask[n < 2 ? 0 : 1];
+    if ((id & m) == (cfg.filter[n] & m)) return true;
+  }
+  return false;
+}
+
+bool canFilterOptimize(const uint32_t* ids_in, size_t count, CanFilterConfig* out) {
+  memset(out, 0, sizeof(*out));
+  out->accept_all = true;
+  out->accepted = kIdMask + 1;
+  if (count == 0 || count > kMaxIds) return false;
+
+  // Sorted, de-duplicated standard IDs
+  uint16_t ids[kMaxIds];
+  size_t n = 0;
+  for (size_t i = 0; i < count; i++) {
+    if (ids_in[i] > kIdMask) return false;
+    const uint16_t v = (uint16_t)ids_in[i];
+    size_t k = n;
+    bool dup = false;
+    for (size_t j = 0; j < n; j++) if (ids[j] == v) dup = true;
+    if (dup) continue;
+    while (k > 0 && ids[k - 1] > v) { ids[k] = ids[k - 1]; k--; }
+    ids[k] = v;
+    n++;
+  }
+
+  Bank best[2];
+  uint32_t best_cost = (uint32_t)-1;
+  Bank banks[2];
+  uint32_t best_sel = 0;
+
+  if (n <= 6) {
+    // Exact: two IDs in bank 0, the rest in bank 1
+    best_sel = n >= 2 ? 0x3 : 0x1;
+    best_cost = splitCost(ids, n, best_sel, best);
+  } else if (n <= kExhaustiveIds) {
+    for (uint32_t sel = 0; sel < (1u << n); sel++) {
+      const uint32_t c = splitCost(ids, n, sel, banks);
+      if (c < best_cost) { best_cost = c; best_sel = sel; memcpy(best, banks, sizeof(best)); }
+    }
+  } else {
+    // Contiguous splits of the sorted list, either bank taking the low IDs
+    for (size_t cut = 0; cut <= n; cut++) {
+      const uint32_t low = cut >= 32 ? 0xFFFFFFFFu : ((1u << cut) - 1);
+      const uint32_t all = n >= 32 ? 0xFFFFFFFFu : ((1u << n) - 1);
+      const uint32_t cands[2] = {low, all & ~low};
+      for (uint32_t sel : cands) {
+        const uint32_t c = splitCost(ids, n, sel, banks);
+        if (c < best_cost) { best_cost = c; best_sel = sel; memcpy(best, banks, sizeof(best)); }
+      }
+    }
+    // Move single IDs between banks while that helps
+    bool improved = true;
+    for (int round = 0; improved && round < 64; round++) {
+      improved = false;
+      for (size_t i = 0; i < n; i++) {
+        const uint32_t sel = best_sel ^ (1u << i);
+        const uint32_t c = splitCost(ids, n, sel, banks);
+        if (c < best_cost) {
+          best_cost = c; best_sel = sel; memcpy(best, banks, sizeof(best));
+          improved = true;
+        }
+      }
+    }
+  }
+
+  // Unused filter slots repeat a used value of either bank so they never
+  // widen the accepted set
+  const uint16_t fallback = best[0].used ? best[0].values[0] : best[1].values[0];
+  for (int b = 0; b < 2; b++) {
+    if (!best[b].used) {
+      best[b].mask = kIdMask;
+      best[b].values[0] = fallback;
+      best[b].used = 1;
+    }
+  }
+  int slot = 0;
+  for (int b = 0; b < 2; b++) {
+    out->mask[b] = best[b].mask;
+    for (int i = 0; i < kBankFilters[b]; i++) {
+      const int v = i < best[b].used ? i : 0;
+      out->filter[slot++] = best[b].values[v];
+    }
+  }
+  out->accept_all = false;
+
+  uint16_t accepted = 0;
+  for (uint16_t id = 0; id <= kIdMask; id++) {
+    if (canFilterAccepts(*out, id)) accepted++;
+  }
+  out->accepted = accepted;
+  return true;
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// MCP2515 acceptance filter layout: RXM0 is shared by RXF0..1 (RXB0),
+// RXM1 by RXF2..5 (RXB1). A frame is accepted when, for some filter n
+// with mask m, (id & m) == (filter[n] & m).
+struct CanFilterConfig {
+  uint16_t mask[2];
+  uint16_t filter[6];
+  uint16_t accepted;    // standard IDs that pass, requested ones included
+  bool accept_all;      // filters disabled (RXM = 11)
+};
+
+// Pick masks and filters covering every requested standard ID while
+// letting through as few other IDs as possible. Up to six IDs map to
+// exact filters; larger sets are split between the two banks (exhaustive
+// for up to 10 IDs, sorted splits plus single-ID moves beyond that) with
+// each bank's mask found by dropping the ID bits that merge the most
+// values. Returns false (and accept_all) for an empty set, more than 32
+// IDs or IDs above 0x7FF.
+bool canFilterOptimize(const uint32_t* ids, size_t count, CanFilterConfig* out);
+
+// True if `id` passes the configuration (used for checks and reporting)
+bool canFilterAccepts(const CanFilterConfig& cfg, uint16_t id);
@@ -0,0 +1,11 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// Classic CAN 2.0 frame as seen by the gateway (no FD, no RTR payload)
+struct CanFrame {
+  uint32_t id;        // 11-bit or 29-bit identifier
+  uint8_t  dlc;       // 0..8
+  bool     extended;  // true: 29-bit identifier
+  uint8_t  data[8];
+};
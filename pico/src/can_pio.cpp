@@ -0,0 +1,100 @@
+#ifdef CAN_TRANSPORT_PIO
+#include <Arduino.h>
+#include <string.h>
+#include "hardware/irq.h"
+#include "hardware/clocks.h"
+#include "hardware/timer.h"
+extern "C" {
+#include "can2040.h"
+}
+#include "can_pio.h"
+
+// can2040 keeps its state in a caller-owned struct; only one instance
+static struct can2040 cbus;
+static PioCan* instance = nullptr;
+
+void PioCan::irqHandler() {
+  can2040_pio_irq_handler(&cbus);
+}
+
+void PioCan::callback(struct can2040* cd, uint32_t notify, struct can2040_msg* msg) {
+  (void)cd;
+  if (!instance) return;
+  if (notify & CAN2040_NOTIFY_ERROR) {
+    instance->errors_++;
+    return;
+  }
+  if (notify & CAN2040_NOTIFY_TX) {
+    instance->tx_done_++;
+    return;
+  }
+  if (!(notify & CAN2040_NOTIFY_RX) || (msg->id & CAN2040_ID_RTR)) return;
+
+  CanFrame frame;
+  frame.extended = (msg->id & CAN2040_ID_EFF) != 0;
+  frame.id = msg->id & (frame.extended ? 0x1FFFFFFF : 0x7FF);
+  if (!instance->accepts(frame.id)) return;
+  frame.dlc = msg->dlc > 8 ? 8 : (uint8_t)msg->dlc;
+  memcpy(frame.data, msg->data, 8);
+  instance->rx_.push(frame);
+}
+
+bool PioCan::accepts(uint32_t id) const {
+  const uint8_t n = id_count_;
+  if (n == 0) return true;
+  for (uint8_t i = 0; i < n; i++) {
+    if (ids_[i] == id) return true;
+  }
+  return false;
+}
+
+bool PioCan::setAcceptanceIds(const uint32_t* ids, uint8_t count) {
+  if (count > kMaxIds) return false;
+  id_count_ = 0;  // accept-all while the list is rewritten
+  for (uint8_t i = 0; i < count; i++) ids_[i] = ids[i];
+  id_count_ = count;
+  return true;
+}
+
+bool PioCan::begin(uint32_t bitrate) {
+  instance = this;
+  can2040_setup(&cbus, pio_num_);
+  can2040_callback_config(&cbus, callback);
+
+  const uint32_t irq = pio_num_ == 0 ? PIO0_IRQ_0 : PIO1_IRQ_0;
+  irq_set_exclusive_handler(irq, irqHandler);
+  irq_set_priority(irq, PICO_DEFAULT_IRQ_PRIORITY - 1);
+  irq_set_enabled(irq, true);
+
+  can2040_start(&cbus, clock_get_hz(clk_sys), bitrate, gpio_rx_, gpio_tx_);
+  return true;
+}
+
+bool PioCan::sendBatch(const CanFrame* frames, uint8_t count) {
+  for (uint8_t i = 0; i < count; i++) {
+    // can2040 queues in order; a full queue means the bus is saturated
+    if (!can2040_check_transmit(&cbus)) return false;
+    struct can2040_msg msg;
+    msg.id = frames[i].extended ? ((frames[i].id & 0x1FFFFFFF) | CAN2040_ID_EFF)
+                                : (frames[i].id & 0x7FF);
+    msg.dlc = frames[i].dlc > 8 ? 8 : frames[i].dlc;
+    memcpy(msg.data, frames[i].data, 8);
+    if (can2040_transmit(&cbus, &msg) < 0) return false;
+    tx_queued_++;
+  }
+  return true;
+}
+
+bool PioCan::waitTxDone() {
+  const uint32_t start = time_us_32();
+  while (tx_done_ != tx_queued_) {
+    if (time_us_32() - start > 2000) {
+      // Resync so one lost confirmation does not fail every later wait
+      tx_queued_ = tx_done_;
+      return false;
+    }
+  }
+  return true;
+}
+
+#endif // CAN_TRANSPORT_PIO
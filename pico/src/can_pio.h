@@ -0,0 +1,47 @@
+#pragma once
+#ifdef CAN_TRANSPORT_PIO
+#include "can_transport.h"
+#include "ring_buffer.h"
+
+struct can2040;
+struct can2040_msg;
+
+// CAN controller implemented in RP2350 PIO state machines (can2040).
+// Talks to a plain transceiver on two GPIOs; no SPI hop, no MCP2515.
+class PioCan : public CanTransport {
+public:
+  PioCan(uint32_t pio_num, uint32_t gpio_rx, uint32_t gpio_tx)
+    : pio_num_(pio_num), gpio_rx_(gpio_rx), gpio_tx_(gpio_tx) {}
+
+  bool begin(uint32_t bitrate) override;
+  bool sendBatch(const CanFrame* frames, uint8_t count) override;
+  // can2040 sends in queue order, so the last batch is done once every
+  // queued frame has been confirmed by the TX notification
+  bool waitTxDone() override;
+  const char* name() const override { return "pio"; }
+  // Frames are queued from the PIO IRQ; the ID filter is applied there
+  // in software.
+  bool receive(CanFrame* frame) override { return rx_.pop(frame); }
+  bool setAcceptanceIds(const uint32_t* ids, uint8_t count) override;
+  static constexpr uint8_t kMaxIds = 32;
+
+  // Bus errors seen by can2040 since begin() / resetStats()
+  uint32_t errors() const { return errors_; }
+  void resetStats() { errors_ = 0; }
+
+private:
+  static void irqHandler();
+  static void callback(struct can2040* cd, uint32_t notify, struct can2040_msg* msg);
+
+  bool accepts(uint32_t id) const;
+
+  uint32_t pio_num_, gpio_rx_, gpio_tx_;
+  RingBuffer<CanFrame, 32> rx_;
+  uint32_t ids_[kMaxIds];
+  volatile uint8_t id_count_ = 0;
+  volatile uint32_t errors_ = 0;
+  uint32_t tx_queued_ = 0;
+  volatile uint32_t tx_done_ = 0;
+};
+
+#endif // CAN_TRANSPORT_PIO
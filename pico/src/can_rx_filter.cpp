@@ -0,0 +1,28 @@
+#include "can_rx_filter.h"
+#include <string.h>
+
+bool CanRxFilter::setIds(const uint32_t* ids, uint8_t count) {
+  if (count > kMaxIds || sessions_ > 0) return false;
+  // The controller checks the list; keep the old one if it refuses
+  if (!can_.setAcceptanceIds(ids, count)) return false;
+  if (count) memcpy(ids_, ids, count * sizeof(ids_[0]));
+  count_ = count;
+  return true;
+}
+
+bool CanRxFilter::open() {
+  if (sessions_ == 0 && !can_.setAcceptanceIds(nullptr, 0)) return false;
+  sessions_++;
+  return true;
+}
+
+bool CanRxFilter::close() {
+  if (sessions_ == 0) return true;
+  if (--sessions_ > 0) return true;
+  return apply();
+}
+
+bool CanRxFilter::apply() {
+  if (sessions_ > 0) return can_.setAcceptanceIds(nullptr, 0);
+  return can_.setAcceptanceIds(count_ ? ids_ : nullptr, count_);
+}
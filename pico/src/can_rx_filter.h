@@ -0,0 +1,34 @@
+#pragma once
+#include "can_transport.h"
+
+// Acceptance filter of the controller shared by the gateway and the host
+// adapters (slcan, gs_usb). The gateway owns the ID list ("rxids"); an
+// adapter session wants every frame, so it opens the filter while it is
+// running and the gateway's list comes back when the last session ends.
+class CanRxFilter {
+public:
+  static constexpr uint8_t kMaxIds = 32;
+
+  explicit CanRxFilter(CanTransport& can) : can_(can) {}
+
+  // Gateway list (count 0: accept all). Applied at once unless a session
+  // holds the filter open, in which case it is refused: narrowing the bus
+  // under a host adapter would hide frames from it.
+  bool setIds(const uint32_t* ids, uint8_t count);
+  // Session start / end. open() accepts every frame; close() of the last
+  // session restores the gateway list.
+  bool open();
+  bool close();
+  // Program the controller again, e.g. after begin() reset it
+  bool apply();
+
+  bool isOpen() const { return sessions_ > 0; }
+  uint8_t count() const { return count_; }
+  const uint32_t* ids() const { return ids_; }
+
+private:
+  CanTransport& can_;
+  uint32_t ids_[kMaxIds];
+  uint8_t count_ = 0;
+  uint8_t sessions_ = 0;
+};
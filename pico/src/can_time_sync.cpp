@@ -0,0 +1,104 @@
+#include "can_time_sync.h"
+#include <string.h>
+
+void canTsyncPackSync(uint8_t seq, CanFrame* frame) {
+  frame->id = CAN_TSYNC_ID;
+  frame->dlc = 2;
+  frame->extended = false;
+  memset(frame->data, 0, 8);
+  frame->data[0] = CAN_TSYNC_SYNC;
+  frame->data[1] = seq;
+}
+
+void canTsyncPackFup(uint8_t seq, uint64_t sync_end_us, CanFrame* frame) {
+  frame->id = CAN_TSYNC_ID;
+  frame->dlc = 8;
+  frame->extended = false;
+  frame->data[0] = CAN_TSYNC_FUP;
+  frame->data[1] = seq;
+  for (int i = 0; i < 6; i++) frame->data[2 + i] = (uint8_t)(sync_end_us >> (8 * i));
+}
+
+bool CanTimeSyncReceiver::onFrame(const CanFrame& frame, uint64_t local_us) {
+  if (frame.extended) return false;
+
+  if (frame.id == CAN_TSYNC_ID && frame.dlc >= 2) {
+    if (frame.data[0] == CAN_TSYNC_SYNC) {
+      sync_pending_ = true;
+      sync_seq_ = frame.data[1];
+      sync_local_ = local_us;
+    } else if (frame.data[0] == CAN_TSYNC_FUP && frame.dlc == 8 && sync_pending_ &&
+               frame.data[1] == sync_seq_) {
+      uint64_t t = 0;
+      for (int i = 0; i < 6; i++) t |= (uint64_t)frame.data[2 + i] << (8 * i);
+      pairs_[next_] = {t, sync_local_};
+      next_ = (next_ + 1) % kWindow;
+      if (count_ < kWindow) count_++;
+      last_device_ = t;
+      sync_pending_ = false;
+      syncs_++;
+      fit();
+    }
+    return false;
+  }
+
+  if (frame.id >= IMU_CAN_BASE_ID && frame.id < IMU_CAN_BASE_ID + IMU_CAN_FRAMES) {
+    // A new group starts at 0x501; partial groups are dropped
+    if (frame.id == IMU_CAN_BASE_ID) group_mask_ = 0;
+    if (imuUnpackFrame(frame, sample_.values)) group_mask_ |= 1 << (frame.id - IMU_CAN_BASE_ID);
+    return false;
+  }
+
+  uint32_t low;
+  uint8_t seq;
+  if (!imuUnpackStamp(frame, &low, &seq)) return false;
+  const bool complete = group_mask_ == (1 << IMU_CAN_FRAMES) - 1;
+  group_mask_ = 0;
+  if (have_seq_) lost_ += (uint8_t)(seq - last_seq_ - 1);
+  have_seq_ = true;
+  last_seq_ = seq;
+  if (!complete) return false;
+  if (!synced()) {
+    unsynced_++;
+    return false;
+  }
+
+  sample_.seq = seq;
+  sample_.device_us = extend(low);
+  sample_.local_us = deviceToLocal(sample_.device_us);
+  return true;
+}
+
+uint64_t CanTimeSyncReceiver::extend(uint32_t device_low) const {
+  // Nearest value to the last sync with these low 32 bits (+-35 min)
+  const int32_t delta = (int32_t)(device_low - (uint32_t)last_device_);
+  return last_device_ + (int64_t)delta;
+}
+
+void CanTimeSyncReceiver::fit() {
+  // Least squares of (local - device) against device time, relative to
+  // the newest pair; with one pair only the offset is known
+  ref_ = last_device_;
+  double n = 0, sx = 0, sy = 0, sxx = 0, sxy = 0;
+  for (size_t i = 0; i < count_; i++) {
+    const double x = (double)(int64_t)(pairs_[i].device_us - ref_);
+    const double y = (double)(int64_t)(pairs_[i].local_us - pairs_[i].device_us);
+    n++;
+    sx += x;
+    sy += y;
+    sxx += x * x;
+    sxy += x * y;
+  }
+  const double den = n * sxx - sx * sx;
+  if (n >= 2 && den > 0) {
+    drift_ = (n * sxy - sx * sy) / den;
+    offset_ = (sy - drift_ * sx) / n;
+  } else {
+    offset_ = sy / n;
+  }
+}
+
+uint64_t CanTimeSyncReceiver::deviceToLocal(uint64_t device_us) const {
+  const double x = (double)(int64_t)(device_us - ref_);
+  return device_us + (int64_t)(offset_ + drift_ * x);
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include "can_frame.h"
+#include "imu_codec.h"
+
+// CAN time distribution from the gateway's microsecond clock.
+//
+// Two-step sync on 0x500, once a second:
+//   SYNC  [0x01][seq]                      timestamped by receivers on arrival
+//   FUP   [0x02][seq][t0..t5]              48-bit device time (us) at which
+//                                          that SYNC finished on the wire
+// A receiver pairs its own receive time of SYNC with the FUP time and
+// fits local = device + offset + drift * (device - ref). Each IMU group
+// is followed by 0x504 carrying the low 32 bits of the sample's device
+// time (see imu_codec.h), which the fit maps into the receiver's clock.
+static const uint32_t CAN_TSYNC_ID = 0x500;
+static const uint32_t CAN_TSYNC_PERIOD_US = 1000000;
+
+enum CanTsyncType : uint8_t {
+  CAN_TSYNC_SYNC = 0x01,
+  CAN_TSYNC_FUP  = 0x02,
+};
+
+void canTsyncPackSync(uint8_t seq, CanFrame* frame);
+void canTsyncPackFup(uint8_t seq, uint64_t sync_end_us, CanFrame* frame);
+
+// Reference receiver: feed every frame with the local receive time.
+class CanTimeSyncReceiver {
+public:
+  static const size_t kWindow = 8;
+
+  struct Sample {
+    float values[IMU_CHANNELS];
+    uint8_t seq;
+    uint64_t device_us;  // sample time, device clock
+    uint64_t local_us;   // same instant, receiver clock
+  };
+
+  // True when a stamped IMU sample completed; read it with sample().
+  // Samples before the first fit are counted in unsynced().
+  bool onFrame(const CanFrame& frame, uint64_t local_us);
+  const Sample& sample() const { return sample_; }
+
+  bool synced() const { return count_ > 0; }
+  uint64_t deviceToLocal(uint64_t device_us) const;
+  int32_t driftPpb() const { return (int32_t)(drift_ * 1e9); }
+  uint32_t syncs() const { return syncs_; }
+  uint32_t lostSamples() const { return lost_; }
+  uint32_t unsynced() const { return unsynced_; }
+
+private:
+  struct Pair {
+    uint64_t device_us;
+    uint64_t local_us;
+  };
+
+  void fit();
+  // Extend a 32-bit device timestamp next to the last FUP time
+  uint64_t extend(uint32_t device_low) const;
+
+  // Sync state
+  bool sync_pending_ = false;
+  uint8_t sync_seq_ = 0;
+  uint64_t sync_local_ = 0;
+  Pair pairs_[kWindow];
+  size_t count_ = 0;
+  size_t next_ = 0;
+  uint64_t last_device_ = 0;
+  uint64_t ref_ = 0;
+  double offset_ = 0;
+  double drift_ = 0;
+  uint32_t syncs_ = 0;
+
+  // IMU group assembly
+  uint8_t group_mask_ = 0;
+  bool have_seq_ = false;
+  uint8_t last_seq_ = 0;
+  uint32_t lost_ = 0;
+  uint32_t unsynced_ = 0;
+  Sample sample_;
+};
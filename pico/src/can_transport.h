@@ -0,0 +1,28 @@
+#pragma once
+#include "can_frame.h"
+
+// Send interface shared by the CAN back ends (MCP2515 over SPI, PIO
+// controller on the RP2350, SocketCAN on the host).
+class CanTransport {
+public:
+  virtual ~CanTransport() {}
+  virtual bool begin(uint32_t bitrate) = 0;
+  // Queue frames in order; false if any of them could not be queued.
+  virtual bool sendBatch(const CanFrame* frames, uint8_t count) = 0;
+  bool send(const CanFrame& frame) { return sendBatch(&frame, 1); }
+  // Fetch one received frame; false when nothing is pending.
+  virtual bool receive(CanFrame* frame) = 0;
+  // Restrict reception to the given identifiers (count 0: accept all).
+  // False when the back end cannot filter this list (too many IDs, or
+  // IDs it cannot match); the previous filter then stays in place.
+  virtual bool setAcceptanceIds(const uint32_t* ids, uint8_t count) = 0;
+  // Block (briefly) until every frame queued so far has left the
+  // controller, so the caller can timestamp the last one's end of frame.
+  // False on timeout or when the back end cannot tell.
+  virtual bool waitTxDone() { return false; }
+  // Move frames from a software TX queue to the controller without
+  // waiting; called from the loop. Nothing to do for back ends whose
+  // controller queues every frame itself.
+  virtual void pollTx() {}
+  virtual const char* name() const = 0;
+};
@@ -0,0 +1,163 @@
+#include "can_wire.h"
+#include <string.h>
+
+// Unstuffed SOF..CRC field of an extended frame with 8 data bytes
+static const size_t kMaxRawBits = 1 + 32 + 6 + 64 + 15;
+// CRC delimiter, ACK slot, ACK delimiter, EOF, intermission
+static const size_t kTailBits = 1 + 1 + 1 + 7 + 3;
+
+uint16_t canCrc15(const uint8_t* bits, size_t count) {
+  uint16_t crc = 0;
+  for (size_t i = 0; i < count; i++) {
+    const uint16_t next = (uint16_t)((bits[i] & 1) ^ ((crc >> 14) & 1));
+    crc = (uint16_t)((crc << 1) & 0x7FFF);
+    if (next) crc ^= 0x4599;
+  }
+  return crc;
+}
+
+static size_t putBits(uint8_t* raw, size_t pos, uint32_t value, int width) {
+  for (int b = width - 1; b >= 0; b--) raw[pos++] = (uint8_t)((value >> b) & 1);
+  return pos;
+}
+
+// Raw (unstuffed) SOF..CRC bits of a frame
+static size_t buildRaw(const CanFrame& frame, uint8_t* raw) {
+  const uint8_t dlc = frame.dlc > 8 ? 8 : frame.dlc;
+  size_t n = 0;
+  raw[n++] = 0;  // SOF
+  if (frame.extended) {
+    const uint32_t id = frame.id & 0x1FFFFFFF;
+    n = putBits(raw, n, id >> 18, 11);
+    raw[n++] = 1;  // SRR
+    raw[n++] = 1;  // IDE
+    n = putBits(raw, n, id & 0x3FFFF, 18);
+    raw[n++] = 0;  // RTR
+    raw[n++] = 0;  // r1
+    raw[n++] = 0;  // r0
+  } else {
+    n = putBits(raw, n, frame.id & 0x7FF, 11);
+    raw[n++] = 0;  // RTR
+    raw[n++] = 0;  // IDE
+    raw[n++] = 0;  // r0
+  }
+  n = putBits(raw, n, dlc, 4);
+  for (uint8_t i = 0; i < dlc; i++) n = putBits(raw, n, frame.data[i], 8);
+  const uint16_t crc = canCrc15(raw, n);
+  return putBits(raw, n, crc, 15);
+}
+
+size_t canEncodeBits(const CanFrame& frame, uint8_t* bits, size_t cap) {
+  uint8_t raw[kMaxRawBits];
+  const size_t raw_len = buildRaw(frame, raw);
+
+  size_t n = 0;
+  uint8_t run_bit = 2;
+  int run_len = 0;
+  for (size_t i = 0; i < raw_len; i++) {
+    if (n >= cap) return 0;
+    bits[n++] = raw[i];
+    if (raw[i] == run_bit) {
+      run_len++;
+    } else {
+      run_bit = raw[i];
+      run_len = 1;
+    }
+    if (run_len == 5) {
+      // Five equal bits: insert the complement, which starts a new run
+      if (n >= cap) return 0;
+      run_bit ^= 1;
+      bits[n++] = run_bit;
+      run_len = 1;
+    }
+  }
+  if (n + kTailBits > cap) return 0;
+  for (size_t i = 0; i < kTailBits; i++) bits[n++] = 1;
+  return n;
+}
+
+bool canDecodeBits(const uint8_t* bits, size_t count, CanFrame* frame) {
+  uint8_t raw[kMaxRawBits];
+  size_t n = 0;
+  size_t i = 0;
+  uint8_t run_bit = 2;
+  int run_len = 0;
+
+  // Destuff until the raw length implied by IDE/DLC has been collected
+  size_t needed = 19;  // through DLC of a standard frame; refined below
+  bool have_dlc = false;
+  while (n < needed) {
+    if (i >= count) return false;
+    const uint8_t b = bits[i++];
+    if (run_len == 5) {
+      // Must be a stuff bit of opposite polarity
+      if (b == run_bit) return false;
+      run_bit = b;
+      run_len = 1;
+      continue;
+    }
+    if (b == run_bit) {
+      run_len++;
+    } else {
+      run_bit = b;
+      run_len = 1;
+    }
+    raw[n++] = b;
+
+    if (n == 1 && raw[0] != 0) return false;  // SOF must be dominant
+    if (n == 14 && raw[13] == 1) needed = 39;  // IDE set: extended header
+    if (n == needed && !have_dlc) {
+      uint8_t dlc = 0;
+      for (size_t k = needed - 4; k < needed; k++) dlc = (uint8_t)((dlc << 1) | raw[k]);
+      if (dlc > 8) dlc = 8;
+      needed += (size_t)dlc * 8 + 15;
+      have_dlc = true;
+    }
+  }
+  // A stuff bit may follow the last CRC bit
+  if (run_len == 5) {
+    if (i >= count || bits[i] == run_bit) return false;
+    i++;
+  }
+
+  const size_t crc_pos = n - 15;
+  uint16_t crc = 0;
+  for (size_t k = crc_pos; k < n; k++) crc = (uint16_t)((crc << 1) | raw[k]);
+  if (crc != canCrc15(raw, crc_pos)) return false;
+
+  // CRC delimiter and ACK delimiter must be recessive
+  if (i + 3 > count || bits[i] != 1 || bits[i + 2] != 1) return false;
+
+  const bool ext = raw[13] == 1;
+  uint32_t id = 0;
+  for (size_t k = 1; k < 12; k++) id = (id << 1) | raw[k];
+  size_t pos = 14;
+  if (ext) {
+    for (size_t k = 14; k < 32; k++) id = (id << 1) | raw[k];
+    pos = 35;
+  } else {
+    pos = 15;
+  }
+  uint8_t dlc = 0;
+  for (size_t k = pos; k < pos + 4; k++) dlc = (uint8_t)((dlc << 1) | raw[k]);
+  if (dlc > 8) dlc = 8;
+  pos += 4;
+
+  frame->id = id;
+  frame->extended = ext;
+  frame->dlc = dlc;
+  memset(frame->data, 0, sizeof(frame->data));
+  for (uint8_t d = 0; d < dlc; d++) {
+    uint8_t v = 0;
+    for (int k = 0; k < 8; k++) v = (uint8_t)((v << 1) | raw[pos++]);
+    frame->data[d] = v;
+  }
+  return true;
+}
+
+uint32_t canFrameWireTimeNs(const CanFrame& frame, uint32_t bitrate) {
+  if (bitrate == 0) return 0;
+  uint8_t bits[kCanMaxFrameBits];
+  const size_t n = canEncodeBits(frame, bits, sizeof(bits));
+  return (uint32_t)(((uint64_t)n * 1000000000ull) / bitrate);
+}
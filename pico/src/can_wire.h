@@ -0,0 +1,27 @@
+#pragma once
+#include "can_frame.h"
+
+// Bit-level CAN 2.0 frame encoding (what a controller puts on the wire).
+// Used for wire times: "canstat" and the time sync simulator. The decoder
+// is the encoder's inverse, used to check it (test/test_can_wire).
+
+// Upper bound for one stuffed extended data frame incl. EOF and IFS
+static const size_t kCanMaxFrameBits = 160;
+
+// CRC-15/CAN (x^15 + x^14 + x^10 + x^8 + x^7 + x^4 + x^3 + 1) over a
+// sequence of bits stored one per byte.
+uint16_t canCrc15(const uint8_t* bits, size_t count);
+
+// Encode a data frame into bits (one per byte, 0 = dominant) starting at
+// SOF, with bit stuffing applied from SOF through the CRC sequence and the
+// fixed-form tail (CRC delimiter, ACK slot sent recessive, ACK delimiter,
+// 7 bit EOF, 3 bit intermission). Returns the number of bits or 0 if
+// `cap` is too small.
+size_t canEncodeBits(const CanFrame& frame, uint8_t* bits, size_t cap);
+
+// Decode bits produced by canEncodeBits (destuff, check CRC and stuff
+// rule). Returns false on any framing, stuffing or CRC error.
+bool canDecodeBits(const uint8_t* bits, size_t count, CanFrame* frame);
+
+// Time on the wire for one frame, in nanoseconds
+uint32_t canFrameWireTimeNs(const CanFrame& frame, uint32_t bitrate);
@@ -0,0 +1,107 @@
+#include "clock_sync.h"
+
+// Exchanges slower than the best recent one by more than this are queued
+// behind other traffic; their offset carries up to delay/2 of error.
+static const uint32_t kDelaySlackUs = 1000;
+// Drift is measured over at least this much device time, and the anchor
+// moves forward after the longer one so temperature changes are tracked
+static const double kMinBaselineUs = 30e6;
+static const double kMaxBaselineUs = 600e6;
+// An exchange further than this (plus its own delay/2 uncertainty) from
+// the estimate means the host clock restarted, e.g. a page reload with a
+// new performance.now() epoch; the old samples are dropped.
+static const int64_t kMaxJumpUs = 100000;
+
+bool ClockSync::addSample(uint64_t t1, uint64_t t2, uint64_t t3, uint64_t t4) {
+  if (t4 < t1 || t3 < t2) return false;
+  const uint64_t round_trip = t4 - t1;
+  const uint64_t held = t3 - t2;
+  if (held > round_trip) return false;
+
+  const uint32_t delay = (uint32_t)(round_trip - held);
+  const int64_t offset = ((int64_t)(t2 - t1) + (int64_t)(t3 - t4)) / 2;
+  const uint64_t device = t2 + held / 2;
+  if (valid()) {
+    const int64_t err = offset - offsetUs(device);
+    const int64_t bound = kMaxJumpUs + delay / 2;
+    if (err > bound || err < -bound) {
+      reset();
+      jumps_++;
+    }
+  }
+
+  Sample& s = window_[next_];
+  s.delay_us = delay;
+  s.offset_us = offset;
+  s.device_us = device;
+  next_ = (next_ + 1) % kWindow;
+  if (count_ < kWindow) count_++;
+  total_++;
+  last_delay_ = s.delay_us;
+
+  fit();
+  return true;
+}
+
+void ClockSync::fit() {
+  min_delay_ = UINT32_MAX;
+  for (size_t i = 0; i < count_; i++) {
+    if (window_[i].delay_us < min_delay_) min_delay_ = window_[i].delay_us;
+  }
+  const uint32_t limit = min_delay_ + kDelaySlackUs;
+
+  // Offset: mean of the low-delay samples, moved to the newest sample
+  // with the current drift
+  ref_ = window_[(next_ + kWindow - 1) % kWindow].device_us;
+  double n = 0, sum = 0;
+  for (size_t i = 0; i < count_; i++) {
+    const Sample& s = window_[i];
+    if (s.delay_us > limit) continue;
+    sum += (double)s.offset_us - drift_ * (double)(int64_t)(s.device_us - ref_);
+    n++;
+  }
+  offset_ = sum / n;
+
+  // Drift: a window of a few seconds only sees delay noise, so compare
+  // against an anchor offset from tens of seconds ago instead
+  if (!anchored_) {
+    if (count_ < kWindow / 2) return;  // anchor on a filtered offset
+    anchor_device_ = ref_;
+    anchor_offset_ = offset_;
+    anchored_ = true;
+    return;
+  }
+  const double baseline = (double)(int64_t)(ref_ - anchor_device_);
+  if (baseline >= kMinBaselineUs) {
+    drift_ = (offset_ - anchor_offset_) / baseline;
+  }
+  if (baseline >= kMaxBaselineUs) {
+    anchor_device_ = ref_;
+    anchor_offset_ = offset_;
+  }
+}
+
+int64_t ClockSync::offsetUs(uint64_t device_us) const {
+  return (int64_t)(offset_ + drift_ * (double)(int64_t)(device_us - ref_));
+}
+
+uint64_t ClockSync::hostToDevice(uint64_t host_us) const {
+  // device = host + offset + drift * (device - ref), solved for device
+  const double rel = (double)(int64_t)(host_us - ref_) + offset_;
+  return ref_ + (int64_t)(rel / (1.0 - drift_));
+}
+
+uint64_t ClockSync::deviceToHost(uint64_t device_us) const {
+  return device_us - offsetUs(device_us);
+}
+
+void ClockSync::reset() {
+  count_ = 0;
+  next_ = 0;
+  total_ = 0;
+  last_delay_ = 0;
+  min_delay_ = 0;
+  offset_ = 0;
+  drift_ = 0;
+  anchored_ = false;
+}
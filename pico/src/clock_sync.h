@@ -0,0 +1,60 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// NTP-style host <-> device clock estimate.
+//
+// Each ping exchange gives four timestamps: t1 host send, t2 device
+// receive, t3 device reply, t4 host receive (host in its own microsecond
+// clock, device in 64-bit micros). The offset comes from the recent
+// exchanges with the lowest round-trip delay, the drift from how that
+// offset moves over tens of seconds:
+//
+//   offset(d) = device - host = offset + drift * (d - ref)
+//
+// so host timestamps can be mapped into the device timebase. An exchange
+// far off the estimate restarts it, since the host clock has a new epoch.
+class ClockSync {
+public:
+  static const size_t kWindow = 16;
+
+  // Returns false when the exchange is inconsistent (negative delay)
+  bool addSample(uint64_t t1, uint64_t t2, uint64_t t3, uint64_t t4);
+
+  bool valid() const { return count_ > 0; }
+  uint64_t hostToDevice(uint64_t host_us) const;
+  uint64_t deviceToHost(uint64_t device_us) const;
+
+  // Current estimate at device time `device_us`
+  int64_t offsetUs(uint64_t device_us) const;
+  int32_t driftPpb() const { return (int32_t)(drift_ * 1e9); }
+  uint32_t lastDelayUs() const { return last_delay_; }
+  uint32_t minDelayUs() const { return min_delay_; }
+  uint32_t samples() const { return total_; }
+  // Restarts after a host clock jump, since boot
+  uint32_t jumps() const { return jumps_; }
+  void reset();
+
+private:
+  struct Sample {
+    uint64_t device_us;  // midpoint of t2..t3
+    int64_t offset_us;
+    uint32_t delay_us;
+  };
+
+  void fit();
+
+  Sample window_[kWindow];
+  size_t count_ = 0;
+  size_t next_ = 0;
+  uint32_t total_ = 0;
+  uint32_t jumps_ = 0;
+  uint32_t last_delay_ = 0;
+  uint32_t min_delay_ = 0;
+  uint64_t ref_ = 0;
+  double offset_ = 0;
+  double drift_ = 0;
+  bool anchored_ = false;
+  uint64_t anchor_device_ = 0;
+  double anchor_offset_ = 0;
+};
@@ -0,0 +1,19 @@
+#pragma once
+#include <stdint.h>
+
+// Scalar vs packed (SMLAD) kernel check: both variants run over the same
+// pseudo-random input, full-scale and saturating values included, and
+// every output sample is compared. Used by the "dspbench" command on the
+// Pico and in the native build.
+struct DspBenchResult {
+  const char* kernel;
+  uint32_t samples;
+  uint32_t mismatches;
+  uint32_t scalar_us;
+  uint32_t simd_us;
+};
+
+static const uint8_t DSP_BENCH_KERNELS = 2;  // Q15 FIR (32 taps), Q15 biquad
+
+void dspBench(uint32_t samples, uint32_t seed, uint32_t (*now_us)(),
+              DspBenchResult out[DSP_BENCH_KERNELS]);
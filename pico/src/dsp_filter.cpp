@@ -0,0 +1,186 @@
+#include "dsp_filter.h"
+#include <math.h>
+#include <string.h>
+#include "dsp_simd.h"
+
+bool dspDesignLowpass(float fc_hz, float fs_hz, BiquadCoeffs* out) {
+  if (!(fc_hz > 0) || !(fs_hz > 2 * fc_hz)) return false;
+  const float w0 = 2.0f * (float)M_PI * fc_hz / fs_hz;
+  const float cw = cosf(w0);
+  const float alpha = sinf(w0) / (2.0f * 0.70710678f);
+  const float a0 = 1.0f + alpha;
+  out->b0 = (1.0f - cw) / 2.0f / a0;
+  out->b1 = (1.0f - cw) / a0;
+  out->b2 = out->b0;
+  out->a1 = -2.0f * cw / a0;
+  out->a2 = (1.0f - alpha) / a0;
+  return true;
+}
+
+// Round to a fixed-point integer with `frac` fractional bits; false if
+// the value is outside [lo, hi]
+static bool toFixed(float v, int frac, int64_t lo, int64_t hi, int64_t* out) {
+  const double q = floor((double)v * (double)(1LL << frac) + 0.5);
+  if (!(q >= (double)lo && q <= (double)hi)) return false;
+  *out = (int64_t)q;
+  return true;
+}
+
+bool firQ15Init(FirQ15* f, const int16_t* taps, uint8_t ntaps) {
+  if (ntaps == 0 || ntaps > DSP_FIR_MAX_TAPS) return false;
+  memset(f, 0, sizeof(*f));
+  memcpy(f->taps, taps, ntaps * sizeof(int16_t));
+  f->ntaps = (uint8_t)((ntaps + 1) & ~1);
+  return true;
+}
+
+void firQ15Reset(FirQ15* f) {
+  memset(f->hist, 0, sizeof(f->hist));
+  f->pos = 0;
+}
+
+static bool quantizeQ14(const BiquadCoeffs& c, int16_t q[5]) {
+  const float v[5] = {c.b0, c.b1, c.b2, -c.a1, -c.a2};
+  for (int i = 0; i < 5; i++) {
+    int64_t x;
+    if (!toFixed(v[i], 14, INT16_MIN, INT16_MAX, &x)) return false;
+    q[i] = (int16_t)x;
+  }
+  return true;
+}
+
+bool biquadQ15Init(BiquadQ15* f, const BiquadCoeffs& c) {
+  int16_t q[5];
+  if (!quantizeQ14(c, q)) return false;
+  memset(f, 0, sizeof(*f));
+  f->b0 = q[0];
+  f->b1 = q[1];
+  f->b2 = q[2];
+  f->na1 = q[3];
+  f->na2 = q[4];
+  return true;
+}
+
+bool biquadQ31Init(BiquadQ31* f, const BiquadCoeffs& c) {
+  const float v[5] = {c.b0, c.b1, c.b2, -c.a1, -c.a2};
+  int32_t q[5];
+  for (int i = 0; i < 5; i++) {
+    int64_t x;
+    if (!toFixed(v[i], 30, INT32_MIN, INT32_MAX, &x)) return false;
+    q[i] = (int32_t)x;
+  }
+  memset(f, 0, sizeof(*f));
+  f->b0 = q[0];
+  f->b1 = q[1];
+  f->b2 = q[2];
+  f->na1 = q[3];
+  f->na2 = q[4];
+  return true;
+}
+
+// Push x into the doubled history; returns the newest-first window
+static inline const int16_t* firPush(FirQ15* f, int16_t x) {
+  f->pos = (uint8_t)((f->pos == 0 ? f->ntaps : f->pos) - 1);
+  f->hist[f->pos] = x;
+  f->hist[f->pos + f->ntaps] = x;
+  return f->hist + f->pos;
+}
+
+int32_t dspDotQ15Scalar(const int16_t* a, const int16_t* b, uint16_t n, int32_t acc) {
+  uint32_t sum = (uint32_t)acc;
+  for (uint16_t i = 0; i < n; i++) {
+    sum += (uint32_t)((int32_t)a[i] * b[i]);
+  }
+  return (int32_t)sum;
+}
+
+int32_t dspDotQ15Simd(const int16_t* a, const int16_t* b, uint16_t n, int32_t acc) {
+  // Two products per SMLAD, four per iteration
+  uint16_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    acc = dspSmlad(dspLoad2x16(a + i), dspLoad2x16(b + i), acc);
+    acc = dspSmlad(dspLoad2x16(a + i + 2), dspLoad2x16(b + i + 2), acc);
+  }
+  if (i < n) acc = dspSmlad(dspLoad2x16(a + i), dspLoad2x16(b + i), acc);
+  return acc;
+}
+
+int32_t dspDotQ15(const int16_t* a, const int16_t* b, uint16_t n, int32_t acc) {
+#if DSP_HAVE_SIMD
+  return dspDotQ15Simd(a, b, n, acc);
+#else
+  return dspDotQ15Scalar(a, b, n, acc);
+#endif
+}
+
+int16_t firQ15StepScalar(FirQ15* f, int16_t x) {
+  const int16_t* w = firPush(f, x);
+  const int32_t y = dspDotQ15Scalar(w, f->taps, f->ntaps, 1 << 14) >> 15;
+  return (int16_t)(y > 32767 ? 32767 : y < -32768 ? -32768 : y);
+}
+
+int16_t firQ15StepSimd(FirQ15* f, int16_t x) {
+  const int16_t* w = firPush(f, x);
+  return dspSsat16(dspDotQ15Simd(w, f->taps, f->ntaps, 1 << 14) >> 15);
+}
+
+int16_t biquadQ15StepScalar(BiquadQ15* f, int16_t x) {
+  uint32_t acc = 1u << 13;
+  acc += (uint32_t)((int32_t)f->b0 * x);
+  acc += (uint32_t)((int32_t)f->b1 * f->x1);
+  acc += (uint32_t)((int32_t)f->b2 * f->x2);
+  acc += (uint32_t)((int32_t)f->na1 * f->y1);
+  acc += (uint32_t)((int32_t)f->na2 * f->y2);
+  int32_t y = (int32_t)acc >> 14;
+  y = y > 32767 ? 32767 : y < -32768 ? -32768 : y;
+  f->x2 = f->x1;
+  f->x1 = x;
+  f->y2 = f->y1;
+  f->y1 = (int16_t)y;
+  return (int16_t)y;
+}
+
+int16_t biquadQ15StepSimd(BiquadQ15* f, int16_t x) {
+  int32_t acc = 1 << 13;
+  acc = dspSmlad(dspPack16(x, f->x1), dspPack16(f->b0, f->b1), acc);
+  acc = dspSmlad(dspPack16(f->x2, f->y1), dspPack16(f->b2, f->na1), acc);
+  acc = dspSmlabb((uint16_t)f->y2, (uint16_t)f->na2, acc);
+  const int16_t y = dspSsat16(acc >> 14);
+  f->x2 = f->x1;
+  f->x1 = x;
+  f->y2 = f->y1;
+  f->y1 = y;
+  return y;
+}
+
+int32_t biquadQ31Step(BiquadQ31* f, int32_t x) {
+  int64_t acc = 1LL << 29;
+  acc += (int64_t)f->b0 * x;
+  acc += (int64_t)f->b1 * f->x1;
+  acc += (int64_t)f->b2 * f->x2;
+  acc += (int64_t)f->na1 * f->y1;
+  acc += (int64_t)f->na2 * f->y2;
+  int64_t y = acc >> 30;
+  y = y > INT32_MAX ? INT32_MAX : y < INT32_MIN ? INT32_MIN : y;
+  f->x2 = f->x1;
+  f->x1 = x;
+  f->y2 = f->y1;
+  f->y1 = (int32_t)y;
+  return (int32_t)y;
+}
+
+int16_t firQ15Step(FirQ15* f, int16_t x) {
+#if DSP_HAVE_SIMD
+  return firQ15StepSimd(f, x);
+#else
+  return firQ15StepScalar(f, x);
+#endif
+}
+
+int16_t biquadQ15Step(BiquadQ15* f, int16_t x) {
+#if DSP_HAVE_SIMD
+  return biquadQ15StepSimd(f, x);
+#else
+  return biquadQ15StepScalar(f, x);
+#endif
+}
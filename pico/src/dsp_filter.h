@@ -0,0 +1,65 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// Fixed-point filter kernels for the IMU channels.
+//
+//   Q15 FIR      int16 taps/samples, 32-bit accumulator, SMLAD pairs
+//   Q15 biquad   direct form I, Q14 coefficients (|a1| < 2), SMLAD pairs
+//   Q31 biquad   direct form I, Q30 coefficients, 64-bit accumulator;
+//                for cutoffs too low for Q14 coefficients
+//
+// Every Q15 kernel has a packed (dsp_simd.h) and a plain scalar variant
+// that produce identical output, wrap-around and saturation included;
+// the default entry points use the packed one when the core has the DSP
+// extension. Rounding is to nearest, outputs saturate.
+
+static const uint8_t DSP_FIR_MAX_TAPS = 32;
+
+struct FirQ15 {
+  int16_t taps[DSP_FIR_MAX_TAPS];      // h0..h(n-1), zero-padded to even n
+  int16_t hist[2 * DSP_FIR_MAX_TAPS];  // every input stored twice, so the
+                                       // newest-first window is contiguous
+  uint8_t ntaps;
+  uint8_t pos;
+};
+
+struct BiquadQ15 {
+  int16_t b0, b1, b2, na1, na2;  // Q14, feedback coefficients negated
+  int16_t x1, x2, y1, y2;
+};
+
+struct BiquadQ31 {
+  int32_t b0, b1, b2, na1, na2;  // Q30, feedback coefficients negated
+  int32_t x1, x2, y1, y2;
+};
+
+// Normalized second-order section: y = (b0 x + b1 x1 + b2 x2 - a1 y1 - a2 y2)
+struct BiquadCoeffs {
+  float b0, b1, b2, a1, a2;
+};
+
+// Butterworth low-pass (Q = 1/sqrt(2)), RBJ cookbook bilinear design.
+// False when fc is not within (0, fs/2).
+bool dspDesignLowpass(float fc_hz, float fs_hz, BiquadCoeffs* out);
+
+// Returns false when there are too many taps or a coefficient does not
+// fit the format (the filter is left unchanged).
+bool firQ15Init(FirQ15* f, const int16_t* taps, uint8_t ntaps);
+bool biquadQ15Init(BiquadQ15* f, const BiquadCoeffs& c);
+bool biquadQ31Init(BiquadQ31* f, const BiquadCoeffs& c);
+void firQ15Reset(FirQ15* f);
+
+// acc + sum(a[i] * b[i]) over an even n, wrapping at 32 bits
+int32_t dspDotQ15Scalar(const int16_t* a, const int16_t* b, uint16_t n, int32_t acc);
+int32_t dspDotQ15Simd(const int16_t* a, const int16_t* b, uint16_t n, int32_t acc);
+int32_t dspDotQ15(const int16_t* a, const int16_t* b, uint16_t n, int32_t acc);
+
+int16_t firQ15StepScalar(FirQ15* f, int16_t x);
+int16_t firQ15StepSimd(FirQ15* f, int16_t x);
+int16_t biquadQ15StepScalar(BiquadQ15* f, int16_t x);
+int16_t biquadQ15StepSimd(BiquadQ15* f, int16_t x);
+int32_t biquadQ31Step(BiquadQ31* f, int32_t x);
+
+int16_t firQ15Step(FirQ15* f, int16_t x);
+int16_t biquadQ15Step(BiquadQ15* f, int16_t x);
@@ -0,0 +1,50 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+
+// The few Armv8-M DSP extension instructions the filter kernels use.
+// On the RP2350 (Cortex-M33, __ARM_FEATURE_DSP) they map to the ACLE
+// intrinsics; elsewhere they are emulated bit for bit, so the packed
+// kernels can be checked against the scalar ones on the host.
+#if defined(__ARM_FEATURE_DSP)
+#include <arm_acle.h>
+#define DSP_HAVE_SIMD 1
+#else
+#define DSP_HAVE_SIMD 0
+#endif
+
+// Two int16 lanes in one word: lo in bits 0..15, hi in bits 16..31
+static inline uint32_t dspPack16(int16_t lo, int16_t hi) {
+  return (uint16_t)lo | ((uint32_t)(uint16_t)hi << 16);
+}
+
+// Unaligned load of two adjacent int16 (LDR allows it on the M33)
+static inline uint32_t dspLoad2x16(const int16_t* p) {
+  uint32_t w;
+  memcpy(&w, p, 4);
+  return w;
+}
+
+#if DSP_HAVE_SIMD
+// acc + x.lo * y.lo + x.hi * y.hi (wraps at 32 bits)
+static inline int32_t dspSmlad(uint32_t x, uint32_t y, int32_t acc) {
+  return __smlad(x, y, acc);
+}
+// acc + x.lo * y.lo
+static inline int32_t dspSmlabb(uint32_t x, uint32_t y, int32_t acc) {
+  return __smlabb(x, y, acc);
+}
+static inline int16_t dspSsat16(int32_t x) { return (int16_t)__ssat(x, 16); }
+#else
+static inline int32_t dspSmlad(uint32_t x, uint32_t y, int32_t acc) {
+  const int32_t lo = (int32_t)(int16_t)x * (int16_t)y;
+  const int32_t hi = (int32_t)(int16_t)(x >> 16) * (int16_t)(y >> 16);
+  return (int32_t)((uint32_t)acc + (uint32_t)lo + (uint32_t)hi);
+}
+static inline int32_t dspSmlabb(uint32_t x, uint32_t y, int32_t acc) {
+  return (int32_t)((uint32_t)acc + (uint32_t)((int32_t)(int16_t)x * (int16_t)y));
+}
+static inline int16_t dspSsat16(int32_t x) {
+  return (int16_t)(x > 32767 ? 32767 : x < -32768 ? -32768 : x);
+}
+#endif
@@ -0,0 +1,185 @@
+#include "gs_usb.h"
+#include <string.h>
+#include "usb_frame.h"
+
+// Bit timing limits reported in BT_CONST: the span of the MCP2515 CNF
+// tables behind Mcp2515::begin(bitrate), so the driver's search stays
+// among timings that land on those rates
+static const uint32_t kTseg1Min = 4, kTseg1Max = 16;
+static const uint32_t kTseg2Min = 2, kTseg2Max = 8;
+static const uint32_t kSjwMax = 4;
+static const uint32_t kBrpMin = 1, kBrpMax = 32;
+
+// Rates CanTransport::begin() is known to take on every back end
+static const uint32_t kBitrates[] = {
+  10000, 20000, 50000, 100000, 125000, 250000, 500000, 800000, 1000000,
+};
+
+static bool supportedBitrate(uint32_t bitrate) {
+  for (uint32_t b : kBitrates) {
+    if (b == bitrate) return true;
+  }
+  return false;
+}
+
+// IN queue slots kept free for echoes, one per host TX context
+static const size_t kEchoReserve = GsUsb::kTxSlots;
+
+int GsUsb::controlIn(uint8_t request, uint8_t* buf, uint16_t max, uint32_t now_us) {
+  switch (request) {
+    case BREQ_BT_CONST: {
+      if (max < 40) return -1;
+      const uint32_t v[10] = {
+        FEATURE_HW_TIMESTAMP | FEATURE_IDENTIFY, kCanClock,
+        kTseg1Min, kTseg1Max, kTseg2Min, kTseg2Max, kSjwMax,
+        kBrpMin, kBrpMax, 1,
+      };
+      for (int i = 0; i < 10; i++) putLe32(buf + 4 * i, v[i]);
+      return 40;
+    }
+    case BREQ_DEVICE_CONFIG:
+      if (max < 12) return -1;
+      // reserved x3, icount (channels - 1), sw_version, hw_version
+      memset(buf, 0, 4);
+      putLe32(buf + 4, 2);
+      putLe32(buf + 8, 1);
+      return 12;
+    case BREQ_TIMESTAMP:
+      if (max < 4) return -1;
+      putLe32(buf, now_us);
+      return 4;
+    default:
+      return -1;
+  }
+}
+
+bool GsUsb::controlOut(uint8_t request, const uint8_t* data, uint16_t len) {
+  switch (request) {
+    case BREQ_HOST_FORMAT:
+      // Host announces its byte order; we always speak little-endian
+      return len >= 4;
+
+    case BREQ_BITTIMING: {
+      // prop_seg, phase_seg1, phase_seg2, sjw, brp
+      if (len < 20) return false;
+      const uint32_t tseg1 = getLe32(data) + getLe32(data + 4);
+      const uint32_t tseg2 = getLe32(data + 8);
+      const uint32_t brp = getLe32(data + 16);
+      const uint32_t tq = 1 + tseg1 + tseg2;
+      if (brp < kBrpMin || brp > kBrpMax) return false;
+      if (tseg1 < kTseg1Min || tseg1 > kTseg1Max || tseg2 < kTseg2Min || tseg2 > kTseg2Max) {
+        return false;
+      }
+      // The transports take a nominal bitrate and use their own sample
+      // point; anything that is not exactly a standard rate is refused.
+      if (kCanClock % (brp * tq) != 0) return false;
+      const uint32_t bitrate = kCanClock / (brp * tq);
+      if (!supportedBitrate(bitrate)) return false;
+      bitrate_ = bitrate;
+      return true;
+    }
+
+    case BREQ_MODE: {
+      if (len < 8) return false;
+      const uint32_t mode = getLe32(data);
+      const uint32_t flags = getLe32(data + 4);
+      if (mode == MODE_RESET) {
+        if (started_) filter_.close();
+        started_ = false;
+        // The driver frees its TX contexts on close; nothing is echoed
+        clearTx();
+        return true;
+      }
+      if (mode != MODE_START || bitrate_ == 0) return false;
+      if (bitrate_ != active_bitrate_) {
+        // begin() resets the controller; put the filter back afterwards
+        if (!can_.begin(bitrate_)) return false;
+        active_bitrate_ = bitrate_;
+        filter_.apply();
+      }
+      if (!started_ && !filter_.open()) return false;
+      hw_timestamp_ = (flags & MODE_FLAG_HW_TIMESTAMP) != 0;
+      started_ = true;
+      return true;
+    }
+
+    case BREQ_BERR:
+      return true;
+
+    case BREQ_IDENTIFY:
+      if (len < 4) return false;
+      identify_ = getLe32(data) != 0;
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+bool GsUsb::onHostFrame(const uint8_t* data, size_t len, uint32_t now_us) {
+  if (len < kFrameSize || !started_) return false;
+  const uint32_t can_id = getLe32(data + 4);
+
+  Pending p;
+  p.echo_id = getLe32(data);
+  p.flags = data[10];
+  p.frame.extended = (can_id & CAN_ID_EFF) != 0;
+  p.frame.id = can_id & (p.frame.extended ? 0x1FFFFFFF : 0x7FF);
+  p.frame.dlc = data[8] > 8 ? 8 : data[8];
+  memcpy(p.frame.data, data + 12, 8);
+  // Not sendable here, but the TX context still has to come back
+  p.echo_only = (can_id & (CAN_ID_RTR | CAN_ID_ERR)) != 0;
+
+  if (!tx_queue_.push(p)) return false;
+  service(now_us);
+  return true;
+}
+
+void GsUsb::service(uint32_t now_us) {
+  // Echoes go into the IN queue in send order, behind any RX frames
+  // already waiting there
+  while (const Pending* head = tx_queue_.peek()) {
+    if (in_queue_.size() >= in_queue_.capacity()) return;
+    if (!head->echo_only && !can_.send(head->frame)) return;
+    Pending p;
+    tx_queue_.pop(&p);
+    // Echoed once the controller has it; this frees the host TX context
+    p.timestamp_us = now_us;
+    in_queue_.push(p);
+  }
+}
+
+void GsUsb::clearTx() {
+  Pending p;
+  while (tx_queue_.pop(&p)) {}
+}
+
+void GsUsb::onReceive(const CanFrame& frame, uint32_t timestamp_us) {
+  if (!started_) return;
+  if (in_queue_.size() + kEchoReserve >= in_queue_.capacity()) {
+    rx_overruns_++;
+    return;
+  }
+  Pending p;
+  p.echo_id = ECHO_ID_RX;
+  p.timestamp_us = timestamp_us;
+  p.flags = 0;
+  p.echo_only = false;
+  p.frame = frame;
+  in_queue_.push(p);
+}
+
+size_t GsUsb::nextInFrame(uint8_t* out) {
+  Pending p;
+  if (!in_queue_.pop(&p)) return 0;
+  putLe32(out, p.echo_id);
+  putLe32(out + 4, p.frame.id | (p.frame.extended ? (uint32_t)CAN_ID_EFF : 0u));
+  out[8] = p.frame.dlc;
+  out[9] = 0;  // channel
+  out[10] = p.flags;
+  out[11] = 0;
+  memcpy(out + 12, p.frame.data, 8);
+  if (!hw_timestamp_) return kFrameSize;
+  putLe32(out + 20, p.timestamp_us);
+  return kFrameSizeTimestamp;
+}
@@ -0,0 +1,114 @@
+#pragma once
+#include "can_rx_filter.h"
+#include "can_transport.h"
+#include "ring_buffer.h"
+
+// gs_usb (candleLight) protocol, the binary format used by Linux's
+// gs_usb driver. This is the transport-independent half: vendor control
+// requests and host frames in/out. The TinyUSB glue lives in
+// usb_gs_device.cpp.
+//
+// Host frame (little-endian, 20 bytes, +4 with hardware timestamps):
+//   u32 echo_id, u32 can_id (bit 31 EFF, 30 RTR, 29 ERR), u8 can_dlc,
+//   u8 channel, u8 flags, u8 reserved, u8 data[8], [u32 timestamp_us]
+// echo_id 0xFFFFFFFF marks a received frame; anything else is the echo
+// of a frame the host asked us to send.
+class GsUsb {
+public:
+  enum Request : uint8_t {
+    BREQ_HOST_FORMAT   = 0,
+    BREQ_BITTIMING     = 1,
+    BREQ_MODE          = 2,
+    BREQ_BERR          = 3,
+    BREQ_BT_CONST      = 4,
+    BREQ_DEVICE_CONFIG = 5,
+    BREQ_TIMESTAMP     = 6,
+    BREQ_IDENTIFY      = 7,
+  };
+
+  enum : uint32_t {
+    FEATURE_LISTEN_ONLY  = 1u << 0,
+    FEATURE_HW_TIMESTAMP = 1u << 4,
+    FEATURE_IDENTIFY     = 1u << 5,
+
+    MODE_RESET = 0,
+    MODE_START = 1,
+    MODE_FLAG_HW_TIMESTAMP = 1u << 4,
+
+    ECHO_ID_RX = 0xFFFFFFFFu,
+    CAN_ID_EFF = 0x80000000u,
+    CAN_ID_RTR = 0x40000000u,
+    CAN_ID_ERR = 0x20000000u,
+  };
+
+  static const size_t kFrameSize = 20;
+  // TX contexts in the Linux driver, i.e. host frames in flight
+  static const size_t kTxSlots = 10;
+  static const size_t kFrameSizeTimestamp = 24;
+
+  // MCP2515: TQ = 2 * BRP / 16 MHz, i.e. an 8 MHz CAN clock
+  static const uint32_t kCanClock = 8000000;
+
+  // `bitrate` is what the bus is already running at. The controller is
+  // shared with the gateway, so MODE_START only re-initialises it for a
+  // different rate; while started, the shared acceptance filter passes
+  // every frame.
+  GsUsb(CanTransport& can, CanRxFilter& filter, uint32_t bitrate)
+    : can_(can), filter_(filter), active_bitrate_(bitrate) {}
+
+  // Vendor control requests. controlIn returns the reply length or -1 to
+  // stall; controlOut returns false to stall. BITTIMING stalls unless the
+  // timing comes out at one of the standard rates the transports take
+  // (10k..1M, as slcan's Sn), so `ip link set ... bitrate` fails loudly
+  // instead of running the bus at a rate nobody asked for.
+  int controlIn(uint8_t request, uint8_t* buf, uint16_t max, uint32_t now_us);
+  bool controlOut(uint8_t request, const uint8_t* data, uint16_t len);
+
+  // Bulk OUT: queue the frame for transmission. False for short frames
+  // or when the channel is not started. Every accepted frame gets its
+  // echo, since the Linux driver only has kTxSlots TX contexts and stalls
+  // for good if one is never returned: frames wait in the TX queue until
+  // the controller takes them, and RTR/error frames, which the
+  // transports cannot send, are echoed without going out.
+  bool onHostFrame(const uint8_t* data, size_t len, uint32_t now_us);
+  // Room for another host frame; the glue leaves bulk OUT unarmed
+  // (NAKing the host) until there is.
+  bool txReady() const { return tx_queue_.size() < tx_queue_.capacity(); }
+  // Retry queued host frames, oldest first, while the controller and the
+  // IN queue take them. Called from the loop.
+  void service(uint32_t now_us);
+  // Queue a received CAN frame for the host (ignored when not started)
+  void onReceive(const CanFrame& frame, uint32_t timestamp_us);
+
+  // Next bulk IN frame; returns its length or 0 if nothing is queued.
+  size_t nextInFrame(uint8_t* out);
+  size_t frameSize() const { return hw_timestamp_ ? kFrameSizeTimestamp : kFrameSize; }
+
+  bool started() const { return started_; }
+  uint32_t bitrate() const { return bitrate_; }
+  uint32_t dropped() const { return in_queue_.dropped() + rx_overruns_; }
+  size_t txPending() const { return tx_queue_.size(); }
+  bool identify() const { return identify_; }
+
+private:
+  void clearTx();
+
+  struct Pending {
+    uint32_t echo_id;
+    uint32_t timestamp_us;
+    uint8_t flags;
+    bool echo_only;  // host RTR/error frame: echoed, never sent
+    CanFrame frame;
+  };
+
+  CanTransport& can_;
+  CanRxFilter& filter_;
+  RingBuffer<Pending, 32> in_queue_;
+  RingBuffer<Pending, 16> tx_queue_;
+  bool started_ = false;
+  bool hw_timestamp_ = false;
+  bool identify_ = false;
+  uint32_t bitrate_ = 0;
+  uint32_t active_bitrate_;
+  uint32_t rx_overruns_ = 0;
+};
@@ -0,0 +1,81 @@
+#include "gateway_core.h"
+#include <string.h>
+#include "imu_codec.h"
+
+void gatewaySend(CanTransport& can, FILE* in, bool binary, GatewayClock clock,
+                 ImuPipeline& pipeline, GatewaySendStats* stats) {
+  float vals[IMU_CHANNELS];
+  CanFrame frames[IMU_CAN_FRAMES];
+  CanFrame stamp, sync;
+  uint64_t next_sync_us = 0;
+  uint8_t sync_seq = 0;
+
+  for (;;) {
+    if (binary) {
+      // Six little-endian float32 per sample
+      if (fread(vals, sizeof(float), IMU_CHANNELS, in) != IMU_CHANNELS) break;
+    } else {
+      char line[256];
+      if (!fgets(line, sizeof(line), in)) break;
+      size_t len = strcspn(line, "\r\n");
+      if (imuParseCsv(line, len, vals) != IMU_CHANNELS) {
+        stats->skipped++;
+        continue;
+      }
+    }
+    // Time sync as on the Pico; SocketCAN has no TX confirmation, so the
+    // FUP carries the time the SYNC write returned
+    const uint64_t now_us = clock();
+    if (now_us >= next_sync_us) {
+      canTsyncPackSync(sync_seq, &sync);
+      if (can.send(sync)) {
+        canTsyncPackFup(sync_seq, clock(), &sync);
+        can.send(sync);
+      }
+      sync_seq++;
+      next_sync_us = now_us + CAN_TSYNC_PERIOD_US;
+    }
+
+    stats->samples++;
+    if (!pipeline.push(vals, now_us, frames, &stamp)) continue;
+    if (!can.sendBatch(frames, IMU_CAN_FRAMES) || !can.send(stamp)) stats->failed++;
+    stats->groups++;
+  }
+}
+
+bool GatewayDump::onFrame(const CanFrame& f, uint64_t rx_us) {
+  frames_++;
+  bool placed = false;
+  if (tsync_.onFrame(f, rx_us)) {
+    const CanTimeSyncReceiver::Sample& s = tsync_.sample();
+    stamped_++;
+    age_sum_us_ += (double)(int64_t)(rx_us - s.local_us);
+    if (out_) {
+      fprintf(out_, "  -> #%u sampled at %.6f s local, %.0f us before its stamp arrived\n", s.seq,
+              s.local_us * 1e-6, (double)(int64_t)(rx_us - s.local_us));
+    }
+    placed = true;
+  }
+
+  if (out_) {
+    fprintf(out_, "  %s  %0*X   [%u] ", ifname_, f.extended ? 8 : 3, (unsigned)f.id, f.dlc);
+    for (uint8_t i = 0; i < f.dlc; i++) fprintf(out_, " %02X", f.data[i]);
+    fprintf(out_, "\n");
+  }
+
+  if (!imuUnpackFrame(f, values_)) return placed;
+  if (f.id != expect_) {
+    order_errors_++;
+    expect_ = IMU_CAN_BASE_ID;
+    if (f.id != expect_) return placed;
+  }
+  if (++expect_ == IMU_CAN_BASE_ID + IMU_CAN_FRAMES) {
+    expect_ = IMU_CAN_BASE_ID;
+    samples_++;
+    if (out_) {
+      fprintf(out_, "  -> %.3f %.3f %.3f | %.3f %.3f %.3f\n", values_[0], values_[1], values_[2],
+              values_[3], values_[4], values_[5]);
+    }
+  }
+  return placed;
+}
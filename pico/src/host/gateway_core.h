@@ -0,0 +1,51 @@
+#pragma once
+#include <stdio.h>
+#include "can_time_sync.h"
+#include "can_transport.h"
+#include "imu_pipeline.h"
+
+// The "send" and "dump" paths of the native gateway (gateway_host.cpp)
+// on any CanTransport and clock, so tests can run them over LoopbackCan.
+
+// Microsecond clock: CLOCK_MONOTONIC in the CLI, scripted in tests
+typedef uint64_t (*GatewayClock)();
+
+struct GatewaySendStats {
+  unsigned long samples = 0, groups = 0, failed = 0, skipped = 0;
+};
+
+// Samples from `in` (CSV lines, or six little-endian float32 with
+// `binary`), timed by `clock`, through `pipeline` as on the Pico -> IMU
+// groups, each followed by its 0x504 stamp, plus a SYNC/FUP pair every
+// CAN_TSYNC_PERIOD_US
+void gatewaySend(CanTransport& can, FILE* in, bool binary, GatewayClock clock,
+                 ImuPipeline& pipeline, GatewaySendStats* stats);
+
+// candump-style reader that also checks the 0x501..0x503 group order
+// and places stamped samples in the local clock
+class GatewayDump {
+public:
+  // One line per frame and decoded sample to `out` (nullptr: quiet)
+  GatewayDump(FILE* out, const char* ifname) : out_(out), ifname_(ifname) {}
+
+  // Feed one frame with its receive time; true when it completed a
+  // stamped sample (tsync().sample())
+  bool onFrame(const CanFrame& frame, uint64_t rx_us);
+
+  unsigned long frames() const { return frames_; }
+  unsigned long samples() const { return samples_; }
+  unsigned long orderErrors() const { return order_errors_; }
+  unsigned long stamped() const { return stamped_; }
+  // Mean time from sample to the arrival of its stamp
+  double meanAgeUs() const { return stamped_ ? age_sum_us_ / stamped_ : 0.0; }
+  const CanTimeSyncReceiver& tsync() const { return tsync_; }
+
+private:
+  FILE* out_;
+  const char* ifname_;
+  CanTimeSyncReceiver tsync_;
+  float values_[IMU_CHANNELS];
+  uint32_t expect_ = IMU_CAN_BASE_ID;
+  unsigned long frames_ = 0, samples_ = 0, order_errors_ = 0, stamped_ = 0;
+  double age_sum_us_ = 0;
+};
@@ -0,0 +1,239 @@
+// Native build of the gateway core (pio run -e native).
+//
+//   program send <ifname> [--binary] [--cal B,B,B,S,S,S] [--decim R[,T]] [--filt SPEC]
+//                                      samples on stdin -> CAN frames
+//   program dump <ifname> [--count N] [--quiet]
+//   program logdump <tty|->
+//   program tsyncsim [--seconds N] [--load 0..1] [--device-ppm P] ...
+//   program dspbench [--samples N] [--seed S]
+//
+// "send" runs the same parse/calibrate/decimate/filter/pack path as the
+// firmware (imu_pipeline.h), configured like its "cal", "decim" and
+// "filt" commands (--filt may repeat), "dump" is a
+// candump-style reader that also checks the 0x501..0x503 group order
+// (both in gateway_core.cpp), "logdump" decodes the firmware's binary
+// log from the debug CDC, "tsyncsim" checks the CAN time sync on a
+// simulated bus (tsync_sim.cpp), "dspbench" checks the packed filter
+// kernels against the scalar ones.
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include "log.h"
+#include "dsp_bench.h"
+#include "dsp_simd.h"
+#include "gateway_core.h"
+#include "socketcan.h"
+#include "tsync_sim.h"
+#include "usb_frame.h"
+
+static double nowSeconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint64_t nowMicros() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000u + ts.tv_nsec / 1000;
+}
+
+static void usage() {
+  fprintf(stderr,
+          "usage: program send <ifname> [--binary] [--cal <bias ax,ay,az>,<scale ax,ay,az>]\n"
+          "                    [--decim <ratio>[,<taps per phase>]] [--filt <ch>,<spec>]...\n"
+          "       program dump <ifname> [--count N] [--quiet]\n"
+          "       program logdump <tty|->\n"
+          "       program tsyncsim [--seconds N] [--rate HZ] [--load 0..1] [--usb-ms MS]\n"
+          "                        [--rx-jitter US] [--stamp-jitter US] [--device-ppm P]\n"
+          "                        [--receiver-ppm P] [--bitrate BPS] [--seed N]\n"
+          "       program dspbench [--samples N] [--seed S]\n");
+}
+
+// "--cal" argument: accelerometer bias then scale, as in the Pico's CAL report
+static bool parseCalibration(const char* arg, ImuCalibration* cal) {
+  float v[6];
+  const char* p = arg;
+  for (int i = 0; i < 6; i++) {
+    char* end;
+    v[i] = strtof(p, &end);
+    if (end == p || *end != (i < 5 ? ',' : '\0')) return false;
+    p = end + 1;
+  }
+  for (int i = 0; i < 3; i++) {
+    if (!(v[3 + i] > 0)) return false;
+  }
+  for (int i = 0; i < 3; i++) {
+    cal->bias[IMU_AX + i] = v[i];
+    cal->scale[IMU_AX + i] = v[3 + i];
+  }
+  return true;
+}
+
+// "--decim" argument, as the Pico's "decim,<ratio>[,<taps per phase>]"
+static bool parseDecimation(const char* arg, ImuDecimator* decim) {
+  char* end;
+  const unsigned long ratio = strtoul(arg, &end, 10);
+  const unsigned long per_phase = *end == ',' ? strtoul(end + 1, &end, 10)
+                                              : ImuDecimator::kMaxTapsPerPhase;
+  return end != arg && *end == '\0' && ratio <= ImuDecimator::kMaxRatio &&
+         per_phase <= ImuDecimator::kMaxTapsPerPhase &&
+         decim->configure((uint8_t)ratio, (uint8_t)per_phase);
+}
+
+static int cmdSend(SocketCan& can, bool binary, ImuPipeline& pipeline) {
+  GatewaySendStats stats;
+  const double t0 = nowSeconds();
+  gatewaySend(can, stdin, binary, nowMicros, pipeline, &stats);
+  const double dt = nowSeconds() - t0;
+  fprintf(stderr, "sent %lu samples as %lu groups (%lu failed, %lu skipped) in %.3f s, %.0f samples/s\n",
+          stats.samples, stats.groups, stats.failed, stats.skipped, dt,
+          dt > 0 ? stats.samples / dt : 0.0);
+  return stats.failed ? 1 : 0;
+}
+
+static int cmdDump(SocketCan& can, const char* ifname, unsigned long count, bool quiet) {
+  CanFrame f;
+  GatewayDump dump(quiet ? nullptr : stdout, ifname);
+  double t_first = 0, t_last = 0;
+
+  while (count == 0 || dump.samples() < count) {
+    if (!can.receiveWait(&f, count ? 2000 : -1)) break;  // idle: stop when counting
+    t_last = nowSeconds();
+    if (dump.frames() == 0) t_first = t_last;
+    dump.onFrame(f, nowMicros());
+  }
+
+  const double dt = t_last - t_first;
+  fprintf(stderr, "%lu frames, %lu samples, %lu order errors, %.0f samples/s\n",
+          dump.frames(), dump.samples(), dump.orderErrors(), dt > 0 ? dump.samples() / dt : 0.0);
+  const CanTimeSyncReceiver& tsync = dump.tsync();
+  if (tsync.syncs()) {
+    fprintf(stderr, "time sync: %u syncs, drift %d ppb, %lu stamped samples (%u lost), mean age %.0f us\n",
+            tsync.syncs(), tsync.driftPpb(), dump.stamped(), tsync.lostSamples(), dump.meanAgeUs());
+  }
+  return (dump.orderErrors() || (count && dump.samples() < count)) ? 1 : 0;
+}
+
+// Read USB_FRAME_LOG frames from the debug CDC (or stdin) and print them
+// as text; bytes outside a valid frame are passed through unchanged.
+static int cmdLogDump(const char* path) {
+  int fd = STDIN_FILENO;
+  if (strcmp(path, "-")) {
+    fd = open(path, O_RDONLY | O_NOCTTY);
+    if (fd < 0) {
+      perror(path);
+      return 1;
+    }
+    struct termios tio;
+    if (tcgetattr(fd, &tio) == 0) {
+      cfmakeraw(&tio);
+      tcsetattr(fd, TCSANOW, &tio);
+    }
+  }
+
+  UsbFrameDecoder dec;
+  usbFrameDecoderInit(&dec);
+  unsigned long records = 0, crc_errors = 0;
+  uint8_t buf[512];
+  ssize_t n;
+  auto handle = [&](uint8_t b) {
+    const UsbFrameEvent ev = usbFrameDecode(&dec, b);
+    if (ev == USB_DEC_BYTE) fputc(b, stdout);
+    if (ev == USB_DEC_BAD_CRC) crc_errors++;
+    if (ev != USB_DEC_FRAME) return;
+    if (dec.frame[1] != USB_FRAME_LOG || dec.frame[2] != LOG_RECORD_SIZE) return;
+
+    LogRecord rec;
+    char text[160];
+    logUnpackRecord(dec.frame + 3, &rec);
+    logFormat(rec, text, sizeof(text));
+    printf("[%10.6f] %-5s %s\n", rec.timestamp_us * 1e-6, logLevelName(rec.level), text);
+    records++;
+  };
+  while ((n = read(fd, buf, sizeof(buf))) > 0) {
+    for (ssize_t i = 0; i < n; i++) {
+      handle(buf[i]);
+      uint8_t r;
+      while (usbFrameReplay(&dec, &r)) handle(r);
+    }
+    fflush(stdout);
+  }
+  fprintf(stderr, "%lu records, %lu crc errors\n", records, crc_errors);
+  if (fd != STDIN_FILENO) close(fd);
+  return 0;
+}
+
+static uint32_t benchClock() { return (uint32_t)nowMicros(); }
+
+// Same check as the Pico's "dspbench"; on the host the packed kernels
+// run on emulated DSP instructions, so only the bit-exactness matters
+static int cmdDspBench(int argc, char** argv) {
+  unsigned long samples = 1000000, seed = 1;
+  for (int i = 0; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "--samples")) samples = strtoul(argv[i + 1], nullptr, 0);
+    else if (!strcmp(argv[i], "--seed")) seed = strtoul(argv[i + 1], nullptr, 0);
+    else { usage(); return 2; }
+  }
+  DspBenchResult r[DSP_BENCH_KERNELS];
+  dspBench((uint32_t)samples, (uint32_t)seed, benchClock, r);
+  int failed = 0;
+  printf("packed kernels: %s\n", DSP_HAVE_SIMD ? "DSP extension" : "emulated");
+  for (const DspBenchResult& k : r) {
+    printf("%-12s %8lu samples  %lu mismatches  scalar %.1f ns/sample  packed %.1f ns/sample\n",
+           k.kernel, (unsigned long)k.samples, (unsigned long)k.mismatches,
+           k.scalar_us * 1e3 / k.samples, k.simd_us * 1e3 / k.samples);
+    if (k.mismatches) failed = 1;
+  }
+  return failed;
+}
+
+int main(int argc, char** argv) {
+  if (argc >= 2 && !strcmp(argv[1], "tsyncsim")) return runTimeSyncSim(argc - 2, argv + 2);
+  if (argc >= 2 && !strcmp(argv[1], "dspbench")) return cmdDspBench(argc - 2, argv + 2);
+  if (argc < 3) {
+    usage();
+    return 2;
+  }
+  const char* cmd = argv[1];
+  const char* ifname = argv[2];
+  if (!strcmp(cmd, "logdump")) return cmdLogDump(ifname);
+  bool binary = false, quiet = false;
+  unsigned long count = 0;
+  ImuPipeline pipeline;
+  for (int i = 3; i < argc; i++) {
+    const bool has_arg = i + 1 < argc;
+    if (!strcmp(argv[i], "--binary")) binary = true;
+    else if (!strcmp(argv[i], "--cal") && has_arg) {
+      if (!parseCalibration(argv[++i], &pipeline.calibration())) {
+        fprintf(stderr, "bad --cal %s\n", argv[i]);
+        return 2;
+      }
+    } else if (!strcmp(argv[i], "--decim") && has_arg) {
+      if (!parseDecimation(argv[++i], &pipeline.decimator())) {
+        fprintf(stderr, "bad --decim %s\n", argv[i]);
+        return 2;
+      }
+    } else if (!strcmp(argv[i], "--filt") && has_arg) {
+      if (!pipeline.filter().configure(argv[++i])) {
+        fprintf(stderr, "bad --filt %s\n", argv[i]);
+        return 2;
+      }
+    }
+    else if (!strcmp(argv[i], "--quiet")) quiet = true;
+    else if (!strcmp(argv[i], "--count") && has_arg) count = strtoul(argv[++i], nullptr, 0);
+    else { usage(); return 2; }
+  }
+
+  SocketCan can(ifname);
+  if (!can.begin(0)) return 1;
+
+  if (!strcmp(cmd, "send")) return cmdSend(can, binary, pipeline);
+  if (!strcmp(cmd, "dump")) return cmdDump(can, ifname, count, quiet);
+  usage();
+  return 2;
+}
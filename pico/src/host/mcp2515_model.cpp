@@ -0,0 +1,290 @@
+#include "mcp2515_model.h"
+#include <string.h>
+
+// Register offsets not named in Mcp2515
+static const uint8_t kRegCnf1 = 0x2A;
+static const uint8_t kRegEflg = 0x2D;
+static const uint8_t kRegRxb0Sidh = 0x61;
+static const uint8_t kRegRxb1Sidh = 0x71;
+
+static const uint8_t kTxReq = 0x08;         // TXBnCTRL.TXREQ
+static const uint8_t kTxpMask = 0x03;       // TXBnCTRL.TXP
+static const uint8_t kRxmMask = 0x60;       // RXBnCTRL.RXM
+static const uint8_t kBukt = 0x04;          // RXB0CTRL.BUKT
+static const uint8_t kRx0Ovr = 0x40, kRx1Ovr = 0x80;  // EFLG
+static const uint8_t kExide = 0x08;         // SIDL.EXIDE / IDE
+
+// RXF0..RXF5 and RXM0/RXM1 base addresses
+static const uint8_t kFilterAddr[6] = {0x00, 0x04, 0x08, 0x10, 0x14, 0x18};
+static const uint8_t kMaskAddr[2] = {0x20, 0x24};
+
+void Mcp2515Model::reset() {
+  memset(regs_, 0, sizeof(regs_));
+  regs_[Mcp2515::REG_CANCTRL] = 0x87;
+  regs_[Mcp2515::REG_CANSTAT] = Mcp2515::MODE_CONFIG;
+  pending_mode_ = Mcp2515::MODE_CONFIG;
+  mode_reads_ = 0;
+}
+
+void Mcp2515Model::select() {
+  selected_ = true;
+  state_ = INSTR;
+  byte_ = 0;
+  clear_on_deselect_ = 0;
+}
+
+void Mcp2515Model::deselect() {
+  // READ RX BUFFER clears the buffer's flag when CS goes high
+  regs_[Mcp2515::REG_CANINTF] &= (uint8_t)~clear_on_deselect_;
+  clear_on_deselect_ = 0;
+  selected_ = false;
+  state_ = IDLE;
+}
+
+void Mcp2515Model::transfer(const uint8_t* tx, uint8_t* rx, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    const uint8_t out = selected_ ? exchange(tx ? tx[i] : 0) : 0xFF;
+    if (rx) rx[i] = out;
+    if (selected_) spi_bytes_++;
+  }
+}
+
+bool Mcp2515Model::writable(uint8_t addr) const {
+  // Filters, masks and CNF1..3 only change in configuration mode
+  const bool config_only = addr <= 0x1B || (addr >= 0x20 && addr <= kRegCnf1);
+  if ((addr & 0x0F) == Mcp2515::REG_CANSTAT || (addr & 0x0F) == Mcp2515::REG_CANCTRL) {
+    return (addr & 0x0F) == Mcp2515::REG_CANCTRL;
+  }
+  if (config_only && mode() != Mcp2515::MODE_CONFIG) return false;
+  // A buffer queued for transmission is locked until it has been sent
+  if (addr >= 0x31 && addr <= 0x5D && (addr & 0x0F) >= 0x01) {
+    const uint8_t ctrl = regs_[addr & 0xF0];
+    if (ctrl & kTxReq) return false;
+  }
+  return true;
+}
+
+void Mcp2515Model::writeReg(uint8_t addr, uint8_t value) {
+  addr &= 0x7F;
+  if (!writable(addr)) return;
+  if ((addr & 0x0F) == Mcp2515::REG_CANCTRL) {
+    regs_[Mcp2515::REG_CANCTRL] = value;
+    pending_mode_ = value & Mcp2515::MODE_MASK;
+    mode_reads_ = mode_delay;
+    if (mode_reads_ == 0) {
+      regs_[Mcp2515::REG_CANSTAT] = (uint8_t)((regs_[Mcp2515::REG_CANSTAT] & ~Mcp2515::MODE_MASK) | pending_mode_);
+    }
+    return;
+  }
+  if (addr == Mcp2515::REG_RXB0CTRL) value = (uint8_t)((regs_[addr] & ~0x64) | (value & 0x64));
+  if (addr == Mcp2515::REG_RXB1CTRL) value = (uint8_t)((regs_[addr] & ~0x60) | (value & 0x60));
+  regs_[addr] = value;
+}
+
+uint8_t Mcp2515Model::readReg(uint8_t addr) {
+  addr &= 0x7F;
+  if ((addr & 0x0F) == Mcp2515::REG_CANSTAT) {
+    const uint8_t v = regs_[Mcp2515::REG_CANSTAT];
+    if (mode_reads_ > 0 && --mode_reads_ == 0) {
+      regs_[Mcp2515::REG_CANSTAT] = (uint8_t)((v & ~Mcp2515::MODE_MASK) | pending_mode_);
+    }
+    return v;
+  }
+  if ((addr & 0x0F) == Mcp2515::REG_CANCTRL) return regs_[Mcp2515::REG_CANCTRL];
+  return regs_[addr];
+}
+
+uint8_t Mcp2515Model::exchange(uint8_t in) {
+  switch (state_) {
+    case INSTR:
+      if (in == Mcp2515::INSTR_RESET) {
+        reset();
+        resets_++;
+        // The oscillator restarts; CANSTAT reads 0 until it runs
+        if (mode_delay > 0) {
+          regs_[Mcp2515::REG_CANSTAT] = 0;
+          mode_reads_ = mode_delay;
+        }
+        state_ = IGNORE;
+      } else if (in == Mcp2515::INSTR_READ) {
+        state_ = READ;
+      } else if (in == Mcp2515::INSTR_WRITE) {
+        state_ = WRITE;
+      } else if (in == Mcp2515::INSTR_BIT_MODIFY) {
+        state_ = MODIFY;
+      } else if (in == Mcp2515::INSTR_READ_STATUS) {
+        CanFrame frame;
+        if (auto_tx > 0 && ++status_reads_ % auto_tx == 0 && transmit(&frame)) {
+          sent_.push_back(frame);
+        }
+        state_ = STATUS;
+      } else if ((in & 0xF8) == Mcp2515::INSTR_LOAD_TX && (in & 0x07) <= 5) {
+        // abc: TXB0 SIDH, TXB0 D0, TXB1 SIDH, ...
+        addr_ = (uint8_t)(0x30 + 0x10 * ((in & 0x07) >> 1) + ((in & 0x01) ? 0x06 : 0x01));
+        state_ = LOAD_TX;
+      } else if ((in & 0xF8) == Mcp2515::INSTR_RTS) {
+        for (uint8_t n = 0; n < Mcp2515::kTxBuffers; n++) {
+          if (in & (1u << n)) regs_[Mcp2515::REG_TXB0CTRL + 0x10 * n] |= kTxReq;
+        }
+        state_ = IGNORE;
+      } else if ((in & 0xF9) == Mcp2515::INSTR_READ_RX) {
+        const uint8_t n = (in >> 2) & 1;
+        addr_ = (uint8_t)((n ? kRegRxb1Sidh : kRegRxb0Sidh) + ((in & 0x02) ? 0x05 : 0x00));
+        clear_on_deselect_ = (uint8_t)(1u << n);
+        state_ = READ_RX;
+      } else {
+        state_ = IGNORE;
+      }
+      return 0;
+
+    case READ:
+      if (byte_++ == 0) {
+        addr_ = in & 0x7F;
+        return 0;
+      }
+      return readReg(addr_++);
+
+    case WRITE:
+      if (byte_++ == 0) {
+        addr_ = in & 0x7F;
+      } else {
+        writeReg(addr_++, in);
+      }
+      return 0;
+
+    case MODIFY:
+      if (byte_ == 0) addr_ = in & 0x7F;
+      else if (byte_ == 1) modify_mask_ = in;
+      else if (byte_ == 2) {
+        const uint8_t cur = (addr_ & 0x0F) == Mcp2515::REG_CANCTRL ? regs_[Mcp2515::REG_CANCTRL] : regs_[addr_];
+        writeReg(addr_, (uint8_t)((cur & ~modify_mask_) | (in & modify_mask_)));
+      }
+      byte_++;
+      return 0;
+
+    case LOAD_TX:
+      // Stays within the buffer (SIDH..D7)
+      if ((addr_ & 0x0F) <= 0x0D) writeReg(addr_++, in);
+      return 0;
+
+    case STATUS: {
+      const uint8_t intf = regs_[Mcp2515::REG_CANINTF];
+      uint8_t s = intf & 0x03;
+      for (uint8_t n = 0; n < Mcp2515::kTxBuffers; n++) {
+        if (regs_[Mcp2515::REG_TXB0CTRL + 0x10 * n] & kTxReq) s |= (uint8_t)(0x04 << (2 * n));
+        if (intf & (0x04 << n)) s |= (uint8_t)(0x08 << (2 * n));
+      }
+      return s;
+    }
+
+    case READ_RX:
+      if ((addr_ & 0x0F) <= 0x0D) return regs_[addr_++];
+      return 0;
+
+    default:
+      return 0;
+  }
+}
+
+uint8_t Mcp2515Model::txPending() const {
+  uint8_t n = 0;
+  for (uint8_t b = 0; b < Mcp2515::kTxBuffers; b++) {
+    if (regs_[Mcp2515::REG_TXB0CTRL + 0x10 * b] & kTxReq) n++;
+  }
+  return n;
+}
+
+bool Mcp2515Model::transmit(CanFrame* frame, uint8_t* buffer) {
+  if (mode() != Mcp2515::MODE_NORMAL) return false;
+  int best = -1;
+  for (int b = 0; b < Mcp2515::kTxBuffers; b++) {
+    const uint8_t ctrl = regs_[Mcp2515::REG_TXB0CTRL + 0x10 * b];
+    if (!(ctrl & kTxReq)) continue;
+    // Equal TXP: the higher buffer number goes first
+    if (best < 0 || (ctrl & kTxpMask) >= (regs_[Mcp2515::REG_TXB0CTRL + 0x10 * best] & kTxpMask)) {
+      best = b;
+    }
+  }
+  if (best < 0) return false;
+
+  const uint8_t base = (uint8_t)(Mcp2515::REG_TXB0CTRL + 0x10 * best);
+  Mcp2515::decodeHeader(regs_ + base + 1, frame);
+  memset(frame->data, 0, sizeof(frame->data));
+  memcpy(frame->data, regs_ + base + 6, frame->dlc);
+  regs_[base] &= (uint8_t)~kTxReq;
+  regs_[Mcp2515::REG_CANINTF] |= (uint8_t)(0x04 << best);
+  if (buffer) *buffer = (uint8_t)best;
+  return true;
+}
+
+bool Mcp2515Model::filterMatch(uint8_t filter, uint8_t mask, const CanFrame& frame) const {
+  const uint8_t* f = regs_ + kFilterAddr[filter];
+  const uint8_t* m = regs_ + kMaskAddr[mask];
+  // EXIDE selects which frame format the filter applies to
+  if (((f[1] & kExide) != 0) != frame.extended) return false;
+  uint8_t hdr[5];
+  Mcp2515::encodeHeader(frame, hdr);
+  if (!frame.extended) {
+    // Standard frames: EID8/EID0 filter the first two data bytes
+    hdr[2] = frame.dlc > 0 ? frame.data[0] : 0;
+    hdr[3] = frame.dlc > 1 ? frame.data[1] : 0;
+  }
+  const uint8_t sidl_bits = frame.extended ? 0xE3 : 0xE0;
+  if ((hdr[0] ^ f[0]) & m[0]) return false;
+  if ((hdr[1] ^ f[1]) & m[1] & sidl_bits) return false;
+  if ((hdr[2] ^ f[2]) & m[2]) return false;
+  if ((hdr[3] ^ f[3]) & m[3]) return false;
+  return true;
+}
+
+void Mcp2515Model::store(uint8_t rxb, const CanFrame& frame, uint8_t filhit) {
+  uint8_t* r = regs_ + (rxb ? kRegRxb1Sidh : kRegRxb0Sidh);
+  Mcp2515::encodeHeader(frame, r);
+  memset(r + 5, 0, 8);
+  memcpy(r + 5, frame.data, r[4]);
+  if (rxb == 0) {
+    regs_[Mcp2515::REG_RXB0CTRL] = (uint8_t)((regs_[Mcp2515::REG_RXB0CTRL] & ~0x01) | (filhit & 0x01));
+  } else {
+    regs_[Mcp2515::REG_RXB1CTRL] = (uint8_t)((regs_[Mcp2515::REG_RXB1CTRL] & ~0x07) | (filhit & 0x07));
+  }
+  regs_[Mcp2515::REG_CANINTF] |= (uint8_t)(1u << rxb);
+}
+
+bool Mcp2515Model::deliver(const CanFrame& frame) {
+  if (mode() != Mcp2515::MODE_NORMAL) return false;
+  const uint8_t ctrl0 = regs_[Mcp2515::REG_RXB0CTRL];
+  const uint8_t ctrl1 = regs_[Mcp2515::REG_RXB1CTRL];
+  const uint8_t intf = regs_[Mcp2515::REG_CANINTF];
+
+  int hit0 = -1;
+  if ((ctrl0 & kRxmMask) == kRxmMask) hit0 = 0;
+  else if (filterMatch(0, 0, frame)) hit0 = 0;
+  else if (filterMatch(1, 0, frame)) hit0 = 1;
+  if (hit0 >= 0) {
+    if (!(intf & 0x01)) {
+      store(0, frame, (uint8_t)hit0);
+      return true;
+    }
+    if ((ctrl0 & kBukt) && !(intf & 0x02)) {
+      store(1, frame, (uint8_t)hit0);
+      return true;
+    }
+    regs_[kRegEflg] |= (ctrl0 & kBukt) ? kRx1Ovr : kRx0Ovr;
+    overflows_++;
+    return false;
+  }
+
+  int hit1 = -1;
+  if ((ctrl1 & kRxmMask) == kRxmMask) hit1 = 2;
+  for (uint8_t n = 2; hit1 < 0 && n < Mcp2515::kFilters; n++) {
+    if (filterMatch(n, 1, frame)) hit1 = n;
+  }
+  if (hit1 < 0) return false;
+  if (intf & 0x02) {
+    regs_[kRegEflg] |= kRx1Ovr;
+    overflows_++;
+    return false;
+  }
+  store(1, frame, (uint8_t)hit1);
+  return true;
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <vector>
+#include "mcp2515.h"
+
+// Register-level MCP2515 behind the SpiBus interface, for running the
+// Mcp2515 driver on the host. Implements the instructions the driver
+// uses (RESET, READ, WRITE, BIT MODIFY, LOAD TX BUFFER, RTS, READ STATUS,
+// READ RX BUFFER) byte by byte, and the controller side of the bus:
+// transmit() starts the TX buffer the chip would pick, deliver() runs a
+// frame through the masks and filters into RXB0/RXB1.
+//
+// Like the chip, CNF1..3 and the mask/filter registers only take writes
+// in configuration mode, and a requested mode shows up in CANSTAT after
+// `mode_delay` reads.
+class Mcp2515Model : public SpiBus {
+public:
+  Mcp2515Model() { reset(); }
+
+  void select() override;
+  void deselect() override;
+  void transfer(const uint8_t* tx, uint8_t* rx, size_t len) override;
+
+  // Power-on / RESET instruction state: configuration mode, all
+  // registers cleared
+  void reset();
+
+  // Next frame the controller puts on the bus: among buffers with TXREQ
+  // set, the highest TXP wins and on equal TXP the higher buffer number
+  // (datasheet 3.2). Clears TXREQ and sets TXnIF. False when nothing is
+  // pending or the chip is not in normal mode.
+  bool transmit(CanFrame* frame, uint8_t* buffer = nullptr);
+  // Number of TX buffers with TXREQ set
+  uint8_t txPending() const;
+
+  // Frame from another node. RXB0 takes RXF0/RXF1 matches and rolls over
+  // into RXB1 when full and BUKT is set; RXB1 takes RXF2..RXF5 matches.
+  // False when the filters reject the frame or its buffer is still full
+  // (counted in overflows()).
+  bool deliver(const CanFrame& frame);
+
+  uint8_t reg(uint8_t addr) const { return regs_[addr & 0x7F]; }
+  uint8_t mode() const { return regs_[Mcp2515::REG_CANSTAT] & Mcp2515::MODE_MASK; }
+  uint32_t overflows() const { return overflows_; }
+  uint32_t resets() const { return resets_; }
+  // Bytes clocked while CS was asserted
+  uint32_t spiBytes() const { return spi_bytes_; }
+
+  // CANSTAT reads before a mode request (or the reset) takes effect
+  int mode_delay = 0;
+  // When > 0, the bus takes one frame (as transmit() picks it) every
+  // `auto_tx` READ STATUS instructions, so frames leave while the driver
+  // polls; they are appended to sent()
+  int auto_tx = 0;
+  const std::vector<CanFrame>& sent() const { return sent_; }
+
+private:
+  enum State : uint8_t { IDLE, INSTR, READ, WRITE, MODIFY, LOAD_TX, STATUS, READ_RX, IGNORE };
+
+  uint8_t exchange(uint8_t in);
+  void writeReg(uint8_t addr, uint8_t value);
+  uint8_t readReg(uint8_t addr);
+  bool writable(uint8_t addr) const;
+  bool filterMatch(uint8_t filter, uint8_t mask, const CanFrame& frame) const;
+  void store(uint8_t rxb, const CanFrame& frame, uint8_t filhit);
+
+  uint8_t regs_[128];
+  bool selected_ = false;
+  State state_ = IDLE;
+  uint8_t addr_ = 0;
+  uint8_t byte_ = 0;          // bytes after the instruction
+  uint8_t modify_mask_ = 0;
+  uint8_t clear_on_deselect_ = 0;  // RXnIF bit cleared by READ RX BUFFER
+  uint8_t pending_mode_ = 0;
+  int mode_reads_ = 0;
+  int status_reads_ = 0;
+  std::vector<CanFrame> sent_;
+  uint32_t overflows_ = 0;
+  uint32_t resets_ = 0;
+  uint32_t spi_bytes_ = 0;
+};
@@ -0,0 +1,103 @@
+#include "socketcan.h"
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <linux/can.h>
+#include <linux/can/raw.h>
+
+SocketCan::~SocketCan() {
+  if (fd_ >= 0) close(fd_);
+}
+
+bool SocketCan::begin(uint32_t bitrate) {
+  (void)bitrate;
+  fd_ = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+  if (fd_ < 0) {
+    perror("socket(PF_CAN)");
+    return false;
+  }
+
+  struct ifreq ifr;
+  memset(&ifr, 0, sizeof(ifr));
+  strncpy(ifr.ifr_name, ifname_, IFNAMSIZ - 1);
+  if (ioctl(fd_, SIOCGIFINDEX, &ifr) < 0) {
+    perror(ifname_);
+    return false;
+  }
+
+  struct sockaddr_can addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.can_family = AF_CAN;
+  addr.can_ifindex = ifr.ifr_ifindex;
+  if (bind(fd_, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+    perror("bind");
+    return false;
+  }
+  return true;
+}
+
+bool SocketCan::sendBatch(const CanFrame* frames, uint8_t count) {
+  for (uint8_t i = 0; i < count; i++) {
+    struct can_frame f;
+    memset(&f, 0, sizeof(f));
+    f.can_id = frames[i].extended ? ((frames[i].id & CAN_EFF_MASK) | CAN_EFF_FLAG)
+                                  : (frames[i].id & CAN_SFF_MASK);
+    f.can_dlc = frames[i].dlc > 8 ? 8 : frames[i].dlc;
+    memcpy(f.data, frames[i].data, f.can_dlc);
+
+    // ENOBUFS: the interface queue is full; wait for room like a TX buffer
+    for (;;) {
+      if (write(fd_, &f, sizeof(f)) == (ssize_t)sizeof(f)) break;
+      if (errno != ENOBUFS && errno != EAGAIN) return false;
+      struct pollfd p = {fd_, POLLOUT, 0};
+      poll(&p, 1, 10);
+    }
+  }
+  return true;
+}
+
+static bool readFrame(int fd, CanFrame* frame, int flags) {
+  struct can_frame f;
+  const ssize_t n = recv(fd, &f, sizeof(f), flags);
+  if (n != (ssize_t)sizeof(f)) return false;
+  if (f.can_id & (CAN_RTR_FLAG | CAN_ERR_FLAG)) return false;
+  frame->extended = (f.can_id & CAN_EFF_FLAG) != 0;
+  frame->id = f.can_id & (frame->extended ? CAN_EFF_MASK : CAN_SFF_MASK);
+  frame->dlc = f.can_dlc > 8 ? 8 : f.can_dlc;
+  memset(frame->data, 0, sizeof(frame->data));
+  memcpy(frame->data, f.data, frame->dlc);
+  return true;
+}
+
+bool SocketCan::receive(CanFrame* frame) {
+  return readFrame(fd_, frame, MSG_DONTWAIT);
+}
+
+bool SocketCan::receiveWait(CanFrame* frame, int timeout_ms) {
+  struct pollfd p = {fd_, POLLIN, 0};
+  if (poll(&p, 1, timeout_ms) <= 0) return false;
+  return readFrame(fd_, frame, 0);
+}
+
+bool SocketCan::setAcceptanceIds(const uint32_t* ids, uint8_t count) {
+  struct can_filter filters[kMaxIds];
+  if (count > kMaxIds) return false;
+  for (uint8_t i = 0; i < count; i++) {
+    filters[i].can_id = ids[i] > CAN_SFF_MASK ? (ids[i] | CAN_EFF_FLAG) : ids[i];
+    filters[i].can_mask = ids[i] > CAN_SFF_MASK ? (CAN_EFF_MASK | CAN_EFF_FLAG)
+                                                : (CAN_SFF_MASK | CAN_EFF_FLAG);
+  }
+  if (count == 0) {
+    // Default: one filter that accepts everything
+    filters[0].can_id = 0;
+    filters[0].can_mask = 0;
+    count = 1;
+  }
+  return setsockopt(fd_, SOL_CAN_RAW, CAN_RAW_FILTER, filters,
+                    count * sizeof(filters[0])) == 0;
+}
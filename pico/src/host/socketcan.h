@@ -0,0 +1,27 @@
+#pragma once
+#include "can_transport.h"
+
+// Linux SocketCAN back end (vcan0, can0, slcan0, ...) for the native
+// build. Bitrate is configured with `ip link`, so begin() only opens and
+// binds the raw socket.
+class SocketCan : public CanTransport {
+public:
+  explicit SocketCan(const char* ifname) : ifname_(ifname) {}
+  ~SocketCan() override;
+
+  bool begin(uint32_t bitrate) override;
+  bool sendBatch(const CanFrame* frames, uint8_t count) override;
+  bool receive(CanFrame* frame) override;
+  // Up to kMaxIds exact-match filters (standard or extended)
+  bool setAcceptanceIds(const uint32_t* ids, uint8_t count) override;
+  static constexpr uint8_t kMaxIds = 32;
+  const char* name() const override { return "socketcan"; }
+
+  // Block until a frame arrives or timeout_ms passes (-1: forever)
+  bool receiveWait(CanFrame* frame, int timeout_ms);
+  int fd() const { return fd_; }
+
+private:
+  const char* ifname_;
+  int fd_ = -1;
+};
@@ -0,0 +1,313 @@
+// Simulated bus for the CAN time sync.
+//
+// True time is in nanoseconds. The gateway and the receiver each run a
+// microsecond clock with its own offset and drift. The gateway's sends
+// go through the MCP2515 driver's TX queue into the three TX buffers the
+// way Mcp2515 loads them (TXP 3, 2, 1 on TXB0..TXB2, a frame only into a
+// buffer after the last pending one), and only the highest-priority
+// pending buffer enters arbitration. Frames compete on a 1 Mbps bus with background traffic
+// (lower IDs win), and each frame's end-of-frame instant is what both
+// sides timestamp: the gateway after waitTxDone() (plus poll latency),
+// the receiver in its RX ISR (plus jitter). The receiver's reconstructed
+// sample times are compared with the true sample instants on the
+// receiver clock, next to the naive alternative of using the arrival
+// time of 0x501.
+#include "tsync_sim.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <deque>
+#include <random>
+#include <vector>
+#include "can_time_sync.h"
+#include "can_wire.h"
+
+namespace {
+
+struct SimClock {
+  double offset_us;
+  double ppm;
+  uint64_t at(double true_ns) const {
+    return (uint64_t)(offset_us + true_ns * 1e-3 * (1.0 + ppm * 1e-6));
+  }
+};
+
+struct SimFrame {
+  CanFrame frame;
+  double ready_ns;  // queued in the controller
+  int group;        // IMU group index, -1 otherwise (kSyncGroup: SYNC)
+};
+
+const int kSyncGroup = -2;
+
+// One sendBatch() call of the gateway
+struct GatewaySend {
+  CanFrame frames[IMU_CAN_FRAMES];
+  uint8_t count;
+  double ready_ns;
+  int group;
+};
+
+// TXB0..TXB2 of the gateway's controller
+struct TxBuffers {
+  SimFrame buf[3];
+  uint8_t txp[3];
+  bool pending[3] = {false, false, false};
+
+  // Queued frames into the buffers after the last pending one, as
+  // Mcp2515::loadTx does; TXP 3 - n on TXBn, as Mcp2515::begin()
+  // programs them
+  void load(std::deque<SimFrame>& queue) {
+    int first = 0;
+    for (int n = 0; n < 3; n++) {
+      if (pending[n]) first = n + 1;
+    }
+    for (int n = first; n < 3 && !queue.empty(); n++) {
+      buf[n] = queue.front();
+      queue.pop_front();
+      txp[n] = (uint8_t)(3 - n);
+      pending[n] = true;
+    }
+  }
+  // Buffer the controller offers to arbitration: highest TXP, the higher
+  // buffer number on a tie; -1 when none is pending
+  int next() const {
+    int best = -1;
+    for (int n = 0; n < 3; n++) {
+      if (pending[n] && (best < 0 || txp[n] >= txp[best])) best = n;
+    }
+    return best;
+  }
+};
+
+struct ErrorStats {
+  double sum = 0, sum_sq = 0, max_abs = 0;
+  unsigned long n = 0;
+  void add(double e) {
+    sum += e;
+    sum_sq += e * e;
+    if (fabs(e) > max_abs) max_abs = fabs(e);
+    n++;
+  }
+  void print(const char* label) const {
+    if (!n) {
+      printf("%-8s no samples\n", label);
+      return;
+    }
+    printf("%-8s mean %8.1f us  rms %8.1f us  max %8.1f us\n", label, sum / n,
+           sqrt(sum_sq / n), max_abs);
+  }
+};
+
+struct Group {
+  double sample_ns;   // true sample instant
+  double first_rx_ns; // arrival of 0x501
+};
+
+}  // namespace
+
+int runTimeSyncSim(int argc, char** argv) {
+  double seconds = 60, rate_hz = 100, load = 0.3;
+  double usb_ms = 2, rx_jitter_us = 5, stamp_jitter_us = 0;
+  uint32_t bitrate = 1000000;
+  SimClock device = {123456789.0, 40.0};
+  SimClock receiver = {5000.0, -25.0};
+  unsigned seed = 1;
+
+  for (int i = 0; i + 1 < argc; i += 2) {
+    const char* opt = argv[i];
+    const double v = atof(argv[i + 1]);
+    if (!strcmp(opt, "--seconds")) seconds = v;
+    else if (!strcmp(opt, "--rate")) rate_hz = v;
+    else if (!strcmp(opt, "--load")) load = v;
+    else if (!strcmp(opt, "--usb-ms")) usb_ms = v;
+    else if (!strcmp(opt, "--rx-jitter")) rx_jitter_us = v;
+    else if (!strcmp(opt, "--stamp-jitter")) stamp_jitter_us = v;
+    else if (!strcmp(opt, "--device-ppm")) device.ppm = v;
+    else if (!strcmp(opt, "--receiver-ppm")) receiver.ppm = v;
+    else if (!strcmp(opt, "--bitrate")) bitrate = (uint32_t)v;
+    else if (!strcmp(opt, "--seed")) seed = (unsigned)v;
+    else {
+      fprintf(stderr, "tsyncsim: unknown option %s\n", opt);
+      return 2;
+    }
+  }
+  if (argc % 2) {
+    fprintf(stderr, "tsyncsim: missing value for %s\n", argv[argc - 1]);
+    return 2;
+  }
+
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<double> uni(0.0, 1.0);
+  std::normal_distribution<double> gauss(0.0, 1.0);
+  const double end_ns = seconds * 1e9;
+  const double bit_ns = 1e9 / bitrate;
+
+  // Gateway sends not tied to the bus state, in call order: each IMU
+  // group, then its stamp (sendIMUtoCAN)
+  std::vector<GatewaySend> sends;
+  std::vector<Group> groups;
+  for (double t = 0.5e9 / rate_hz; t < end_ns; t += 1e9 / rate_hz) {
+    const int g = (int)groups.size();
+    groups.push_back({t, 0});
+    const double ready = t + usb_ms * 1e6 * (0.5 + uni(rng));
+    // USB delivers samples in order
+    const double queued = sends.empty() || ready > sends.back().ready_ns ? ready : sends.back().ready_ns;
+    float vals[IMU_CHANNELS];
+    for (int c = 0; c < IMU_CHANNELS; c++) vals[c] = (float)(g * IMU_CHANNELS + c);
+    GatewaySend batch = {{}, IMU_CAN_FRAMES, queued, g};
+    imuPackFrames(vals, batch.frames);
+    sends.push_back(batch);
+    GatewaySend stamp = {{}, 1, queued, g};
+    const double stamp_us = (double)device.at(t) + stamp_jitter_us * gauss(rng);
+    imuPackStamp((uint32_t)(uint64_t)stamp_us, (uint8_t)g, &stamp.frames[0]);
+    sends.push_back(stamp);
+  }
+  std::vector<SimFrame> pending;
+
+  // Background traffic from other nodes: 8-byte frames with IDs below
+  // ours, Poisson arrivals sized to the requested bus load
+  CanFrame probe = {0x100, 8, false, {0}};
+  const double bg_frame_ns = canFrameWireTimeNs(probe, bitrate);
+  if (load > 0) {
+    std::exponential_distribution<double> gap(load / bg_frame_ns);
+    for (double t = gap(rng); t < end_ns; t += gap(rng)) {
+      CanFrame f = {0x080u + (uint32_t)(uni(rng) * 0x400), 8, false, {0}};
+      pending.push_back({f, t, -1});
+    }
+  }
+
+  CanTimeSyncReceiver rx;
+  ErrorStats stamped, naive;
+  double next_sync_ns = 0;
+  uint8_t sync_seq = 0;
+  bool fup_due = false;
+  double fup_ready_ns = 0;
+  uint64_t fup_time_us = 0;
+  uint8_t fup_seq = 0;
+  bool sync_due = false;
+  double now = 0;
+  size_t frames_on_bus = 0;
+  TxBuffers txb;
+  std::deque<SimFrame> txq;  // the driver's software TX queue
+  bool sync_queued = false;
+
+  // Background frames by readiness; arbitration picks the lowest ID
+  // among them and the gateway's head buffer
+  std::sort(pending.begin(), pending.end(),
+            [](const SimFrame& a, const SimFrame& b) { return a.ready_ns < b.ready_ns; });
+  size_t head = 0, send_head = 0;
+  std::vector<SimFrame> ready;
+
+  while (now < end_ns) {
+    if (!sync_due && !sync_queued && !fup_due && next_sync_ns <= now) {
+      sync_due = true;
+    }
+    while (head < pending.size() && pending[head].ready_ns <= now) ready.push_back(pending[head++]);
+
+    // The gateway's calls reach the driver's queue in call order. FUP
+    // follows its SYNC on the same pass; otherwise whichever came first.
+    // While SYNC is queued the loop sits in waitTxDone() and adds nothing.
+    while (!sync_queued) {
+      const bool send_ready = send_head < sends.size() && sends[send_head].ready_ns <= now;
+      SimFrame f = {{}, now, -1};
+      if (fup_due && fup_ready_ns <= now) {
+        canTsyncPackFup(fup_seq, fup_time_us, &f.frame);
+        txq.push_back(f);
+        fup_due = false;
+      } else if (sync_due && (!send_ready || next_sync_ns <= sends[send_head].ready_ns)) {
+        canTsyncPackSync(sync_seq, &f.frame);
+        f.group = kSyncGroup;
+        txq.push_back(f);
+        sync_queued = true;
+        sync_due = false;
+      } else if (send_ready) {
+        const GatewaySend& s = sends[send_head++];
+        for (uint8_t n = 0; n < s.count; n++) txq.push_back({s.frames[n], now, s.group});
+      } else {
+        break;
+      }
+    }
+    txb.load(txq);
+
+    int best = -1;
+    uint32_t best_id = UINT32_MAX;
+    for (size_t i = 0; i < ready.size(); i++) {
+      if (ready[i].frame.id < best_id) {
+        best_id = ready[i].frame.id;
+        best = (int)i;
+      }
+    }
+    const int gw = txb.next();
+    SimFrame tx;
+    bool is_sync = false;
+    if (gw >= 0 && txb.buf[gw].frame.id < best_id) {
+      tx = txb.buf[gw];
+      txb.pending[gw] = false;
+      if (tx.group == kSyncGroup) {
+        is_sync = true;
+        sync_queued = false;
+        tx.group = -1;
+      }
+    } else if (best >= 0) {
+      tx = ready[best];
+      ready.erase(ready.begin() + best);
+    } else {
+      // Idle: jump to the next event
+      double next = end_ns;
+      if (head < pending.size()) next = pending[head].ready_ns;
+      if (send_head < sends.size() && sends[send_head].ready_ns < next) next = sends[send_head].ready_ns;
+      if (fup_due && fup_ready_ns < next) next = fup_ready_ns;
+      if (!sync_due && !fup_due && next_sync_ns < next) next = next_sync_ns;
+      now = next > now ? next : now + bit_ns;
+      continue;
+    }
+
+    // End of frame (before intermission) as seen by both sides; the
+    // receiver validates the frame one bit before the transmitter
+    const double wire = canFrameWireTimeNs(tx.frame, bitrate);
+    const double eof_ns = now + wire - 3 * bit_ns;
+    now += wire;
+    frames_on_bus++;
+
+    if (is_sync) {
+      // Gateway: waitTxDone() returns within a READ STATUS poll (~2-4 us);
+      // SYNC is the last frame queued, so nothing is left behind it
+      fup_time_us = device.at(eof_ns + 2000 + 2000 * uni(rng));
+      fup_seq = sync_seq++;
+      fup_due = true;
+      fup_ready_ns = eof_ns + 20000;  // loop picks it up on the same pass
+      next_sync_ns += CAN_TSYNC_PERIOD_US * 1e3;
+    }
+
+    const double rx_ns = eof_ns - bit_ns + rx_jitter_us * 1e3 * uni(rng);
+    const uint64_t rx_local = receiver.at(rx_ns);
+    if (tx.group >= 0 && tx.frame.id == IMU_CAN_BASE_ID) groups[tx.group].first_rx_ns = rx_ns;
+    if (rx.onFrame(tx.frame, rx_local)) {
+      const CanTimeSyncReceiver::Sample& s = rx.sample();
+      const Group& g = groups[tx.group];
+      const double truth = (double)receiver.at(g.sample_ns);
+      if ((uint8_t)tx.group != s.seq) {
+        fprintf(stderr, "tsyncsim: stamp/group mismatch at group %d\n", tx.group);
+        return 1;
+      }
+      // Skip the first few seconds while the drift fit settles
+      if (g.sample_ns > 3e9) {
+        stamped.add((double)s.local_us - truth);
+        naive.add((double)receiver.at(g.first_rx_ns) - truth);
+      }
+    }
+  }
+
+  const double true_drift_ppb = ((1 + receiver.ppm * 1e-6) / (1 + device.ppm * 1e-6) - 1) * 1e9;
+  printf("%.0f s at %.0f Hz, %u bps, background load %.0f%%, %zu frames on the bus\n", seconds,
+         rate_hz, bitrate, load * 100, frames_on_bus);
+  printf("syncs %u, samples %lu, lost %u, before first sync %u\n", rx.syncs(), stamped.n,
+         rx.lostSamples(), rx.unsynced());
+  printf("drift estimate %d ppb (true %.0f ppb)\n", rx.driftPpb(), true_drift_ppb);
+  stamped.print("stamped");
+  naive.print("arrival");
+  return 0;
+}
@@ -0,0 +1,6 @@
+#pragma once
+
+// "tsyncsim": run the gateway's CAN time sync through a simulated bus
+// and report how well the reference receiver (CanTimeSyncReceiver)
+// places IMU samples in its own clock. argv starts after the command.
+int runTimeSyncSim(int argc, char** argv);
@@ -0,0 +1,195 @@
+#include "imu_calib.h"
+#include <math.h>
+#include <string.h>
+#include "usb_frame.h"
+
+static const uint32_t CALIB_MAGIC = 0x4C414349;  // "ICAL"
+static const uint8_t CALIB_VERSION = 1;
+
+void imuCalibIdentity(ImuCalibration* cal) {
+  for (uint8_t i = 0; i < IMU_CHANNELS; i++) {
+    cal->bias[i] = 0.0f;
+    cal->scale[i] = 1.0f;
+  }
+}
+
+static void putFloat(uint8_t* p, float v) {
+  uint32_t u;
+  memcpy(&u, &v, 4);
+  putLe32(p, u);
+}
+
+static float getFloat(const uint8_t* p) {
+  uint32_t u = getLe32(p);
+  float v;
+  memcpy(&v, &u, 4);
+  return v;
+}
+
+void imuCalibPack(const ImuCalibration& cal, uint8_t out[IMU_CALIB_RECORD_SIZE]) {
+  putLe32(out, CALIB_MAGIC);
+  out[4] = CALIB_VERSION;
+  uint8_t* p = out + 5;
+  for (uint8_t i = 0; i < IMU_CHANNELS; i++, p += 4) putFloat(p, cal.bias[i]);
+  for (uint8_t i = 0; i < IMU_CHANNELS; i++, p += 4) putFloat(p, cal.scale[i]);
+  *p = usbFrameCrc8(out, IMU_CALIB_RECORD_SIZE - 1);
+}
+
+bool imuCalibUnpack(const uint8_t in[IMU_CALIB_RECORD_SIZE], ImuCalibration* cal) {
+  if (getLe32(in) != CALIB_MAGIC || in[4] != CALIB_VERSION ||
+      usbFrameCrc8(in, IMU_CALIB_RECORD_SIZE - 1) != in[IMU_CALIB_RECORD_SIZE - 1]) {
+    return false;
+  }
+  ImuCalibration c;
+  const uint8_t* p = in + 5;
+  for (uint8_t i = 0; i < IMU_CHANNELS; i++, p += 4) c.bias[i] = getFloat(p);
+  for (uint8_t i = 0; i < IMU_CHANNELS; i++, p += 4) c.scale[i] = getFloat(p);
+  for (uint8_t i = 0; i < IMU_CHANNELS; i++) {
+    if (!isfinite(c.bias[i]) || !isfinite(c.scale[i]) || !(c.scale[i] > 0.0f)) return false;
+  }
+  *cal = c;
+  return true;
+}
+
+bool ImuCalibrator::start(Capture kind, uint16_t samples, uint8_t pose) {
+  if (kind == CAPTURE_NONE || samples < 2 || (kind == CAPTURE_POSE && pose >= kMaxPoses)) {
+    return false;
+  }
+  kind_ = kind;
+  pose_ = pose;
+  target_ = samples;
+  count_ = 0;
+  memset(sum_, 0, sizeof(sum_));
+  memset(sum_sq_, 0, sizeof(sum_sq_));
+  memset(unwrapped_, 0, sizeof(unwrapped_));
+  return true;
+}
+
+void ImuCalibrator::clearPoses() {
+  memset(pose_valid_, 0, sizeof(pose_valid_));
+}
+
+uint8_t ImuCalibrator::poses() const {
+  uint8_t n = 0;
+  for (uint8_t i = 0; i < kMaxPoses; i++) n += pose_valid_[i];
+  return n;
+}
+
+bool ImuCalibrator::push(const float values[IMU_CHANNELS], uint64_t time_us) {
+  if (kind_ == CAPTURE_NONE) return false;
+
+  for (uint8_t i = 0; i < IMU_CHANNELS; i++) sum_[i] += values[i];
+  for (uint8_t i = IMU_AX; i <= IMU_AZ; i++) sum_sq_[i - IMU_AX] += (double)values[i] * values[i];
+
+  // Follow the angles across their wrap so drift is a plain slope
+  for (uint8_t i = 0; i < IMU_AX; i++) {
+    if (count_ > 0) {
+      float d = values[i] - prev_angle_[i];
+      d -= 2.0f * (float)M_PI * floorf((d + (float)M_PI) / (2.0f * (float)M_PI));
+      unwrapped_[i] += d;
+    }
+    prev_angle_[i] = values[i];
+  }
+  if (count_ == 0) first_us_ = time_us;
+  last_us_ = time_us;
+
+  if (++count_ < target_) return false;
+
+  const double n = count_;
+  for (uint8_t i = 0; i < IMU_CHANNELS; i++) mean_[i] = (float)(sum_[i] / n);
+  double var = 0;
+  for (uint8_t i = IMU_AX; i <= IMU_AZ; i++) {
+    const double m = sum_[i] / n;
+    var += sum_sq_[i - IMU_AX] / n - m * m;
+  }
+  motion_rms_ = var > 0 ? (float)sqrt(var) : 0.0f;
+
+  const double span_s = (double)(last_us_ - first_us_) * 1e-6;
+  for (uint8_t i = 0; i < IMU_AX; i++) {
+    drift_[i] = span_s > 0 ? (float)(unwrapped_[i] / span_s) : 0.0f;
+  }
+
+  if (kind_ == CAPTURE_POSE && still()) {
+    for (uint8_t k = 0; k < 3; k++) pose_mean_[pose_][k] = mean_[IMU_AX + k];
+    pose_valid_[pose_] = true;
+  }
+  last_kind_ = kind_;
+  kind_ = CAPTURE_NONE;
+  return true;
+}
+
+// Gaussian elimination with partial pivoting; false if singular
+static bool solve6(double m[6][7]) {
+  for (int c = 0; c < 6; c++) {
+    int p = c;
+    for (int r = c + 1; r < 6; r++) {
+      if (fabs(m[r][c]) > fabs(m[p][c])) p = r;
+    }
+    if (fabs(m[p][c]) < 1e-9) return false;
+    if (p != c) {
+      for (int k = 0; k < 7; k++) {
+        const double t = m[c][k];
+        m[c][k] = m[p][k];
+        m[p][k] = t;
+      }
+    }
+    for (int r = 0; r < 6; r++) {
+      if (r == c) continue;
+      const double f = m[r][c] / m[c][c];
+      for (int k = c; k < 7; k++) m[r][k] -= f * m[c][k];
+    }
+  }
+  for (int r = 0; r < 6; r++) m[r][6] /= m[r][r];
+  return true;
+}
+
+bool ImuCalibrator::fit(ImuCalibration* cal, float* residual) const {
+  if (poses() < 6) return false;
+
+  // Normal equations in units of g, which keeps the columns near 1
+  double m[6][7];
+  memset(m, 0, sizeof(m));
+  for (uint8_t i = 0; i < kMaxPoses; i++) {
+    if (!pose_valid_[i]) continue;
+    double row[6];
+    for (uint8_t k = 0; k < 3; k++) {
+      const double v = pose_mean_[i][k] / IMU_GRAVITY;
+      row[k] = v * v;
+      row[3 + k] = v;
+    }
+    for (int r = 0; r < 6; r++) {
+      for (int c = 0; c < 6; c++) m[r][c] += row[r] * row[c];
+      m[r][6] += row[r];
+    }
+  }
+  if (!solve6(m)) return false;
+
+  // a.x^2 + d.x = a.(x - b)^2 - a.b^2 with b = -d / 2a
+  double bias[3], gain = 1.0;
+  for (uint8_t k = 0; k < 3; k++) {
+    const double a = m[k][6];
+    if (!(a > 0)) return false;
+    bias[k] = -m[3 + k][6] / (2 * a);
+    gain += a * bias[k] * bias[k];
+  }
+  ImuCalibration c = *cal;
+  for (uint8_t k = 0; k < 3; k++) {
+    c.bias[IMU_AX + k] = (float)(bias[k] * IMU_GRAVITY);
+    c.scale[IMU_AX + k] = (float)sqrt(m[k][6] / gain);
+  }
+
+  double err = 0;
+  for (uint8_t i = 0; i < kMaxPoses; i++) {
+    if (!pose_valid_[i]) continue;
+    double r2 = 0;
+    for (uint8_t k = 0; k < 3; k++) {
+      const double v = (pose_mean_[i][k] - c.bias[IMU_AX + k]) * c.scale[IMU_AX + k];
+      r2 += v * v;
+    }
+    const double e = sqrt(r2) - IMU_GRAVITY;
+    err += e * e;
+  }
+  *residual = (float)sqrt(err / poses());
+  *cal = c;
+  return true;
+}
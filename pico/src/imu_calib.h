@@ -0,0 +1,113 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "imu_codec.h"
+
+// Per-channel correction applied on the gateway right after parsing,
+// ahead of the decimator and filters, so they work on calibrated values
+// and downstream nodes receive them:
+//
+//   out = (in - bias) * scale
+//
+// Every channel goes through the same two operations (orientation is
+// identity), so the correction is a fixed, branch-free loop. The
+// orientation angles come fused from the phone, which does not stream
+// its gyro; a gyro bias shows up as orientation drift, which the
+// stationary capture reports but does not correct.
+struct ImuCalibration {
+  float bias[IMU_CHANNELS];
+  float scale[IMU_CHANNELS];
+};
+
+static const float IMU_GRAVITY = 9.80665f;  // m/s^2
+
+void imuCalibIdentity(ImuCalibration* cal);
+
+static inline void imuCalibApply(const ImuCalibration& cal, float values[IMU_CHANNELS]) {
+  for (uint8_t i = 0; i < IMU_CHANNELS; i++) {
+    values[i] = (values[i] - cal.bias[i]) * cal.scale[i];
+  }
+}
+
+// Flash record: u32 magic "ICAL", u8 version, bias[6], scale[6] (float32
+// LE), crc8 (usb_frame.h polynomial) over everything before it
+static const size_t IMU_CALIB_RECORD_SIZE = 4 + 1 + 2 * IMU_CHANNELS * 4 + 1;
+
+void imuCalibPack(const ImuCalibration& cal, uint8_t out[IMU_CALIB_RECORD_SIZE]);
+// False (and `cal` untouched) for an erased, foreign or corrupt record,
+// or one with non-finite or non-positive values
+bool imuCalibUnpack(const uint8_t in[IMU_CALIB_RECORD_SIZE], ImuCalibration* cal);
+
+// Captures for "cal,...", fed with raw parsed samples:
+//
+//   still  device at rest, linear acceleration streamed: the means are
+//          the accelerometer bias; orientation drift over the capture
+//          is the residual gyro bias of the phone's fusion
+//   pose   device held still in one orientation with acceleration
+//          *including gravity* streamed; fit() needs at least six
+//          spread-out poses (each face up and down)
+//
+// fit() solves the axis-aligned ellipsoid a.x^2 + b.y^2 + c.z^2 + d.x +
+// e.y + f.z = 1 through the pose means by linear least squares, so that
+// the corrected poses lie on a sphere of radius IMU_GRAVITY.
+class ImuCalibrator {
+public:
+  static const uint8_t kMaxPoses = 12;
+  static const uint16_t kDefaultSamples = 100;
+  // Captures moving more than this (acceleration RMS about the mean,
+  // m/s^2) are rejected
+  static constexpr float kMaxMotionRms = 0.5f;
+
+  enum Capture : uint8_t { CAPTURE_NONE, CAPTURE_STILL, CAPTURE_POSE };
+
+  // Start a capture of `samples` samples; pose is 0..kMaxPoses-1 and
+  // replaces an earlier capture of the same pose. False if the
+  // arguments are out of range.
+  bool start(Capture kind, uint16_t samples, uint8_t pose = 0);
+  void cancel() { kind_ = CAPTURE_NONE; }
+  // Forget the captured poses
+  void clearPoses();
+
+  // Feed one sample while capturing; true when the capture completes
+  bool push(const float values[IMU_CHANNELS], uint64_t time_us);
+
+  Capture capturing() const { return kind_; }
+  // Result of the last completed capture
+  Capture lastKind() const { return last_kind_; }
+  uint8_t lastPose() const { return pose_; }
+  uint16_t lastSamples() const { return target_; }
+  const float* mean() const { return mean_; }        // per channel
+  float motionRms() const { return motion_rms_; }    // acceleration, m/s^2
+  const float* driftRate() const { return drift_; }  // orientation, rad/s
+  bool still() const { return motion_rms_ <= kMaxMotionRms; }
+
+  uint8_t poses() const;
+
+  // Accelerometer bias and scale from the captured poses into `cal`
+  // (orientation left alone); `residual` is the RMS distance of the
+  // corrected poses from IMU_GRAVITY. False if the poses do not span
+  // all three axes.
+  bool fit(ImuCalibration* cal, float* residual) const;
+
+private:
+  Capture kind_ = CAPTURE_NONE;
+  Capture last_kind_ = CAPTURE_NONE;
+  uint8_t pose_ = 0;
+  uint16_t target_ = 0;
+  uint16_t count_ = 0;
+
+  double sum_[IMU_CHANNELS];
+  double sum_sq_[IMU_AZ - IMU_AX + 1];
+  // Unwrapped orientation path for the drift estimate
+  float prev_angle_[IMU_AX];
+  double unwrapped_[IMU_AX];
+  uint64_t first_us_ = 0;
+  uint64_t last_us_ = 0;
+
+  float mean_[IMU_CHANNELS];
+  float motion_rms_ = 0;
+  float drift_[IMU_AX];
+
+  float pose_mean_[kMaxPoses][3];
+  bool pose_valid_[kMaxPoses] = {};
+};
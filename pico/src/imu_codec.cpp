@@ -0,0 +1,113 @@
+#include "imu_codec.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+int imuParseCsv(const char* line, size_t len, float out[IMU_CHANNELS], uint64_t* time_us,
+                int64_t* seq) {
+  char field[32];
+  int count = 0;
+  size_t start = 0;
+  for (size_t i = 0; i <= len && count < IMU_CHANNELS; i++) {
+    if (i < len && line[i] != ',') continue;
+    if (i == len && i == start) break;  // no trailing empty field
+    size_t n = i - start;
+    if (n >= sizeof(field)) n = sizeof(field) - 1;
+    memcpy(field, line + start, n);
+    field[n] = '\0';
+    out[count++] = strtof(field, nullptr);
+    start = i + 1;
+  }
+
+  if (time_us && count == IMU_CHANNELS && start < len) {
+    size_t n = len - start;
+    if (n >= sizeof(field)) n = sizeof(field) - 1;
+    memcpy(field, line + start, n);
+    field[n] = '\0';
+    char* end;
+    const unsigned long long t = strtoull(field, &end, 10);
+    if (end != field) *time_us = t;
+    if (seq && end != field && *end == ',') {
+      char* seq_end;
+      const unsigned long s = strtoul(end + 1, &seq_end, 10);
+      if (seq_end != end + 1) *seq = (uint32_t)s;  // u32 on the wire
+    }
+  }
+  return count;
+}
+
+static size_t putUint(uint64_t v, char* out) {
+  char digits[20];
+  size_t n = 0;
+  do {
+    digits[n++] = (char)('0' + v % 10);
+    v /= 10;
+  } while (v);
+  for (size_t i = 0; i < n; i++) out[i] = digits[n - 1 - i];
+  return n;
+}
+
+size_t imuFormatCsv(const double values[IMU_CHANNELS], uint64_t time_us, uint32_t seq,
+                    char* out, size_t cap) {
+  if (cap < IMU_CSV_MAX_LINE) return 0;
+  size_t len = 0;
+  for (int i = 0; i < IMU_CHANNELS; i++) {
+    double v = values[i];
+    if (!isfinite(v)) v = 0;
+    if (v > IMU_CSV_VALUE_LIMIT) v = IMU_CSV_VALUE_LIMIT;
+    if (v < -IMU_CSV_VALUE_LIMIT) v = -IMU_CSV_VALUE_LIMIT;
+    // Not (uint64_t)(x + 0.5): the sum itself can round up just below a
+    // tie. x - floor(x) is exact here, as in Math.round.
+    const double scaled = (v < 0 ? -v : v) * 100.0;
+    uint64_t cents = (uint64_t)scaled;
+    if (scaled - (double)cents >= 0.5) cents++;
+    if (v < 0 && cents) out[len++] = '-';
+    len += putUint(cents / 100, out + len);
+    out[len++] = '.';
+    out[len++] = (char)('0' + cents / 10 % 10);
+    out[len++] = (char)('0' + cents % 10);
+    out[len++] = ',';
+  }
+  len += putUint(time_us, out + len);
+  out[len++] = ',';
+  len += putUint(seq, out + len);
+  out[len++] = '\n';
+  return len;
+}
+
+void imuPackFrames(const float values[IMU_CHANNELS], CanFrame frames[IMU_CAN_FRAMES]) {
+  for (uint8_t i = 0; i < IMU_CAN_FRAMES; i++) {
+    frames[i].id = IMU_CAN_BASE_ID + i;
+    frames[i].dlc = 8;
+    frames[i].extended = false;
+    memcpy(frames[i].data, &values[2 * i], 4);
+    memcpy(frames[i].data + 4, &values[2 * i + 1], 4);
+  }
+}
+
+void imuPackStamp(uint32_t device_us, uint8_t seq, CanFrame* frame) {
+  frame->id = IMU_CAN_STAMP_ID;
+  frame->dlc = IMU_CAN_STAMP_DLC;
+  frame->extended = false;
+  memset(frame->data, 0, 8);
+  for (int i = 0; i < 4; i++) frame->data[i] = (uint8_t)(device_us >> (8 * i));
+  frame->data[4] = seq;
+}
+
+bool imuUnpackStamp(const CanFrame& frame, uint32_t* device_us, uint8_t* seq) {
+  if (frame.extended || frame.id != IMU_CAN_STAMP_ID || frame.dlc < IMU_CAN_STAMP_DLC) return false;
+  uint32_t t = 0;
+  for (int i = 0; i < 4; i++) t |= (uint32_t)frame.data[i] << (8 * i);
+  *device_us = t;
+  *seq = frame.data[4];
+  return true;
+}
+
+bool imuUnpackFrame(const CanFrame& frame, float values[IMU_CHANNELS]) {
+  if (frame.extended || frame.dlc != 8) return false;
+  if (frame.id < IMU_CAN_BASE_ID || frame.id >= IMU_CAN_BASE_ID + IMU_CAN_FRAMES) return false;
+  const uint32_t i = frame.id - IMU_CAN_BASE_ID;
+  memcpy(&values[2 * i], frame.data, 4);
+  memcpy(&values[2 * i + 1], frame.data + 4, 4);
+  return true;
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include "can_frame.h"
+
+// IMU sample layout shared by the USB input and the CAN output:
+// orientation alpha/beta/gamma (rad) and linear acceleration x/y/z (m/s^2)
+enum ImuChannel {
+  IMU_ALPHA, IMU_BETA, IMU_GAMMA, IMU_AX, IMU_AY, IMU_AZ,
+  IMU_CHANNELS
+};
+
+// 0x501: alpha, beta / 0x502: gamma, ax / 0x503: ay, az (float32 LE pairs)
+static const uint32_t IMU_CAN_BASE_ID = 0x501;
+static const uint8_t  IMU_CAN_FRAMES = 3;
+
+// 0x504 follows each group: u32 LE sample time (low bits of the device
+// microsecond clock, see can_time_sync.h), u8 group counter
+static const uint32_t IMU_CAN_STAMP_ID = 0x504;
+static const uint8_t  IMU_CAN_STAMP_DLC = 5;
+
+// Parse "alpha,beta,gamma,ax,ay,az[,t_us[,seq]]"; returns the number of
+// IMU fields read (at most IMU_CHANNELS). Missing or malformed numbers
+// read as 0. The optional seventh field is the sender's sample time in
+// microseconds and the eighth its u32 sample sequence number; `time_us`
+// and `seq` are set when given, else left alone (start `seq` at -1 to
+// tell).
+int imuParseCsv(const char* line, size_t len, float out[IMU_CHANNELS],
+                uint64_t* time_us = nullptr, int64_t* seq = nullptr);
+
+// Inverse of imuParseCsv: "alpha,beta,gamma,ax,ay,az,t_us,seq\n" with two
+// decimals per value, as the web app sends it. Values are clamped to
+// +-IMU_CSV_VALUE_LIMIT, NaN and infinity read 0, and |v| * 100 is
+// rounded half up like Math.round, so the digits match the app's
+// SampleEncoder for the same doubles. Returns the length, or 0 when
+// `cap` is below IMU_CSV_MAX_LINE.
+static const double IMU_CSV_VALUE_LIMIT = 9999999.99;
+static const size_t IMU_CSV_MAX_LINE = 6 * 12 + 21 + 11;
+
+size_t imuFormatCsv(const double values[IMU_CHANNELS], uint64_t time_us, uint32_t seq,
+                    char* out, size_t cap);
+
+void imuPackFrames(const float values[IMU_CHANNELS], CanFrame frames[IMU_CAN_FRAMES]);
+void imuPackStamp(uint32_t device_us, uint8_t seq, CanFrame* frame);
+bool imuUnpackStamp(const CanFrame& frame, uint32_t* device_us, uint8_t* seq);
+
+// Store the two channels carried by one of the IMU frames; false if the
+// frame is not part of the IMU group.
+bool imuUnpackFrame(const CanFrame& frame, float values[IMU_CHANNELS]);
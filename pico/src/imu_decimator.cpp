@@ -0,0 +1,90 @@
+#include "imu_decimator.h"
+#include <math.h>
+#include <string.h>
+#include "dsp_filter.h"
+#include "dsp_simd.h"
+#include "imu_filter.h"
+
+bool ImuDecimator::configure(uint8_t ratio, uint8_t taps_per_phase) {
+  if (ratio == 0 || ratio > kMaxRatio) return false;
+  if (taps_per_phase < 2 || taps_per_phase > kMaxTapsPerPhase || (taps_per_phase & 1)) return false;
+
+  ratio_ = ratio;
+  ntaps_ = ratio == 1 ? 0 : (uint16_t)(ratio * taps_per_phase);
+  if (ntaps_) {
+    // Hamming-windowed sinc, cutoff a little below the output Nyquist
+    const double fc = 0.45 / ratio;
+    const double mid = (ntaps_ - 1) / 2.0;
+    double h[kMaxTaps];
+    double sum = 0;
+    for (uint16_t i = 0; i < ntaps_; i++) {
+      const double t = i - mid;
+      const double sinc = 2 * fc * (t == 0 ? 1.0 : sin(2 * M_PI * fc * t) / (2 * M_PI * fc * t));
+      h[i] = sinc * (0.54 - 0.46 * cos(2 * M_PI * i / (ntaps_ - 1)));
+      sum += h[i];
+    }
+    // Unity DC gain in Q15: round, then give the residue to the centre
+    int32_t total = 0;
+    for (uint16_t i = 0; i < ntaps_; i++) {
+      coeffs_[i] = (int16_t)lrint(h[i] / sum * 32768.0);
+      total += coeffs_[i];
+    }
+    coeffs_[ntaps_ / 2] = (int16_t)(coeffs_[ntaps_ / 2] + (32768 - total));
+  }
+  reset();
+  return true;
+}
+
+void ImuDecimator::reset() {
+  phase_ = 0;
+  pos_ = 0;
+  primed_ = false;
+}
+
+bool ImuDecimator::push(const float in[IMU_CHANNELS], uint64_t time_us,
+                        float out[IMU_CHANNELS], uint64_t* out_time_us) {
+  if (ratio_ == 1) {
+    memcpy(out, in, sizeof(float) * IMU_CHANNELS);
+    *out_time_us = time_us;
+    return true;
+  }
+
+  const uint16_t n = ntaps_;
+  int16_t q[kFiltered];
+  for (uint8_t c = 0; c < kFiltered; c++) {
+    q[c] = imuToQ15(in[IMU_AX + c], IMU_ACCELERATION_FULL_SCALE);
+  }
+
+  if (!primed_) {
+    // Start from a steady state at the first sample instead of zeros
+    for (uint16_t i = 0; i < n; i++) {
+      for (uint8_t c = 0; c < kFiltered; c++) hist_[c][i] = hist_[c][i + n] = q[c];
+      memcpy(angles_[i], in, sizeof(angles_[i]));
+      times_[i] = time_us;
+    }
+    pos_ = 0;
+    primed_ = true;
+  } else {
+    pos_ = (uint16_t)((pos_ == 0 ? n : pos_) - 1);
+    for (uint8_t c = 0; c < kFiltered; c++) hist_[c][pos_] = hist_[c][pos_ + n] = q[c];
+    memcpy(angles_[pos_], in, sizeof(angles_[pos_]));
+    times_[pos_] = time_us;
+  }
+
+  if (++phase_ < ratio_) return false;
+  phase_ = 0;
+
+  // One output: all polyphase branches over the newest-first window
+  for (uint8_t c = 0; c < kFiltered; c++) {
+    const int32_t acc = dspDotQ15(hist_[c] + pos_, coeffs_, n, 1 << 14);
+    out[IMU_AX + c] = dspSsat16(acc >> 15) * (IMU_ACCELERATION_FULL_SCALE / 32768.0f);
+  }
+
+  // The linear-phase FIR delays by (n - 1) / 2 inputs; n is even, so the
+  // delay falls between two samples
+  const uint16_t older = (uint16_t)((pos_ + n / 2) % n);
+  const uint16_t newer = (uint16_t)((pos_ + n / 2 - 1) % n);
+  memcpy(out, angles_[newer], sizeof(angles_[newer]));
+  *out_time_us = times_[older] + (times_[newer] - times_[older]) / 2;
+  return true;
+}
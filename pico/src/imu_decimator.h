@@ -0,0 +1,48 @@
+#pragma once
+#include "imu_codec.h"
+
+// Polyphase decimator: the browser streams at its full rate over USB and
+// only every `ratio`-th sample, low-pass filtered, goes to CAN.
+//
+// The anti-aliasing FIR (windowed sinc, ratio * taps_per_phase taps,
+// Q15) is split into `ratio` polyphase branches; only the outputs that
+// are kept are computed, so the cost is taps_per_phase MACs per input
+// and channel. Acceleration is filtered; the orientation angles wrap,
+// so they are delayed by the same group delay and picked, not averaged.
+// Output timestamps are the input times at the filter's group delay.
+class ImuDecimator {
+public:
+  static const uint8_t kMaxRatio = 16;
+  static const uint8_t kMaxTapsPerPhase = 8;
+  static const uint16_t kMaxTaps = kMaxRatio * kMaxTapsPerPhase;
+
+  ImuDecimator() { configure(1); }
+
+  // ratio 1 passes samples through. False leaves the setup unchanged.
+  bool configure(uint8_t ratio, uint8_t taps_per_phase = kMaxTapsPerPhase);
+  // Forget the input history; the next sample primes the filter
+  void reset();
+
+  // Feed one input sample; true when an output sample is ready
+  bool push(const float in[IMU_CHANNELS], uint64_t time_us,
+            float out[IMU_CHANNELS], uint64_t* out_time_us);
+
+  uint8_t ratio() const { return ratio_; }
+  uint16_t taps() const { return ntaps_; }
+
+private:
+  static const uint8_t kFiltered = IMU_CHANNELS - IMU_AX;  // ax, ay, az
+
+  uint8_t ratio_ = 1;
+  uint16_t ntaps_ = 0;
+  uint8_t phase_ = 0;
+  bool primed_ = false;
+  uint16_t pos_ = 0;  // newest entry in the history rings
+
+  int16_t coeffs_[kMaxTaps];
+  // Acceleration in Q15, each sample stored twice (contiguous window)
+  int16_t hist_[kFiltered][2 * kMaxTaps];
+  // Orientation and timestamps at full rate, for the delayed pick
+  float angles_[kMaxTaps][IMU_AX];
+  uint64_t times_[kMaxTaps];
+};
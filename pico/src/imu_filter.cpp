@@ -0,0 +1,130 @@
+#include "imu_filter.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+ImuFilterBank::ImuFilterBank() {
+  memset(ch_, 0, sizeof(ch_));
+  for (uint8_t i = 0; i < IMU_CHANNELS; i++) {
+    ch_[i].kind = IMU_FILTER_OFF;
+    ch_[i].scale = i < IMU_AX ? IMU_ORIENTATION_FULL_SCALE : IMU_ACCELERATION_FULL_SCALE;
+  }
+}
+
+static int32_t toQ31(float v, float scale) {
+  const double q = (double)v / scale * 2147483648.0;
+  if (!(q > -2147483648.0)) return INT32_MIN;
+  if (q >= 2147483647.0) return INT32_MAX;
+  return (int32_t)llrint(q);
+}
+
+void ImuFilterBank::process(float values[IMU_CHANNELS]) {
+  for (uint8_t i = 0; i < IMU_CHANNELS; i++) {
+    Channel& c = ch_[i];
+    switch (c.kind) {
+      case IMU_FILTER_FIR_Q15:
+        values[i] = firQ15Step(&c.fir, imuToQ15(values[i], c.scale)) * (c.scale / 32768.0f);
+        break;
+      case IMU_FILTER_BIQUAD_Q15:
+        values[i] = biquadQ15Step(&c.bq15, imuToQ15(values[i], c.scale)) * (c.scale / 32768.0f);
+        break;
+      case IMU_FILTER_BIQUAD_Q31:
+        values[i] = (float)(biquadQ31Step(&c.bq31, toQ31(values[i], c.scale)) *
+                            ((double)c.scale / 2147483648.0));
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+void ImuFilterBank::reset() {
+  for (uint8_t i = 0; i < IMU_CHANNELS; i++) {
+    Channel& c = ch_[i];
+    if (c.kind == IMU_FILTER_FIR_Q15) {
+      firQ15Reset(&c.fir);
+    } else if (c.kind == IMU_FILTER_BIQUAD_Q15) {
+      c.bq15.x1 = c.bq15.x2 = c.bq15.y1 = c.bq15.y2 = 0;
+    } else if (c.kind == IMU_FILTER_BIQUAD_Q31) {
+      c.bq31.x1 = c.bq31.x2 = c.bq31.y1 = c.bq31.y2 = 0;
+    }
+  }
+}
+
+bool ImuFilterBank::configure(const char* spec) {
+  // Channel selector
+  uint8_t first, last;
+  if (!strncmp(spec, "all,", 4)) {
+    first = 0;
+    last = IMU_CHANNELS - 1;
+    spec += 4;
+  } else if (!strncmp(spec, "ori,", 4)) {
+    first = IMU_ALPHA;
+    last = IMU_GAMMA;
+    spec += 4;
+  } else if (!strncmp(spec, "acc,", 4)) {
+    first = IMU_AX;
+    last = IMU_AZ;
+    spec += 4;
+  } else if (spec[0] >= '0' && spec[0] < '0' + IMU_CHANNELS && spec[1] == ',') {
+    first = last = (uint8_t)(spec[0] - '0');
+    spec += 2;
+  } else {
+    return false;
+  }
+
+  // Build the new stage once, then copy it to every selected channel
+  Channel stage;
+  memset(&stage, 0, sizeof(stage));
+  char* end;
+  if (!strcmp(spec, "off")) {
+    stage.kind = IMU_FILTER_OFF;
+  } else if (!strncmp(spec, "lp,", 3) || !strncmp(spec, "lp31,", 5)) {
+    const bool q31 = spec[2] == '3';
+    const float fc = strtof(spec + (q31 ? 5 : 3), &end);
+    if (*end != ',') return false;
+    const float fs = strtof(end + 1, &end);
+    if (*end != '\0') return false;
+    BiquadCoeffs c;
+    if (!dspDesignLowpass(fc, fs, &c)) return false;
+    if (q31) {
+      stage.kind = IMU_FILTER_BIQUAD_Q31;
+      if (!biquadQ31Init(&stage.bq31, c)) return false;
+    } else {
+      stage.kind = IMU_FILTER_BIQUAD_Q15;
+      if (!biquadQ15Init(&stage.bq15, c)) return false;
+    }
+  } else if (!strncmp(spec, "fir,", 4)) {
+    int16_t taps[DSP_FIR_MAX_TAPS];
+    uint8_t n = 0;
+    const char* p = spec + 3;
+    while (*p == ',') {
+      if (n == DSP_FIR_MAX_TAPS) return false;
+      const float h = strtof(p + 1, &end);
+      if (end == p + 1 || !(fabsf(h) < 1.0f)) return false;
+      taps[n++] = (int16_t)lrintf(h * 32767.0f);
+      p = end;
+    }
+    if (*p != '\0') return false;
+    stage.kind = IMU_FILTER_FIR_Q15;
+    if (!firQ15Init(&stage.fir, taps, n)) return false;
+  } else {
+    return false;
+  }
+
+  for (uint8_t i = first; i <= last; i++) {
+    const float scale = ch_[i].scale;
+    ch_[i] = stage;
+    ch_[i].scale = scale;
+  }
+  return true;
+}
+
+const char* ImuFilterBank::kindName(ImuFilterKind kind) {
+  switch (kind) {
+    case IMU_FILTER_FIR_Q15: return "fir_q15";
+    case IMU_FILTER_BIQUAD_Q15: return "biquad_q15";
+    case IMU_FILTER_BIQUAD_Q31: return "biquad_q31";
+    default: return "off";
+  }
+}
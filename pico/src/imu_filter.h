@@ -0,0 +1,61 @@
+#pragma once
+#include <math.h>
+#include "dsp_filter.h"
+#include "imu_codec.h"
+
+// Per-channel filter stage between CSV parse and CAN pack. Each channel
+// is off (default), a Q15 FIR, a Q15 biquad or a Q31 biquad. Samples are
+// converted to fixed point against a per-channel full scale: +-8 rad for
+// orientation, +-64 m/s^2 for acceleration.
+//
+// Configured with "filt,<ch>,<spec>":
+//   ch    0..5 (alpha beta gamma ax ay az), "ori", "acc" or "all"
+//   spec  off | lp,<fc_hz>,<fs_hz> | lp31,<fc_hz>,<fs_hz> | fir,<h0>,<h1>,...
+// FIR taps are given as floats (|h| < 1). The orientation angles wrap,
+// so they are better left unfiltered.
+static const float IMU_ORIENTATION_FULL_SCALE = 8.0f;    // rad
+static const float IMU_ACCELERATION_FULL_SCALE = 64.0f;  // m/s^2
+
+// Engineering units -> Q15 of `scale`, saturating (NaN reads as -scale)
+static inline int16_t imuToQ15(float v, float scale) {
+  const float q = v / scale * 32768.0f;
+  if (!(q > -32768.0f)) return INT16_MIN;
+  if (q >= 32767.0f) return INT16_MAX;
+  return (int16_t)lrintf(q);
+}
+
+enum ImuFilterKind : uint8_t {
+  IMU_FILTER_OFF,
+  IMU_FILTER_FIR_Q15,
+  IMU_FILTER_BIQUAD_Q15,
+  IMU_FILTER_BIQUAD_Q31,
+};
+
+class ImuFilterBank {
+public:
+  ImuFilterBank();
+
+  // Filter one sample in place
+  void process(float values[IMU_CHANNELS]);
+  // Parse and apply a "filt" argument string (after "filt,"); false
+  // leaves every channel unchanged
+  bool configure(const char* spec);
+  // Clear filter history, e.g. when the input stream restarts
+  void reset();
+
+  ImuFilterKind kind(uint8_t channel) const { return ch_[channel].kind; }
+  static const char* kindName(ImuFilterKind kind);
+
+private:
+  struct Channel {
+    ImuFilterKind kind;
+    float scale;  // full scale in engineering units
+    union {
+      FirQ15 fir;
+      BiquadQ15 bq15;
+      BiquadQ31 bq31;
+    };
+  };
+
+  Channel ch_[IMU_CHANNELS];
+};
@@ -0,0 +1,20 @@
+#include "imu_pipeline.h"
+
+bool ImuPipeline::push(float values[IMU_CHANNELS], uint64_t time_us,
+                       CanFrame frames[IMU_CAN_FRAMES], CanFrame* stamp) {
+  // Correct the sensor first: the decimator and filters then work on
+  // physical values, and a bias never rides through their state
+  imuCalibApply(calib_, values);
+  float out[IMU_CHANNELS];
+  uint64_t out_us;
+  if (!decimator_.push(values, time_us, out, &out_us)) return false;
+  filter_.process(out);
+  imuPackFrames(out, frames);
+  imuPackStamp((uint32_t)out_us, group_seq_++, stamp);
+  return true;
+}
+
+void ImuPipeline::reset() {
+  decimator_.reset();
+  filter_.reset();
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include "imu_calib.h"
+#include "imu_codec.h"
+#include "imu_decimator.h"
+#include "imu_filter.h"
+
+// Per-sample path from a parsed sample to its CAN group, shared by the
+// firmware (main.cpp) and the native gateway (host/gateway_core.cpp):
+//
+//   calibrate -> decimate -> filter -> 0x501..0x503 + 0x504 stamp
+//
+// Calibration captures see raw samples, so the caller feeds the
+// calibrator instead of push() while one runs.
+class ImuPipeline {
+public:
+  ImuPipeline() { imuCalibIdentity(&calib_); }
+
+  // One parsed sample (corrected in place) at `time_us`; true when a
+  // group is ready in `frames` and `stamp`, stamped with the output time
+  bool push(float values[IMU_CHANNELS], uint64_t time_us, CanFrame frames[IMU_CAN_FRAMES],
+            CanFrame* stamp);
+  // Clear decimator and filter history, e.g. when the input restarts
+  void reset();
+
+  ImuCalibration& calibration() { return calib_; }
+  ImuDecimator& decimator() { return decimator_; }
+  ImuFilterBank& filter() { return filter_; }
+  // Sequence number of the next stamp
+  uint8_t groupSeq() const { return group_seq_; }
+
+private:
+  ImuCalibration calib_;
+  ImuDecimator decimator_;
+  ImuFilterBank filter_;
+  uint8_t group_seq_ = 0;
+};
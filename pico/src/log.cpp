@@ -0,0 +1,120 @@
+#include "log.h"
+#include <stdio.h>
+#include "ring_buffer.h"
+#include "usb_frame.h"
+
+#ifdef ARDUINO
+#include <Arduino.h>
+static inline uint32_t logNow() { return micros(); }
+#else
+#include <time.h>
+static inline uint32_t logNow() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)(ts.tv_sec * 1000000ull + ts.tv_nsec / 1000);
+}
+#endif
+
+static const char* const kFormats[LOG_FORMAT_COUNT] = {
+#define LOG_FORMAT(id, text) text,
+#include "log_formats.def"
+#undef LOG_FORMAT
+};
+
+static RingBuffer<LogRecord, 128> ring;
+static uint32_t reported_lost = 0;
+
+void logWrite(uint8_t level, uint16_t format, uint8_t nargs,
+              uint32_t a0, uint32_t a1, uint32_t a2) {
+  LogRecord rec;
+  rec.timestamp_us = logNow();
+  rec.format = format;
+  rec.level = level;
+  rec.nargs = nargs;
+  rec.args[0] = a0;
+  rec.args[1] = a1;
+  rec.args[2] = a2;
+  ring.push(rec);
+}
+
+void logPackRecord(const LogRecord& rec, uint8_t out[LOG_RECORD_SIZE]) {
+  putLe32(out, rec.timestamp_us);
+  out[4] = (uint8_t)rec.format;
+  out[5] = (uint8_t)(rec.format >> 8);
+  out[6] = rec.level;
+  out[7] = rec.nargs;
+  for (int i = 0; i < 3; i++) putLe32(out + 8 + 4 * i, rec.args[i]);
+}
+
+void logUnpackRecord(const uint8_t in[LOG_RECORD_SIZE], LogRecord* rec) {
+  rec->timestamp_us = getLe32(in);
+  rec->format = (uint16_t)(in[4] | (in[5] << 8));
+  rec->level = in[6];
+  rec->nargs = in[7] > 3 ? 3 : in[7];
+  for (int i = 0; i < 3; i++) rec->args[i] = getLe32(in + 8 + 4 * i);
+}
+
+size_t logNextFrame(uint8_t* out) {
+  LogRecord rec;
+  const uint32_t lost = ring.dropped();
+  if (lost != reported_lost) {
+    rec.timestamp_us = logNow();
+    rec.format = LOG_LOST;
+    rec.level = LOG_LEVEL_WARN;
+    rec.nargs = 1;
+    rec.args[0] = lost - reported_lost;
+    rec.args[1] = rec.args[2] = 0;
+    reported_lost = lost;
+  } else if (!ring.pop(&rec)) {
+    return 0;
+  }
+  uint8_t payload[LOG_RECORD_SIZE];
+  logPackRecord(rec, payload);
+  return usbFrameEncode(USB_FRAME_LOG, payload, LOG_RECORD_SIZE, out);
+}
+
+const char* logLevelName(uint8_t level) {
+  static const char* const names[] = {"NONE", "ERROR", "WARN", "INFO", "DEBUG", "TRACE"};
+  return level <= LOG_LEVEL_TRACE ? names[level] : "?";
+}
+
+size_t logFormat(const LogRecord& rec, char* out, size_t cap) {
+  if (cap == 0) return 0;
+  if (rec.format >= LOG_FORMAT_COUNT) {
+    return (size_t)snprintf(out, cap, "unknown format %u", rec.format);
+  }
+  const char* f = kFormats[rec.format];
+  size_t n = 0;
+  int arg = 0;
+  while (*f && n + 1 < cap) {
+    if (f[0] != '%' || !f[1]) {
+      out[n++] = *f++;
+      continue;
+    }
+    const char spec = f[1];
+    f += 2;
+    if (spec == '%') {
+      out[n++] = '%';
+      continue;
+    }
+    const uint32_t v = arg < rec.nargs ? rec.args[arg] : 0;
+    arg++;
+    int w;
+    switch (spec) {
+      case 'd': w = snprintf(out + n, cap - n, "%ld", (long)(int32_t)v); break;
+      case 'x': w = snprintf(out + n, cap - n, "%lx", (unsigned long)v); break;
+      case 'c': w = snprintf(out + n, cap - n, "%c", (char)v); break;
+      case 'f': {
+        float fv;
+        memcpy(&fv, &v, 4);
+        w = snprintf(out + n, cap - n, "%g", (double)fv);
+        break;
+      }
+      default: w = snprintf(out + n, cap - n, "%lu", (unsigned long)v); break;
+    }
+    if (w < 0) break;
+    n += (size_t)w < cap - n ? (size_t)w : cap - n - 1;
+  }
+  out[n] = '\0';
+  return n;
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// Deferred binary logging.
+//
+// A call stores a fixed-size record (timestamp, format ID, up to three
+// 32-bit args) in a RAM ring; the main loop ships records to the debug CDC
+// as USB_FRAME_LOG frames when the loop is idle, and the host tool
+// (`program logdump <tty>`) turns them back into text using the same
+// log_formats.def table. Calls above LOG_LEVEL compile to nothing.
+
+#define LOG_LEVEL_NONE  0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_INFO  3
+#define LOG_LEVEL_DEBUG 4
+#define LOG_LEVEL_TRACE 5
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+enum LogFormat : uint16_t {
+#define LOG_FORMAT(id, text) id,
+#include "log_formats.def"
+#undef LOG_FORMAT
+  LOG_FORMAT_COUNT
+};
+
+struct LogRecord {
+  uint32_t timestamp_us;
+  uint16_t format;
+  uint8_t level;
+  uint8_t nargs;
+  uint32_t args[3];
+};
+
+static const size_t LOG_RECORD_SIZE = 20;  // packed wire size
+
+// Raw 32-bit view of an argument (floats keep their bit pattern)
+static inline uint32_t logArg(int v) { return (uint32_t)v; }
+static inline uint32_t logArg(unsigned v) { return v; }
+static inline uint32_t logArg(long v) { return (uint32_t)v; }
+static inline uint32_t logArg(unsigned long v) { return (uint32_t)v; }
+static inline uint32_t logArg(float v) { uint32_t u; memcpy(&u, &v, 4); return u; }
+static inline uint32_t logArg(double v) { return logArg((float)v); }
+
+void logWrite(uint8_t level, uint16_t format, uint8_t nargs,
+              uint32_t a0 = 0, uint32_t a1 = 0, uint32_t a2 = 0);
+
+#define LOG_ARGS_0(lvl, fmt) logWrite(lvl, fmt, 0)
+#define LOG_ARGS_1(lvl, fmt, a) logWrite(lvl, fmt, 1, logArg(a))
+#define LOG_ARGS_2(lvl, fmt, a, b) logWrite(lvl, fmt, 2, logArg(a), logArg(b))
+#define LOG_ARGS_3(lvl, fmt, a, b, c) logWrite(lvl, fmt, 3, logArg(a), logArg(b), logArg(c))
+#define LOG_PICK(_0, _1, _2, _3, name, ...) name
+#define LOG_AT(lvl, ...) \
+  LOG_PICK(__VA_ARGS__, LOG_ARGS_3, LOG_ARGS_2, LOG_ARGS_1, LOG_ARGS_0, _)(lvl, __VA_ARGS__)
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_E(...) LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_E(...) ((void)0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_W(...) LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_W(...) ((void)0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_I(...) LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_I(...) ((void)0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_D(...) LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_D(...) ((void)0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_TRACE
+#define LOG_T(...) LOG_AT(LOG_LEVEL_TRACE, __VA_ARGS__)
+#else
+#define LOG_T(...) ((void)0)
+#endif
+
+// Encode the next pending record as a USB frame into `out` (at least
+// LOG_RECORD_SIZE + USB_FRAME_OVERHEAD bytes). Returns 0 when the ring is
+// empty. Lost records are reported once as a LOG_LOST record.
+size_t logNextFrame(uint8_t* out);
+
+void logPackRecord(const LogRecord& rec, uint8_t out[LOG_RECORD_SIZE]);
+void logUnpackRecord(const uint8_t in[LOG_RECORD_SIZE], LogRecord* rec);
+
+// Format a record as text (host side); returns the text length.
+size_t logFormat(const LogRecord& rec, char* out, size_t cap);
+const char* logLevelName(uint8_t level);
@@ -1,7 +1,30 @@
 #include <Arduino.h>
 #include "Adafruit_TinyUSB.h"
 #include <SPI.h>
-#include <mcp_can.h>
+#include <EEPROM.h>
+#include <hardware/timer.h>
+#include "mcp2515.h"
+#include "spi_bus_arduino.h"
+#include "can_pio.h"
+#include "can_wire.h"
+#include "can_rx_filter.h"
+#include "ring_buffer.h"
+#include "usb_frame.h"
+#include "imu_codec.h"
+#include "slcan.h"
+#include "gs_usb.h"
+#include "usb_gs_device.h"
+#include "log.h"
+#include "scheduler.h"
+#include "clock_sync.h"
+#include "can_time_sync.h"
+#include "imu_pipeline.h"
+#include "dsp_bench.h"
+
+// usb_can and Serial each need a CDC instance (CFG_TUD_CDC in platformio.ini)
+#if CFG_TUD_CDC < 2
+#error "CFG_TUD_CDC must be at least 2"
+#endif
 
 // CAN Pins (based on rp2350_can)
 const int PIN_CAN_INT  = 8;
@@ -10,60 +33,620 @@ const int PIN_SPI_SCK  = 10;
 const int PIN_SPI_MOSI = 11;
 const int PIN_SPI_MISO = 12;
 
-// MCP_CAN instance
-MCP_CAN CAN0(&SPI1, PIN_SPI_CS);
+// Transceiver pins for the PIO CAN controller (CAN_TRANSPORT_PIO builds)
+const int PIN_PIOCAN_RX = 4;
+const int PIN_PIOCAN_TX = 5;
+
+const uint32_t CAN_BITRATE = 1000000;
+
+// MCP2515 on SPI1 at the chip's 10 MHz limit
+ArduinoSpiBus can_spi(SPI1, PIN_SPI_CS);
+Mcp2515 CAN0(can_spi);
 
-// USB WebUSB object
+#ifdef CAN_TRANSPORT_PIO
+PioCan pio_can(0, PIN_PIOCAN_RX, PIN_PIOCAN_TX);
+CanTransport& can_bus = pio_can;
+#else
+CanTransport& can_bus = CAN0;
+#endif
+
+// Gateway ID list ("rxids"), opened up while a host adapter session runs
+CanRxFilter can_rx_filter(can_bus);
+
+// USB interfaces, each with its own endpoints and FIFOs:
+//   [gs_usb]  vendor, CAN adapter (USB_GS_USB builds, must be first)
+//   usb_web   vendor, IMU stream + device feedback (WebUSB)
+//   usb_can   CDC, slcan CAN adapter
+//   Serial    CDC, debug log (added by the core after ours)
 Adafruit_USBD_WebUSB usb_web;
+Adafruit_USBD_CDC usb_can;
 
 // Landing Page: Scheme (1: https), URL
 WEBUSB_URL_DEF(landingPage, 1 /*https*/, "edometro.github.io/web-imu-to-usb-streamer/");
 
+// slcan adapter on its own CDC interface
+Slcan slcan(can_bus, can_rx_filter, CAN_BITRATE);
+
+#ifdef USB_GS_USB
+// gs_usb (candleLight) interface, sharing the bus with the IMU gateway
+GsUsb gs_proto(can_bus, can_rx_filter, CAN_BITRATE);
+UsbGsDevice gs_usb_dev(gs_proto);
+#endif
+
 // CSV parsing buffer
 String inputBuffer = "";
 bool can_initialized = false;
 
-void sendIMUtoCAN(float alpha, float beta, float gamma, float ax, float ay, float az) {
+// CAN RX: INT pin only raises a flag, the loop drains the controller
+// into this ring and streams it to the browser in batched binary frames.
+struct CanRxEntry {
+  uint32_t timestamp_us;
+  CanFrame frame;
+};
+RingBuffer<CanRxEntry, 64> can_rx_ring;
+volatile bool can_rx_pending = false;
+
+// Flush a partial batch once its oldest frame is this old
+const uint32_t CAN_RX_BATCH_MAX_AGE_US = 5000;
+
+// Main loop scheduler; tasks are registered in setup(), "sched" reports
+// their runtime
+static uint32_t schedClock() { return micros(); }
+Scheduler scheduler(schedClock);
+
+// Default acceptance list; replaced at runtime with "rxids,<id>,..."
+const uint32_t CAN_RX_DEFAULT_IDS[] = {0x100, 0x101, 0x200};
+
+// Browser clock estimate from "ping,<t1>[,<t1'>,<t4'>]" exchanges: the
+// browser echoes its receive time t4 of the previous PONG in the next ping
+ClockSync clock_sync;
+struct SyncExchange {
+  uint64_t t1, t2, t3;
+};
+SyncExchange last_sync = {0, 0, 0};
+
+// Parsed samples -> CAN groups (imu_pipeline.h, shared with the native
+// gateway): accelerometer bias/scale ("cal,..."), input rate -> CAN
+// rate ("decim,<ratio>[,<taps per phase>]", 1 = off), then the
+// fixed-point filters ("filt,...", all off by default)
+ImuPipeline imu_pipeline;
+ImuCalibration& imu_calib = imu_pipeline.calibration();
+ImuDecimator& imu_decimator = imu_pipeline.decimator();
+ImuFilterBank& imu_filter = imu_pipeline.filter();
+
+// The calibration is loaded from the emulated EEPROM (last flash
+// sector) at boot
+const size_t EEPROM_SIZE = 256;
+const int EEPROM_CALIB_ADDR = 0;
+ImuCalibrator imu_calibrator;
+bool imu_calib_in_flash = false;  // false once changed since load/save
+
+// CAN time distribution: SYNC/FUP counter
+uint8_t tsync_seq = 0;
+
+// Per-sample CAN send time, reported by "canstat"
+uint32_t can_samples = 0;
+uint32_t can_time_us = 0;
+
+// USB samples and gaps in their sequence numbers, reported by "stat"
+uint32_t usb_samples = 0;
+uint32_t usb_seq_missed = 0;
+uint32_t usb_last_seq = 0;
+bool usb_have_seq = false;
+
+// One group from the pipeline; its 0x504 stamp carries the sample time
+// in the device clock.
+void sendIMUtoCAN(const CanFrame frames[IMU_CAN_FRAMES], const CanFrame& stamp) {
   if (!can_initialized) {
     usb_web.println("ERR:NO_CAN_INIT");
     return;
   }
 
-  uint8_t data[8];
-  bool success = true;
-  
-  // Pack alpha, beta (4B + 4B = 8B) -> ID 0x501
-  memcpy(data, &alpha, 4);
-  memcpy(data + 4, &beta, 4);
-  if (CAN0.sendMsgBuf(0x501, 0, 8, data) != CAN_OK) success = false;
-
-  // Pack gamma, ax (4B + 4B = 8B) -> ID 0x502
-  memcpy(data, &gamma, 4);
-  memcpy(data + 4, &ax, 4);
-  if (CAN0.sendMsgBuf(0x502, 0, 8, data) != CAN_OK) success = false;
-
-  // Pack ay, az (4B + 4B = 8B) -> ID 0x503
-  memcpy(data, &ay, 4);
-  memcpy(data + 4, &az, 4);
-  if (CAN0.sendMsgBuf(0x503, 0, 8, data) != CAN_OK) success = false;
+  // Both calls only queue: TX buffers + single RTS on the MCP2515 (the
+  // rest is fed from taskCan), in-order queue on PIO. Either way frames
+  // leave in call order, so receivers always see 0x501..0x504 in order.
+  uint32_t t0 = micros();
+  bool success = can_bus.sendBatch(frames, IMU_CAN_FRAMES) && can_bus.send(stamp);
+  can_time_us += micros() - t0;
+  can_samples++;
 
   if (success) {
     usb_web.println("ACK");
   } else {
     // エラー詳細を返す
     usb_web.println("ERR:CAN_SEND");
+    LOG_W(LOG_CAN_SEND_FAIL, can_samples);
+  }
+}
+
+void onCanInterrupt() {
+  can_rx_pending = true;
+}
+
+void drainCanRx() {
+#ifndef CAN_TRANSPORT_PIO
+  // INT is level-low while RX flags are set, so also poll the pin in case
+  // an edge arrived while the previous drain was running.
+  if (!can_rx_pending && digitalRead(PIN_CAN_INT) == HIGH) return;
+  can_rx_pending = false;
+#endif
+
+  CanRxEntry entry;
+  while (can_bus.receive(&entry.frame)) {
+    entry.timestamp_us = micros();
+    if (usb_web.connected()) can_rx_ring.push(entry);
+    slcan.onReceive(entry.frame, entry.timestamp_us / 1000);
+#ifdef USB_GS_USB
+    gs_proto.onReceive(entry.frame, entry.timestamp_us);
+#endif
+  }
+
+  static uint32_t reported_drops = 0;
+  if (can_rx_ring.dropped() != reported_drops) {
+    LOG_W(LOG_CAN_RX_DROP, can_rx_ring.dropped() - reported_drops);
+    reported_drops = can_rx_ring.dropped();
+  }
+}
+
+void serviceSlcan() {
+  // slcand killed or the port closed without 'C': the tty close drops
+  // DTR, and the gateway's filter must not stay open
+  static bool dtr = false;
+  const bool dtr_now = usb_can.dtr();
+  if (dtr && !dtr_now) slcan.onDisconnect();
+  dtr = dtr_now;
+
+  uint8_t buf[64];
+  int n = usb_can.available();
+  if (n > 0) {
+    n = usb_can.readBytes((char*)buf, n < (int)sizeof(buf) ? n : (int)sizeof(buf));
+    slcan.feed(buf, n);
+  }
+
+  // One USB write per pass with whatever fits
+  size_t pending = slcan.outputLength();
+  if (pending == 0) return;
+  int room = usb_can.availableForWrite();
+  if (room <= 0) return;
+  size_t len = pending < (size_t)room ? pending : (size_t)room;
+  slcan.consume(usb_can.write(slcan.output(), len));
+  usb_can.flush();
+}
+
+// Two-step time sync: SYNC, then FUP with the device time at which SYNC
+// left the controller. Without a TX confirmation no FUP is sent and
+// receivers drop the unmatched SYNC.
+void taskTimeSync() {
+  if (!can_initialized) return;
+  CanFrame frame;
+  canTsyncPackSync(tsync_seq, &frame);
+  if (can_bus.send(frame) && can_bus.waitTxDone()) {
+    const uint64_t sync_end_us = time_us_64();
+    canTsyncPackFup(tsync_seq, sync_end_us, &frame);
+    can_bus.send(frame);
+  }
+  tsync_seq++;
+}
+
+// Ship pending log records to the debug CDC only while it has room, so
+// logging never blocks the loop; the ring counts what it had to drop.
+void drainLog() {
+  uint8_t out[LOG_RECORD_SIZE + USB_FRAME_OVERHEAD];
+  while ((size_t)Serial.availableForWrite() >= sizeof(out)) {
+    size_t n = logNextFrame(out);
+    if (n == 0) break;
+    Serial.write(out, n);
+  }
+}
+
+void streamCanRx() {
+  const CanRxEntry* oldest = can_rx_ring.peek();
+  if (!oldest || !usb_web.connected()) return;
+
+  // A batch is sized to what the IN FIFO takes now (three records with
+  // the default 64-byte vendor FIFO), never more, so a backlog larger
+  // than the FIFO still drains
+  const size_t room = (size_t)usb_web.availableForWrite();
+  if (room < 1 + USB_CAN_RX_RECORD_SIZE + USB_FRAME_OVERHEAD) {
+    return;  // keep frames queued until the endpoint has room
+  }
+  size_t fit = (room - 1 - USB_FRAME_OVERHEAD) / USB_CAN_RX_RECORD_SIZE;
+  if (fit > USB_CAN_RX_MAX_RECORDS) fit = USB_CAN_RX_MAX_RECORDS;
+
+  const size_t pending = can_rx_ring.size();
+  if (pending < fit && micros() - oldest->timestamp_us < CAN_RX_BATCH_MAX_AGE_US) {
+    return;
   }
+
+  uint8_t payload[USB_FRAME_MAX_PAYLOAD];
+  uint8_t out[USB_FRAME_MAX_PAYLOAD + USB_FRAME_OVERHEAD];
+  const size_t count = pending < fit ? pending : fit;
+
+  size_t len = 1;
+  CanRxEntry entry;
+  for (size_t i = 0; i < count && can_rx_ring.pop(&entry); i++) {
+    uint8_t* rec = payload + len;
+    putLe32(rec, entry.timestamp_us);
+    putLe32(rec + 4, entry.frame.id | (entry.frame.extended ? 0x80000000u : 0));
+    rec[8] = entry.frame.dlc;
+    memcpy(rec + 9, entry.frame.data, 8);
+    len += USB_CAN_RX_RECORD_SIZE;
+  }
+  payload[0] = (uint8_t)((len - 1) / USB_CAN_RX_RECORD_SIZE);
+
+  size_t n = usbFrameEncode(USB_FRAME_CAN_RX, payload, (uint8_t)len, out);
+  usb_web.write(out, n);
+  usb_web.flush();
 }
 
 // Callback for WebUSB connection state
 void line_state_callback(bool connected) {
   digitalWrite(LED_BUILTIN, connected);
   if (connected) {
+    imu_calibrator.cancel();
+    imu_pipeline.reset();
+    // A new page has its own performance.now() epoch
+    clock_sync.reset();
+    last_sync = {0, 0, 0};
     usb_web.println("WEBUSB_CONNECTED_CALLBACK");
     usb_web.flush();
   }
 }
 
+// Called by the core before it starts TinyUSB: registering every
+// interface here means the host sees the final configuration on first
+// enumeration, with no detach/attach afterwards.
+void initVariant() {
+#ifdef USB_GS_USB
+  // The Linux gs_usb driver binds interface 0 of 1d50:606f
+  TinyUSBDevice.setID(0x1D50, 0x606F);
+  gs_usb_dev.begin();
+#endif
+
+  usb_web.setLandingPage(&landingPage);
+  usb_web.setLineStateCallback(line_state_callback);
+  usb_web.setStringDescriptor("IMU Stream");
+  usb_web.begin();
+
+  usb_can.setStringDescriptor("CAN slcan");
+  usb_can.begin(115200);
+}
+
+// ---- Main loop tasks (registered with the scheduler in setup) ----
+
+void taskUsb() {
+  #ifdef TINYUSB_NEED_POLLING_TASK
+  // Manual call tud_task since it isn't called by Core's background
+  TinyUSBDevice.task();
+  #endif
+#ifdef USB_GS_USB
+  gs_usb_dev.task();
+#endif
+}
+
+void reportSchedStats() {
+  Scheduler::TaskStats st;
+  for (uint8_t i = 0; scheduler.stats(i, &st); i++) {
+    usb_web.printf("SCHED,%s,%u,%lu,%lu,%lu,%lu,%lu,%lu\n", st.name, st.priority,
+                   (unsigned long)st.period_us, (unsigned long)st.runs,
+                   (unsigned long)st.avg_us, (unsigned long)st.max_us,
+                   (unsigned long)st.late, (unsigned long)st.max_lag_us);
+  }
+  usb_web.printf("SCHEDLOOP,%lu,%lu,%lu\n", (unsigned long)scheduler.passes(),
+                 (unsigned long)scheduler.avgPassUs(), (unsigned long)scheduler.maxPassUs());
+  usb_web.flush();
+  scheduler.resetStats();
+}
+
+// "ping,<t1>[,<t1'>,<t4'>]" -> "PONG,<t1>,<t2>,<t3>", all in microseconds
+// (t1/t4 browser clock, t2/t3 device clock)
+void handleSyncPing(const String& line, uint64_t t2) {
+  const char* p = line.c_str() + 5;
+  char* end;
+  uint64_t t1 = strtoull(p, &end, 10);
+  if (*end == ',') {
+    uint64_t prev_t1 = strtoull(end + 1, &end, 10);
+    uint64_t prev_t4 = (*end == ',') ? strtoull(end + 1, &end, 10) : 0;
+    if (prev_t4 && prev_t1 == last_sync.t1 && last_sync.t2 &&
+        clock_sync.addSample(prev_t1, last_sync.t2, last_sync.t3, prev_t4)) {
+      LOG_D(LOG_CLOCK_SYNC, clock_sync.lastDelayUs(), clock_sync.driftPpb(), clock_sync.samples());
+    }
+  }
+
+  uint64_t t3 = time_us_64();
+  usb_web.printf("PONG,%llu,%llu,%llu\n", (unsigned long long)t1, (unsigned long long)t2,
+                 (unsigned long long)t3);
+  usb_web.flush();
+  last_sync = {t1, t2, t3};
+}
+
+void loadCalibration() {
+  uint8_t rec[IMU_CALIB_RECORD_SIZE];
+  for (size_t i = 0; i < sizeof(rec); i++) rec[i] = EEPROM.read(EEPROM_CALIB_ADDR + i);
+  imuCalibIdentity(&imu_calib);
+  imu_calib_in_flash = imuCalibUnpack(rec, &imu_calib);
+}
+
+bool saveCalibration() {
+  uint8_t rec[IMU_CALIB_RECORD_SIZE];
+  imuCalibPack(imu_calib, rec);
+  for (size_t i = 0; i < sizeof(rec); i++) EEPROM.write(EEPROM_CALIB_ADDR + i, rec[i]);
+  imu_calib_in_flash = EEPROM.commit();
+  return imu_calib_in_flash;
+}
+
+// CAL,<flash|ram>,<bias ax ay az>,<scale ax ay az>,<poses captured>
+void reportCalibration() {
+  usb_web.printf("CAL,%s,%.4f,%.4f,%.4f,%.5f,%.5f,%.5f,%u\n", imu_calib_in_flash ? "flash" : "ram",
+                 imu_calib.bias[IMU_AX], imu_calib.bias[IMU_AY], imu_calib.bias[IMU_AZ],
+                 imu_calib.scale[IMU_AX], imu_calib.scale[IMU_AY], imu_calib.scale[IMU_AZ],
+                 imu_calibrator.poses());
+}
+
+// A capture just completed: report it, and for "still" take the means
+// as the new accelerometer bias
+void finishCapture() {
+  const float* m = imu_calibrator.mean();
+  if (!imu_calibrator.still()) {
+    usb_web.printf("ERR:CAL_MOTION,%.3f\n", imu_calibrator.motionRms());
+  } else if (imu_calibrator.lastKind() == ImuCalibrator::CAPTURE_STILL) {
+    const float* drift = imu_calibrator.driftRate();
+    for (uint8_t i = IMU_AX; i <= IMU_AZ; i++) imu_calib.bias[i] = m[i];
+    imu_calib_in_flash = false;
+    usb_web.printf("CAL,STILL,%u,%.4f,%.4f,%.4f,%.3f,%.5f,%.5f,%.5f\n", imu_calibrator.lastSamples(),
+                   m[IMU_AX], m[IMU_AY], m[IMU_AZ], imu_calibrator.motionRms(),
+                   drift[IMU_ALPHA], drift[IMU_BETA], drift[IMU_GAMMA]);
+  } else {
+    usb_web.printf("CAL,POSE,%u,%.4f,%.4f,%.4f,%.3f,%u\n", imu_calibrator.lastPose(),
+                   m[IMU_AX], m[IMU_AY], m[IMU_AZ], imu_calibrator.motionRms(),
+                   imu_calibrator.poses());
+  }
+  usb_web.flush();
+  // The capture consumed the stream (with gravity, for poses)
+  imu_pipeline.reset();
+}
+
+// "cal"                          report the active calibration
+// "cal,still[,<samples>]"        capture at rest -> accelerometer bias
+// "cal,pose,<i>[,<samples>]"     capture pose i (gravity included)
+// "cal,fit"                      bias + scale from the captured poses
+// "cal,save" / "cal,reset"       write to flash / back to identity
+void handleCalibration(const String& line) {
+  const char* arg = line.c_str() + 3;
+  char* end;
+  bool ok = true;
+  if (*arg == '\0') {
+    reportCalibration();
+  } else if (!strncmp(arg, ",still", 6) && (arg[6] == '\0' || arg[6] == ',')) {
+    const unsigned long n = arg[6] == ',' ? strtoul(arg + 7, &end, 10) : ImuCalibrator::kDefaultSamples;
+    ok = n <= UINT16_MAX && imu_calibrator.start(ImuCalibrator::CAPTURE_STILL, (uint16_t)n);
+    if (ok) usb_web.printf("CAL,START,still,%lu\n", n);
+  } else if (!strncmp(arg, ",pose,", 6)) {
+    const unsigned long pose = strtoul(arg + 6, &end, 10);
+    const unsigned long n = *end == ',' ? strtoul(end + 1, &end, 10) : ImuCalibrator::kDefaultSamples;
+    ok = *end == '\0' && pose < ImuCalibrator::kMaxPoses && n <= UINT16_MAX &&
+         imu_calibrator.start(ImuCalibrator::CAPTURE_POSE, (uint16_t)n, (uint8_t)pose);
+    if (ok) usb_web.printf("CAL,START,pose,%lu,%lu\n", pose, n);
+  } else if (!strcmp(arg, ",fit")) {
+    float residual;
+    ok = imu_calibrator.fit(&imu_calib, &residual);
+    if (ok) {
+      imu_calib_in_flash = false;
+      usb_web.printf("CAL,FIT,%.4f,%.4f,%.4f,%.5f,%.5f,%.5f,%.4f\n", imu_calib.bias[IMU_AX],
+                     imu_calib.bias[IMU_AY], imu_calib.bias[IMU_AZ], imu_calib.scale[IMU_AX],
+                     imu_calib.scale[IMU_AY], imu_calib.scale[IMU_AZ], residual);
+    }
+  } else if (!strcmp(arg, ",save")) {
+    ok = saveCalibration();
+    if (ok) reportCalibration();
+  } else if (!strcmp(arg, ",reset")) {
+    imuCalibIdentity(&imu_calib);
+    imu_calibrator.cancel();
+    imu_calibrator.clearPoses();
+    imu_calib_in_flash = false;
+    reportCalibration();
+  } else {
+    ok = false;
+  }
+  if (!ok) usb_web.println("ERR:CAL");
+  usb_web.flush();
+}
+
+void handleLine(String& line, uint64_t rx_us) {
+  line.trim();
+  LOG_T(LOG_USB_LINE, line.length());
+  if (line == "ping") {
+    usb_web.println("PONG");
+    usb_web.flush();
+    LOG_D(LOG_PING);
+  } else if (line.startsWith("ping,")) {
+    handleSyncPing(line, rx_us);
+  } else if (line == "clock") {
+    // CLOCK,<valid>,<offset_us device-browser>,<drift_ppb>,<min_delay_us>,<last_delay_us>,<samples>
+    uint64_t now = time_us_64();
+    usb_web.printf("CLOCK,%u,%lld,%ld,%lu,%lu,%lu\n", clock_sync.valid() ? 1 : 0,
+                   (long long)clock_sync.offsetUs(now), (long)clock_sync.driftPpb(),
+                   (unsigned long)clock_sync.minDelayUs(), (unsigned long)clock_sync.lastDelayUs(),
+                   (unsigned long)clock_sync.samples());
+    usb_web.flush();
+  } else if (line.startsWith("filt,")) {
+    if (imu_filter.configure(line.c_str() + 5)) {
+      usb_web.print("FILT");
+      for (uint8_t i = 0; i < IMU_CHANNELS; i++) {
+        usb_web.print(',');
+        usb_web.print(ImuFilterBank::kindName(imu_filter.kind(i)));
+      }
+      usb_web.println();
+    } else {
+      usb_web.println("ERR:FILT");
+    }
+    usb_web.flush();
+  } else if (line.startsWith("decim,")) {
+    char* end;
+    const unsigned long ratio = strtoul(line.c_str() + 6, &end, 10);
+    const unsigned long per_phase = *end == ',' ? strtoul(end + 1, &end, 10)
+                                                : ImuDecimator::kMaxTapsPerPhase;
+    if (*end == '\0' && ratio <= ImuDecimator::kMaxRatio && per_phase <= ImuDecimator::kMaxTapsPerPhase &&
+        imu_decimator.configure((uint8_t)ratio, (uint8_t)per_phase)) {
+      usb_web.printf("DECIM,%u,%u\n", imu_decimator.ratio(), imu_decimator.taps());
+    } else {
+      usb_web.println("ERR:DECIM");
+    }
+    usb_web.flush();
+  } else if (line == "cal" || line.startsWith("cal,")) {
+    handleCalibration(line);
+  } else if (line == "dspbench") {
+    // Scalar vs SMLAD kernels: DSPBENCH,<kernel>,<samples>,<mismatches>,<scalar_us>,<simd_us>
+    DspBenchResult r[DSP_BENCH_KERNELS];
+    dspBench(4096, micros(), schedClock, r);
+    for (uint8_t i = 0; i < DSP_BENCH_KERNELS; i++) {
+      usb_web.printf("DSPBENCH,%s,%lu,%lu,%lu,%lu\n", r[i].kernel, (unsigned long)r[i].samples,
+                     (unsigned long)r[i].mismatches, (unsigned long)r[i].scalar_us,
+                     (unsigned long)r[i].simd_us);
+    }
+    usb_web.flush();
+  } else if (line == "sched") {
+    reportSchedStats();
+  } else if (line == "canstat") {
+    // CANSTAT,<transport>,<samples>,<transport cost>,<us/sample>,<wire us>
+    // since the last query. The cost is SPI bytes per sample on the
+    // MCP2515 and bus errors on the PIO controller; the wire time of one
+    // group plus its stamp is there for comparison.
+    uint32_t n = can_samples ? can_samples : 1;
+    CanFrame group[IMU_CAN_FRAMES + 1];
+    float zero[IMU_CHANNELS] = {0};
+    imuPackFrames(zero, group);
+    imuPackStamp(0, 0, &group[IMU_CAN_FRAMES]);
+    uint32_t wire_ns = 0;
+    for (const CanFrame& f : group) wire_ns += canFrameWireTimeNs(f, CAN_BITRATE);
+#ifdef CAN_TRANSPORT_PIO
+    const uint32_t cost = pio_can.errors();
+    pio_can.resetStats();
+#else
+    const uint32_t cost = CAN0.spiBytes() / n;
+    CAN0.resetStats();
+#endif
+    usb_web.printf("CANSTAT,%s,%lu,%lu,%lu,%lu\n", can_bus.name(), (unsigned long)can_samples,
+                   (unsigned long)cost, (unsigned long)(can_time_us / n),
+                   (unsigned long)(wire_ns / 1000));
+    usb_web.flush();
+    can_samples = 0;
+    can_time_us = 0;
+  } else if (line == "stat") {
+    // STAT,<samples>,<seq missed>,<USB OUT backlog bytes>,<CAN RX ring depth>
+    // since the last query; the depths are the current values
+    usb_web.printf("STAT,%lu,%lu,%d,%u\n", (unsigned long)usb_samples,
+                   (unsigned long)usb_seq_missed, usb_web.available(),
+                   (unsigned)can_rx_ring.size());
+    usb_web.flush();
+    usb_samples = 0;
+    usb_seq_missed = 0;
+  } else if (line.startsWith("rxids")) {
+    // rxids,0x100,0x200,... : up to 32 CAN IDs to receive (none: all)
+    uint32_t ids[32];
+    uint8_t count = 0;
+    const char* p = line.c_str() + 5;
+    while (*p == ',' && count < 32) {
+      char* end;
+      ids[count] = strtoul(p + 1, &end, 0);
+      if (end == p + 1) break;
+      count++;
+      p = end;
+    }
+    // Leftover input (a 33rd ID or a malformed one) is an error, not a
+    // shorter list
+    const bool leftover = *p == ',';
+    if (can_initialized && !leftover && can_rx_filter.setIds(ids, count)) {
+#ifndef CAN_TRANSPORT_PIO
+      // Report the hardware cover: masks and how many IDs pass
+      const CanFilterConfig& f = CAN0.acceptance();
+      usb_web.printf("CANFILTER,%03X,%03X,%u\n", f.mask[0], f.mask[1], f.accepted);
+      LOG_I(LOG_CAN_FILTER, f.mask[0], f.mask[1], f.accepted);
+#else
+      usb_web.println("ACK");
+#endif
+    } else {
+      usb_web.println("ERR:CAN_FILTER");
+    }
+    usb_web.flush();
+  } else {
+    // Parse CSV: alpha,beta,gamma,ax,ay,az[,browser time us[,seq]]
+    float vals[IMU_CHANNELS] = {0};
+    uint64_t host_us = 0;
+    int64_t seq = -1;
+    if (imuParseCsv(line.c_str(), line.length(), vals, &host_us, &seq) == IMU_CHANNELS) {
+      usb_samples++;
+      if (seq >= 0) {
+        // A step back is a browser restart, not a loss
+        const uint32_t gap = (uint32_t)seq - usb_last_seq - 1;
+        if (usb_have_seq && gap < 0x80000000u) usb_seq_missed += gap;
+        usb_last_seq = (uint32_t)seq;
+        usb_have_seq = true;
+      }
+      // Browser sample time mapped into the device clock once synced,
+      // otherwise the USB arrival time
+      const uint64_t sample_us =
+          (host_us && clock_sync.valid()) ? clock_sync.hostToDevice(host_us) : rx_us;
+      CanFrame frames[IMU_CAN_FRAMES];
+      CanFrame stamp;
+      if (imu_calibrator.capturing()) {
+        // Calibration samples are raw and stay off the bus
+        if (imu_calibrator.push(vals, sample_us)) finishCapture();
+      } else if (imu_pipeline.push(vals, sample_us, frames, &stamp)) {
+        sendIMUtoCAN(frames, stamp);
+      }
+    }
+  }
+}
+
+// USB WebUSB -> UART2 & parse, a bounded number of bytes per run so a
+// burst of input cannot hold up the other tasks
+void taskParse() {
+  for (int budget = 64; budget > 0 && usb_web.available(); budget--) {
+    char c = usb_web.read();
+    Serial2.write(c); // Forward to UART
+
+    if (c == '\r') continue; // Ignore
+    if (c == '\n') {
+      handleLine(inputBuffer, time_us_64());
+      inputBuffer = "";
+    } else {
+      inputBuffer += c;
+    }
+  }
+}
+
+// Queued CAN TX -> controller, CAN -> USB WebUSB / slcan / gs_usb
+void taskCan() {
+  if (!can_initialized) return;
+  can_bus.pollTx();
+  drainCanRx();
+  streamCanRx();
+}
+
+// UART2 (STM32) -> USB WebUSB, in chunks that fit the IN FIFO so a
+// slow host never stalls the loop
+void taskUart() {
+  int pending = Serial2.available();
+  if (pending <= 0) return;
+  uint8_t buf[64];
+  int room = usb_web.connected() ? usb_web.availableForWrite() : (int)sizeof(buf);
+  int n = pending < room ? pending : room;
+  if (n > (int)sizeof(buf)) n = sizeof(buf);
+  if (n > 0) {
+    n = Serial2.readBytes((char*)buf, n);
+    if (usb_web.connected()) {
+      usb_web.write(buf, n);
+      usb_web.flush();
+    }
+  }
+}
+
+// LED blink (Heartbeat)
+void taskHeartbeat() {
+  digitalWrite(LED_BUILTIN, !digitalRead(LED_BUILTIN));
+}
+
 void setup() {
   // 0. Serial Init (USB CDC for Debug)
   Serial.begin(115200);
@@ -71,22 +654,15 @@ void setup() {
   pinMode(LED_BUILTIN, OUTPUT);
   digitalWrite(LED_BUILTIN, HIGH); 
 
-  // 1. Configure WebUSB
-  usb_web.setLandingPage(&landingPage);
-  usb_web.setLineStateCallback(line_state_callback);
-  
-  // Manual begin() checks
+  // 1. USB interfaces were registered in initVariant(); only start the
+  // stack here if the core did not
   if (!TinyUSBDevice.isInitialized()) {
     TinyUSBDevice.begin(0);
   }
-  usb_web.begin();
 
-  // If already mounted, force re-enumeration
-  if (TinyUSBDevice.mounted()) {
-    TinyUSBDevice.detach();
-    delay(10);
-    TinyUSBDevice.attach();
-  }
+  // Calibration from flash (identity if none was saved)
+  EEPROM.begin(EEPROM_SIZE);
+  loadCalibration();
 
   // 2. UART2 Init
   Serial2.begin(115200);
@@ -96,12 +672,20 @@ void setup() {
   SPI1.setTX(PIN_SPI_MOSI);
   SPI1.setRX(PIN_SPI_MISO);
   SPI1.begin();
+  can_spi.begin();
 
-  // 4. CAN Init
-  if (CAN0.begin(MCP_ANY, CAN_1000KBPS, MCP_16MHZ) == CAN_OK) {
-    CAN0.setMode(MCP_NORMAL);
+  // 4. CAN Init (1 Mbps, 16 MHz crystal)
+  if (can_bus.begin(CAN_BITRATE)) {
     can_initialized = true;
+    can_rx_filter.setIds(CAN_RX_DEFAULT_IDS,
+                         sizeof(CAN_RX_DEFAULT_IDS) / sizeof(CAN_RX_DEFAULT_IDS[0]));
+  } else {
+    LOG_E(LOG_CAN_INIT_FAIL);
   }
+#ifndef CAN_TRANSPORT_PIO
+  pinMode(PIN_CAN_INT, INPUT_PULLUP);
+  attachInterrupt(digitalPinToInterrupt(PIN_CAN_INT), onCanInterrupt, FALLING);
+#endif
 
   digitalWrite(LED_BUILTIN, LOW);
   
@@ -111,87 +695,25 @@ void setup() {
     delay(100);
   }
   
-  Serial.println("Setup Complete");
+  // Priority 0 runs first on every pass; periodic tasks are released on
+  // their own grid and report lateness against the deadline
+  scheduler.add("usb", taskUsb, 0);
+  scheduler.add("can", taskCan, 1);
+  scheduler.add("parse", taskParse, 2);
+  scheduler.add("slcan", serviceSlcan, 3);
+  scheduler.add("uart", taskUart, 4);
+  scheduler.add("tsync", taskTimeSync, 5, CAN_TSYNC_PERIOD_US, 10000);
+  scheduler.add("led", taskHeartbeat, 5, 1000000, 50000);
+  scheduler.add("log", drainLog, 6);
+
+  LOG_I(LOG_USB_MOUNT, TinyUSBDevice.mounted() ? 1 : 0);
+#ifdef CAN_TRANSPORT_PIO
+  LOG_I(LOG_SETUP_DONE, can_initialized ? 1 : 0, 1);
+#else
+  LOG_I(LOG_SETUP_DONE, can_initialized ? 1 : 0, 0);
+#endif
 }
 
 void loop() {
-  #ifdef TINYUSB_NEED_POLLING_TASK
-  // Manual call tud_task since it isn't called by Core's background
-  TinyUSBDevice.task();
-  #endif
-
-  // LED blink (Heartbeat)
-  static uint32_t led_timer = 0;
-  if (millis() - led_timer > 1000) {
-    led_timer = millis();
-    digitalWrite(LED_BUILTIN, !digitalRead(LED_BUILTIN));
-    
-    // Debug output to Serial (CDC)
-    // Serial.println("Loop running..."); 
-  }
-
-  // Periodic Heartbeat to WebUSB
-  static uint32_t hb_timer = 0;
-  if (millis() - hb_timer > 3000) {
-    hb_timer = millis();
-    if (usb_web.connected()) {
-      // usb_web.println("HEARTBEAT");
-      // usb_web.flush();
-      // Serial.println("HB SENT");
-    }
-  }
-
-  // USB WebUSB -> UART2 & Parse
-  if (usb_web.available()) {
-    char c = usb_web.read();
-    
-    // Echo back removed to prevent buffer overflow/lag during high-speed streaming
-    // usb_web.write(c);
-    // usb_web.flush();
-
-    
-    Serial.print(c); // Debug to CDC
-    Serial2.write(c); // Forward to UART
-
-    if (c == '\r') return; // Ignore
-
-    if (c == '\n') {
-      inputBuffer.trim();
-      if (inputBuffer == "ping") {
-        usb_web.println("PONG");
-        usb_web.flush();
-        Serial.println("Ping received, Pong sent");
-      } else {
-        // Parse CSV: alpha,beta,gamma,ax,ay,az
-        float vals[6] = {0};
-        int count = 0;
-        int startPos = 0;
-        for (int i = 0; i < inputBuffer.length() && count < 6; i++) {
-          if (inputBuffer.charAt(i) == ',') {
-            vals[count++] = inputBuffer.substring(startPos, i).toFloat();
-            startPos = i + 1;
-          }
-        }
-        if (count < 6 && startPos < inputBuffer.length()) {
-          vals[count++] = inputBuffer.substring(startPos).toFloat();
-        }
-
-        if (count == 6) {
-          sendIMUtoCAN(vals[0], vals[1], vals[2], vals[3], vals[4], vals[5]);
-        }
-      }
-      inputBuffer = "";
-    } else {
-      inputBuffer += c;
-    }
-  }
-  
-  // UART2 (STM32) -> USB WebUSB
-  while (Serial2.available()) {
-    char c = Serial2.read();
-    if (usb_web.connected()) {
-      usb_web.write(c);
-      usb_web.flush();
-    }
-  }
+  scheduler.runOnce();
 }
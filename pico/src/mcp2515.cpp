@@ -0,0 +1,255 @@
+#include "mcp2515.h"
+#include <string.h>
+
+// TXREQ bits of TXB0..TXB2 in the READ STATUS reply
+static const uint8_t kStatusTxReq[Mcp2515::kTxBuffers] = {0x04, 0x10, 0x40};
+static const uint8_t kStatusTxReqAll = 0x54;
+// RX0IF / RX1IF in the READ STATUS reply
+static const uint8_t kStatusRx0 = 0x01;
+static const uint8_t kStatusRx1 = 0x02;
+
+// RXBnCTRL values: RXM=11 receives any frame, RXM=00 uses the filters.
+// BUKT (0x04) lets RXB0 roll over into RXB1.
+static const uint8_t kRxb0Any = 0x64, kRxb1Any = 0x60;
+static const uint8_t kRxb0Filtered = 0x04, kRxb1Filtered = 0x00;
+
+// Polls of READ STATUS in waitTxDone without a buffer freeing up: a
+// frame plus lost arbitration at 1 Mbps. One poll is ~2 us at 10 MHz, a
+// 1 Mbps frame is ~130 us on the wire.
+static const int kTxDonePolls = 1000;
+static const int kModeWaitPolls = 100;
+
+void Mcp2515::transaction(const uint8_t* tx, uint8_t* rx, size_t len) {
+  bus_.select();
+  bus_.transfer(tx, rx, len);
+  bus_.deselect();
+  spi_bytes_ += len;
+  spi_transactions_++;
+}
+
+uint8_t Mcp2515::readRegister(uint8_t addr) {
+  uint8_t tx[3] = {INSTR_READ, addr, 0x00};
+  uint8_t rx[3] = {0};
+  transaction(tx, rx, sizeof(tx));
+  return rx[2];
+}
+
+void Mcp2515::writeRegisters(uint8_t addr, const uint8_t* values, uint8_t len) {
+  uint8_t tx[2 + 16];
+  if (len > 16) len = 16;
+  tx[0] = INSTR_WRITE;
+  tx[1] = addr;
+  memcpy(tx + 2, values, len);
+  transaction(tx, nullptr, 2 + len);
+}
+
+void Mcp2515::modifyRegister(uint8_t addr, uint8_t mask, uint8_t value) {
+  uint8_t tx[4] = {INSTR_BIT_MODIFY, addr, mask, value};
+  transaction(tx, nullptr, sizeof(tx));
+}
+
+uint8_t Mcp2515::readStatus() {
+  uint8_t tx[2] = {INSTR_READ_STATUS, 0x00};
+  uint8_t rx[2] = {0};
+  transaction(tx, rx, sizeof(tx));
+  return rx[1];
+}
+
+bool Mcp2515::setMode(uint8_t mode) {
+  modifyRegister(REG_CANCTRL, MODE_MASK, mode);
+  for (int i = 0; i < kModeWaitPolls; i++) {
+    if ((readRegister(REG_CANSTAT) & MODE_MASK) == mode) return true;
+  }
+  return false;
+}
+
+bool Mcp2515::begin(const BitTiming& timing) {
+  uint8_t reset = INSTR_RESET;
+  transaction(&reset, nullptr, 1);
+  // RESET aborts pending transmissions; frames still queued go too
+  CanFrame dropped;
+  while (tx_queue_.pop(&dropped)) {}
+
+  // After reset the chip comes up in configuration mode once the
+  // oscillator has started; wait for it instead of a fixed delay.
+  bool ready = false;
+  for (int i = 0; i < kModeWaitPolls; i++) {
+    if ((readRegister(REG_CANSTAT) & MODE_MASK) == MODE_CONFIG) { ready = true; break; }
+  }
+  if (!ready) return false;
+
+  // CNF3, CNF2, CNF1, CANINTE, CANINTF are consecutive: one write.
+  // INT is asserted for RX0IF / RX1IF only.
+  const uint8_t cfg[5] = {timing.cnf3, timing.cnf2, timing.cnf1, 0x03, 0x00};
+  writeRegisters(REG_CNF3, cfg, sizeof(cfg));
+
+  // Descending TX priority so TXB0 leaves first, TXB2 last
+  for (uint8_t n = 0; n < kTxBuffers; n++) {
+    const uint8_t prio = 3 - n;
+    writeRegisters(REG_TXB0CTRL + 0x10 * n, &prio, 1);
+  }
+
+  // Receive any frame, RXB0 rolls over into RXB1
+  writeRegisters(REG_RXB0CTRL, &kRxb0Any, 1);
+  writeRegisters(REG_RXB1CTRL, &kRxb1Any, 1);
+
+  return setMode(MODE_NORMAL);
+}
+
+bool Mcp2515::begin(uint32_t bitrate) {
+  switch (bitrate) {
+    case 1000000: return begin(kBitrate1M_16MHz);
+    case 800000:  return begin(kBitrate800k_16MHz);
+    case 500000:  return begin(kBitrate500k_16MHz);
+    case 250000:  return begin(kBitrate250k_16MHz);
+    case 125000:  return begin(kBitrate125k_16MHz);
+    case 100000:  return begin(kBitrate100k_16MHz);
+    case 50000:   return begin(kBitrate50k_16MHz);
+    case 20000:   return begin(kBitrate20k_16MHz);
+    case 10000:   return begin(kBitrate10k_16MHz);
+    default:      return false;
+  }
+}
+
+void Mcp2515::encodeHeader(const CanFrame& frame, uint8_t out[5]) {
+  if (frame.extended) {
+    const uint32_t id = frame.id & 0x1FFFFFFF;
+    out[0] = (uint8_t)(id >> 21);
+    out[1] = (uint8_t)((((id >> 18) & 0x07) << 5) | 0x08 | ((id >> 16) & 0x03));
+    out[2] = (uint8_t)(id >> 8);
+    out[3] = (uint8_t)id;
+  } else {
+    const uint32_t id = frame.id & 0x7FF;
+    out[0] = (uint8_t)(id >> 3);
+    out[1] = (uint8_t)((id & 0x07) << 5);
+    out[2] = 0;
+    out[3] = 0;
+  }
+  out[4] = frame.dlc > 8 ? 8 : frame.dlc;
+}
+
+bool Mcp2515::sendBatch(const CanFrame* frames, uint8_t count) {
+  if (count == 0) return true;
+  if (tx_queue_.size() + count > tx_queue_.capacity()) return false;
+  for (uint8_t n = 0; n < count; n++) tx_queue_.push(frames[n]);
+  pollTx();
+  return true;
+}
+
+void Mcp2515::pollTx() {
+  if (tx_queue_.empty()) return;
+  loadTx(readStatus());
+}
+
+uint8_t Mcp2515::loadTx(uint8_t status) {
+  // A pending TXBn outranks TXBn+1..TXB2 only, so new frames go after
+  // the last pending buffer: anything else would let a later frame
+  // overtake an earlier one.
+  uint8_t first = 0;
+  for (uint8_t n = 0; n < kTxBuffers; n++) {
+    if (status & kStatusTxReq[n]) first = n + 1;
+  }
+  uint8_t busy = status & kStatusTxReqAll;
+
+  // LOAD TX BUFFER: instruction + SIDH..D7 in one CS assertion per buffer
+  uint8_t rts = INSTR_RTS;
+  CanFrame frame;
+  for (uint8_t n = first; n < kTxBuffers && tx_queue_.pop(&frame); n++) {
+    uint8_t tx[1 + 5 + 8];
+    tx[0] = INSTR_LOAD_TX | (uint8_t)(n << 1);
+    encodeHeader(frame, tx + 1);
+    const uint8_t dlc = tx[5];
+    memcpy(tx + 6, frame.data, dlc);
+    transaction(tx, nullptr, 6 + dlc);
+    rts |= (uint8_t)(1 << n);
+    busy |= kStatusTxReq[n];
+  }
+  if (rts != INSTR_RTS) transaction(&rts, nullptr, 1);
+  return busy;
+}
+
+bool Mcp2515::waitTxDone() {
+  uint8_t last = kStatusTxReqAll;
+  for (int polls = 0; polls < kTxDonePolls; polls++) {
+    const uint8_t status = readStatus() & kStatusTxReqAll;
+    if (!status && tx_queue_.empty()) return true;
+    // A buffer cleared: the bus is moving, start counting again
+    if (status != last) polls = 0;
+    last = loadTx(status);
+  }
+  return false;
+}
+
+void Mcp2515::decodeHeader(const uint8_t in[5], CanFrame* frame) {
+  frame->extended = (in[1] & 0x08) != 0;
+  if (frame->extended) {
+    frame->id = ((uint32_t)in[0] << 21) | ((uint32_t)(in[1] >> 5) << 18) |
+                ((uint32_t)(in[1] & 0x03) << 16) | ((uint32_t)in[2] << 8) | in[3];
+  } else {
+    frame->id = ((uint32_t)in[0] << 3) | (in[1] >> 5);
+  }
+  frame->dlc = in[4] & 0x0F;
+  if (frame->dlc > 8) frame->dlc = 8;
+}
+
+bool Mcp2515::receive(CanFrame* frame) {
+  const uint8_t status = readStatus();
+  uint8_t instr;
+  if (status & kStatusRx0) {
+    instr = INSTR_READ_RX;
+  } else if (status & kStatusRx1) {
+    instr = INSTR_READ_RX | 0x04;
+  } else {
+    return false;
+  }
+
+  uint8_t tx[1 + 5 + 8] = {instr};
+  uint8_t rx[1 + 5 + 8];
+  transaction(tx, rx, sizeof(tx));
+  decodeHeader(rx + 1, frame);
+  memset(frame->data, 0, sizeof(frame->data));
+  memcpy(frame->data, rx + 6, frame->dlc);
+  return true;
+}
+
+bool Mcp2515::setAcceptanceIds(const uint32_t* ids, uint8_t count) {
+  CanFilterConfig cfg;
+  if (count == 0) {
+    cfg = {{0, 0}, {0, 0, 0, 0, 0, 0}, 0x800, true};
+  } else if (!canFilterOptimize(ids, count, &cfg)) {
+    return false;
+  }
+  return setAcceptance(cfg);
+}
+
+bool Mcp2515::setAcceptance(const CanFilterConfig& cfg) {
+  if (!setMode(MODE_CONFIG)) return false;
+  filter_ = cfg;
+
+  if (cfg.accept_all) {
+    writeRegisters(REG_RXB0CTRL, &kRxb0Any, 1);
+    writeRegisters(REG_RXB1CTRL, &kRxb1Any, 1);
+    return setMode(MODE_NORMAL);
+  }
+
+  // Masks cover the 11 ID bits only; EID8/EID0 stay clear so the first
+  // two data bytes of standard frames are not compared.
+  for (uint8_t b = 0; b < 2; b++) {
+    const uint8_t mask[4] = {(uint8_t)(cfg.mask[b] >> 3), (uint8_t)((cfg.mask[b] & 0x07) << 5), 0, 0};
+    writeRegisters(REG_RXM0SIDH + 4 * b, mask, 4);
+  }
+
+  // RXF0..2 live at 0x00..0x0B, RXF3..5 at 0x10..0x1B
+  for (uint8_t n = 0; n < kFilters; n++) {
+    CanFrame f = {};
+    f.id = cfg.filter[n];
+    uint8_t hdr[5];
+    encodeHeader(f, hdr);
+    const uint8_t addr = (n < 3 ? REG_RXF0SIDH : REG_RXF3SIDH) + 4 * (n % 3);
+    writeRegisters(addr, hdr, 4);
+  }
+
+  writeRegisters(REG_RXB0CTRL, &kRxb0Filtered, 1);
+  writeRegisters(REG_RXB1CTRL, &kRxb1Filtered, 1);
+  return setMode(MODE_NORMAL);
+}
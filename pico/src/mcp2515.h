@@ -0,0 +1,132 @@
+#pragma once
+#include "can_transport.h"
+#include "can_filter.h"
+#include "ring_buffer.h"
+
+// Minimal SPI abstraction so the driver can run against real hardware
+// or a register-level model on the host.
+class SpiBus {
+public:
+  virtual ~SpiBus() {}
+  virtual void select() = 0;
+  virtual void deselect() = 0;
+  // Full-duplex transfer; rx may be nullptr when the reply is not needed.
+  virtual void transfer(const uint8_t* tx, uint8_t* rx, size_t len) = 0;
+};
+
+// Lean MCP2515 driver.
+// Uses the LOAD TX BUFFER / RTS / READ STATUS shortcut instructions so a
+// frame costs one 14-byte SPI transaction instead of a series of register
+// writes and status polls.
+class Mcp2515 : public CanTransport {
+public:
+  // CNF1..CNF3 bit timing for the 16 MHz crystal used on our boards
+  struct BitTiming { uint8_t cnf1, cnf2, cnf3; };
+  static constexpr BitTiming kBitrate1M_16MHz   = {0x00, 0xD0, 0x82};
+  static constexpr BitTiming kBitrate500k_16MHz = {0x00, 0xF0, 0x86};
+  static constexpr BitTiming kBitrate250k_16MHz = {0x41, 0xF1, 0x85};
+  static constexpr BitTiming kBitrate800k_16MHz = {0x00, 0xDA, 0x81};
+  static constexpr BitTiming kBitrate125k_16MHz = {0x03, 0xF0, 0x86};
+  static constexpr BitTiming kBitrate100k_16MHz = {0x03, 0xFA, 0x87};
+  static constexpr BitTiming kBitrate50k_16MHz  = {0x07, 0xFA, 0x87};
+  static constexpr BitTiming kBitrate20k_16MHz  = {0x0F, 0xFF, 0x87};
+  static constexpr BitTiming kBitrate10k_16MHz  = {0x1F, 0xFF, 0x87};
+
+  // Datasheet limit for the SPI clock
+  static constexpr uint32_t kMaxSpiHz = 10000000;
+  static constexpr uint8_t  kTxBuffers = 3;
+  // Frames waiting for a TX buffer (eight IMU groups with their stamps)
+  static constexpr size_t   kTxQueue = 32;
+
+  explicit Mcp2515(SpiBus& bus) : bus_(bus) {}
+
+  // Reset, program bit timing and enter normal mode. Accepts every frame
+  // (same behaviour as MCP_ANY).
+  bool begin(const BitTiming& timing);
+  // Standard rates from 10k to 1M with the 16 MHz crystal
+  bool begin(uint32_t bitrate) override;
+
+  // Queue the frames (all of them or, when the TX queue lacks room,
+  // none) and load what the controller can take now; never waits for the
+  // bus. Frames leave in call order: with TXP 3, 2, 1 on TXB0..TXB2, a
+  // frame only goes into a buffer after the last pending one, so TXB0 is
+  // refilled once all three are empty. Loaded frames share one RTS.
+  bool sendBatch(const CanFrame* frames, uint8_t count) override;
+  // One READ STATUS, then load queued frames into the free buffers
+  void pollTx() override;
+  // Poll READ STATUS, loading queued frames as buffers free up, until
+  // the queue and all three buffers are empty. Gives up after
+  // kTxDonePolls polls without a frame leaving.
+  bool waitTxDone() override;
+  size_t txQueued() const { return tx_queue_.size(); }
+  const char* name() const override { return "mcp2515"; }
+
+  // Read one pending frame (RXB0 first) with READ RX BUFFER, which also
+  // clears the buffer's interrupt flag.
+  bool receive(CanFrame* frame) override;
+  // Program the two masks / six filters with the tightest cover of the
+  // requested standard IDs (see canFilterOptimize). Count 0 accepts
+  // everything; extended IDs or more than 32 IDs return false and leave
+  // the filters unchanged.
+  bool setAcceptanceIds(const uint32_t* ids, uint8_t count) override;
+  bool setAcceptance(const CanFilterConfig& cfg);
+  const CanFilterConfig& acceptance() const { return filter_; }
+  static constexpr uint8_t kFilters = 6;
+
+  // SPI traffic counters (bytes clocked / CS transactions)
+  uint32_t spiBytes() const { return spi_bytes_; }
+  uint32_t spiTransactions() const { return spi_transactions_; }
+  void resetStats() { spi_bytes_ = 0; spi_transactions_ = 0; }
+
+  // Register map / instruction set (subset)
+  enum : uint8_t {
+    INSTR_WRITE       = 0x02,
+    INSTR_READ        = 0x03,
+    INSTR_BIT_MODIFY  = 0x05,
+    INSTR_LOAD_TX     = 0x40,  // | 0x00 TXB0, 0x02 TXB1, 0x04 TXB2 (from SIDH)
+    INSTR_READ_RX     = 0x90,  // | 0x00 RXB0, 0x04 RXB1 (from SIDH)
+    INSTR_RTS         = 0x80,  // | bit n for TXBn
+    INSTR_READ_STATUS = 0xA0,
+    INSTR_RESET       = 0xC0,
+
+    REG_RXF0SIDH = 0x00,
+    REG_RXF3SIDH = 0x10,
+    REG_RXM0SIDH = 0x20,
+    REG_CANSTAT  = 0x0E,
+    REG_CANCTRL  = 0x0F,
+    REG_CNF3     = 0x28,
+    REG_CANINTE  = 0x2B,
+    REG_CANINTF  = 0x2C,
+    REG_TXB0CTRL = 0x30,
+    REG_RXB0CTRL = 0x60,
+    REG_RXB1CTRL = 0x70,
+
+    MODE_NORMAL = 0x00,
+    MODE_CONFIG = 0x80,
+    MODE_MASK   = 0xE0,
+  };
+
+  // Low-level helpers (also used by the receive path)
+  uint8_t readRegister(uint8_t addr);
+  void writeRegisters(uint8_t addr, const uint8_t* values, uint8_t len);
+  void modifyRegister(uint8_t addr, uint8_t mask, uint8_t value);
+  uint8_t readStatus();
+  bool setMode(uint8_t mode);
+
+  // Encode an identifier + DLC into the SIDH..DLC register layout
+  static void encodeHeader(const CanFrame& frame, uint8_t out[5]);
+  // Inverse of encodeHeader (fills id, extended and dlc)
+  static void decodeHeader(const uint8_t in[5], CanFrame* frame);
+
+protected:
+  void transaction(const uint8_t* tx, uint8_t* rx, size_t len);
+  // Load queued frames behind the pending buffers in `status`; returns
+  // the TXREQ bits now set
+  uint8_t loadTx(uint8_t status);
+
+  SpiBus& bus_;
+  CanFilterConfig filter_ = {{0, 0}, {0, 0, 0, 0, 0, 0}, 0x800, true};
+  uint32_t spi_bytes_ = 0;
+  uint32_t spi_transactions_ = 0;
+  RingBuffer<CanFrame, kTxQueue> tx_queue_;
+};
@@ -0,0 +1,88 @@
+#include "scheduler.h"
+
+int Scheduler::add(const char* name, TaskFn fn, uint8_t priority,
+                   uint32_t period_us, uint32_t deadline_us) {
+  if (count_ >= kMaxTasks || !fn) return -1;
+
+  // Insertion sort keeps the pass order fixed: priority, then registration
+  uint8_t pos = count_;
+  while (pos > 0 && tasks_[pos - 1].priority > priority) {
+    tasks_[pos] = tasks_[pos - 1];
+    pos--;
+  }
+  Task& t = tasks_[pos];
+  t.name = name;
+  t.fn = fn;
+  t.priority = priority;
+  t.period_us = period_us;
+  t.deadline_us = deadline_us ? deadline_us : period_us;
+  t.release_us = now_();
+  t.runs = 0;
+  t.max_us = 0;
+  t.total_us = 0;
+  t.late = 0;
+  t.max_lag_us = 0;
+  count_++;
+  return pos;
+}
+
+void Scheduler::runOnce() {
+  const uint32_t pass_start = now_();
+  uint32_t now = pass_start;
+
+  for (uint8_t i = 0; i < count_; i++) {
+    Task& t = tasks_[i];
+    if (t.period_us) {
+      const uint32_t lag = now - t.release_us;
+      // Wrap-safe "not yet released"
+      if ((int32_t)lag < 0) continue;
+      if (lag > t.max_lag_us) t.max_lag_us = lag;
+      if (lag > t.deadline_us) t.late++;
+      // Next release stays on the period grid unless we fell a whole
+      // period behind, in which case skip ahead instead of bursting
+      t.release_us += t.period_us;
+      if ((int32_t)(now - t.release_us) >= 0) t.release_us = now + t.period_us;
+    }
+
+    t.fn();
+    const uint32_t end = now_();
+    const uint32_t took = end - now;
+    t.runs++;
+    t.total_us += took;
+    if (took > t.max_us) t.max_us = took;
+    now = end;
+  }
+
+  const uint32_t pass_us = now - pass_start;
+  passes_++;
+  pass_total_us_ += pass_us;
+  if (pass_us > max_pass_us_) max_pass_us_ = pass_us;
+}
+
+bool Scheduler::stats(uint8_t index, TaskStats* out) const {
+  if (index >= count_) return false;
+  const Task& t = tasks_[index];
+  out->name = t.name;
+  out->priority = t.priority;
+  out->period_us = t.period_us;
+  out->runs = t.runs;
+  out->max_us = t.max_us;
+  out->avg_us = t.runs ? (uint32_t)(t.total_us / t.runs) : 0;
+  out->late = t.late;
+  out->max_lag_us = t.max_lag_us;
+  return true;
+}
+
+void Scheduler::resetStats() {
+  for (uint8_t i = 0; i < count_; i++) {
+    Task& t = tasks_[i];
+    t.runs = 0;
+    t.max_us = 0;
+    t.total_us = 0;
+    t.late = 0;
+    t.max_lag_us = 0;
+  }
+  passes_ = 0;
+  max_pass_us_ = 0;
+  pass_total_us_ = 0;
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// Cooperative run-to-completion scheduler for the main loop.
+//
+// Tasks run in priority order (0 = highest) on each pass. A task with
+// period 0 is polled every pass; otherwise it is released every
+// `period_us` and counts a deadline miss when it starts more than
+// `deadline_us` after its release. Every run is timed so "sched" can show
+// which task eats the loop budget.
+class Scheduler {
+public:
+  typedef void (*TaskFn)();
+  typedef uint32_t (*ClockFn)();
+
+  static const uint8_t kMaxTasks = 12;
+
+  struct TaskStats {
+    const char* name;
+    uint8_t priority;
+    uint32_t period_us;
+    uint32_t runs;
+    uint32_t max_us;
+    uint32_t avg_us;
+    uint32_t late;        // started after release + deadline
+    uint32_t max_lag_us;  // worst release -> start delay
+  };
+
+  explicit Scheduler(ClockFn now_us) : now_(now_us) {}
+
+  // Returns the task index, or -1 when the table is full. Tasks of equal
+  // priority keep their registration order.
+  int add(const char* name, TaskFn fn, uint8_t priority,
+          uint32_t period_us = 0, uint32_t deadline_us = 0);
+
+  // One loop pass: run every ready task once, highest priority first
+  void runOnce();
+
+  uint8_t taskCount() const { return count_; }
+  bool stats(uint8_t index, TaskStats* out) const;
+  // Whole-pass timing
+  uint32_t passes() const { return passes_; }
+  uint32_t maxPassUs() const { return max_pass_us_; }
+  uint32_t avgPassUs() const { return passes_ ? (uint32_t)(pass_total_us_ / passes_) : 0; }
+  void resetStats();
+
+private:
+  struct Task {
+    const char* name;
+    TaskFn fn;
+    uint8_t priority;
+    uint32_t period_us;
+    uint32_t deadline_us;
+    uint32_t release_us;
+    uint32_t runs;
+    uint32_t max_us;
+    uint64_t total_us;
+    uint32_t late;
+    uint32_t max_lag_us;
+  };
+
+  ClockFn now_;
+  Task tasks_[kMaxTasks];
+  uint8_t count_ = 0;
+  uint32_t passes_ = 0;
+  uint32_t max_pass_us_ = 0;
+  uint64_t pass_total_us_ = 0;
+};
@@ -0,0 +1,183 @@
+#include "slcan.h"
+#include <string.h>
+
+static const uint32_t kBitrates[] = {
+  10000, 20000, 50000, 100000, 125000, 250000, 500000, 800000, 1000000,
+};
+static const char kHex[] = "0123456789ABCDEF";
+
+static int hexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  return -1;
+}
+
+static bool parseHex(const char* s, size_t digits, uint32_t* value) {
+  uint32_t v = 0;
+  for (size_t i = 0; i < digits; i++) {
+    const int h = hexValue(s[i]);
+    if (h < 0) return false;
+    v = (v << 4) | (uint32_t)h;
+  }
+  *value = v;
+  return true;
+}
+
+size_t Slcan::encodeFrame(const CanFrame& frame, bool timestamp,
+                          uint16_t timestamp_ms, char* out) {
+  char* p = out;
+  const int id_digits = frame.extended ? 8 : 3;
+  *p++ = frame.extended ? 'T' : 't';
+  for (int i = id_digits - 1; i >= 0; i--) *p++ = kHex[(frame.id >> (4 * i)) & 0xF];
+  const uint8_t dlc = frame.dlc > 8 ? 8 : frame.dlc;
+  *p++ = (char)('0' + dlc);
+  for (uint8_t i = 0; i < dlc; i++) {
+    *p++ = kHex[frame.data[i] >> 4];
+    *p++ = kHex[frame.data[i] & 0xF];
+  }
+  if (timestamp) {
+    for (int i = 3; i >= 0; i--) *p++ = kHex[(timestamp_ms >> (4 * i)) & 0xF];
+  }
+  *p++ = '\r';
+  return (size_t)(p - out);
+}
+
+bool Slcan::decodeFrame(const char* cmd, size_t len, CanFrame* frame) {
+  if (len < 1) return false;
+  const bool ext = cmd[0] == 'T';
+  if (!ext && cmd[0] != 't') return false;
+  const size_t id_digits = ext ? 8 : 3;
+  if (len < 1 + id_digits + 1) return false;
+
+  uint32_t id, dlc;
+  if (!parseHex(cmd + 1, id_digits, &id)) return false;
+  if (!parseHex(cmd + 1 + id_digits, 1, &dlc) || dlc > 8) return false;
+  if (id > (ext ? 0x1FFFFFFFu : 0x7FFu)) return false;
+  if (len != 1 + id_digits + 1 + 2 * dlc) return false;
+
+  frame->id = id;
+  frame->extended = ext;
+  frame->dlc = (uint8_t)dlc;
+  memset(frame->data, 0, sizeof(frame->data));
+  const char* d = cmd + 1 + id_digits + 1;
+  for (uint32_t i = 0; i < dlc; i++) {
+    uint32_t byte;
+    if (!parseHex(d + 2 * i, 2, &byte)) return false;
+    frame->data[i] = (uint8_t)byte;
+  }
+  return true;
+}
+
+void Slcan::reply(const char* text, size_t len) {
+  if (out_len_ + len > sizeof(out_)) {
+    overruns_++;
+    return;
+  }
+  memcpy(out_ + out_len_, text, len);
+  out_len_ += len;
+}
+
+void Slcan::consume(size_t n) {
+  if (n >= out_len_) {
+    out_len_ = 0;
+    return;
+  }
+  memmove(out_, out_ + n, out_len_ - n);
+  out_len_ -= n;
+}
+
+void Slcan::onReceive(const CanFrame& frame, uint32_t timestamp_ms) {
+  if (!open_) return;
+  if (out_len_ + kMaxFrameText > sizeof(out_)) {
+    overruns_++;
+    return;
+  }
+  // slcan timestamps wrap at 60 s
+  out_len_ += encodeFrame(frame, timestamps_, (uint16_t)(timestamp_ms % 60000),
+                          (char*)out_ + out_len_);
+}
+
+void Slcan::onDisconnect() {
+  if (open_) filter_.close();
+  open_ = false;
+  listen_only_ = false;
+  cmd_len_ = 0;
+  out_len_ = 0;
+}
+
+void Slcan::feed(const uint8_t* data, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    const char c = (char)data[i];
+    if (c == '\r' || c == '\n') {
+      if (cmd_len_) handle(cmd_, cmd_len_);
+      cmd_len_ = 0;
+    } else if (cmd_len_ < sizeof(cmd_)) {
+      cmd_[cmd_len_++] = c;
+    }
+  }
+}
+
+void Slcan::handle(const char* cmd, size_t len) {
+  if (len > sizeof(cmd_) - 1) {
+    error();
+    return;
+  }
+  switch (cmd[0]) {
+    case 'S':
+      if (open_ || len != 2 || cmd[1] < '0' || cmd[1] > '8') { error(); return; }
+      // Only the rate the gateway already runs the bus at
+      if (kBitrates[cmd[1] - '0'] != bitrate_) { error(); return; }
+      ok();
+      return;
+    case 'O':
+    case 'L':
+      if (open_) { error(); return; }
+      // The host expects every frame, as with a plain adapter
+      if (!filter_.open()) { error(); return; }
+      open_ = true;
+      // The controller stays in normal mode for the gateway; listen-only
+      // is the adapter refusing to transmit
+      listen_only_ = cmd[0] == 'L';
+      overruns_ = 0;
+      ok();
+      return;
+    case 'C':
+      if (open_) filter_.close();
+      open_ = false;
+      listen_only_ = false;
+      ok();
+      return;
+    case 't':
+    case 'T': {
+      CanFrame frame;
+      if (!open_ || listen_only_ || !decodeFrame(cmd, len, &frame) || !can_.send(frame)) {
+        error();
+        return;
+      }
+      reply(cmd[0] == 'T' ? "Z\r" : "z\r", 2);
+      return;
+    }
+    case 'Z':
+      if (len != 2 || (cmd[1] != '0' && cmd[1] != '1')) { error(); return; }
+      timestamps_ = cmd[1] == '1';
+      ok();
+      return;
+    case 'V':
+      reply("V1013\r", 6);
+      return;
+    case 'N':
+      reply("NPICO\r", 6);
+      return;
+    case 'F': {
+      // Bit 0: RX queue full, cleared on read
+      const char flags[4] = {'F', '0', overruns_ ? '1' : '0', '\r'};
+      overruns_ = 0;
+      reply(flags, sizeof(flags));
+      return;
+    }
+    default:
+      error();
+      return;
+  }
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include "can_rx_filter.h"
+#include "can_transport.h"
+
+// slcan / Lawicel ASCII protocol, so `slcand` can turn the Pico's CDC port
+// into a SocketCAN interface:
+//
+//   Sn  bitrate (0:10k 1:20k 2:50k 3:100k 4:125k 5:250k 6:500k 7:800k 8:1M)
+//   O / L / C   open / open listen-only (t/T refused) / close
+//   tiiildd..  Tiiiiiiiildd..  transmit standard / extended
+//   Zn  timestamps off/on, V / N / F  version / serial / status
+//
+// Commands end with CR; replies are CR (ok) or BEL (error). Received
+// frames are encoded into an output buffer that the caller drains with
+// one USB write per loop pass. While open, the shared acceptance filter
+// passes every frame; the gateway's ID list is restored on close or when
+// the port goes away without one.
+class Slcan {
+public:
+  // `bitrate` is what the gateway runs the bus at. The controller is
+  // shared, so Sn for any other rate is refused (BEL) instead of
+  // re-initialising it under the gateway.
+  Slcan(CanTransport& can, CanRxFilter& filter, uint32_t bitrate)
+    : can_(can), filter_(filter), bitrate_(bitrate) {}
+
+  // Feed bytes from the CDC port
+  void feed(const uint8_t* data, size_t len);
+  // Queue a received frame for the host (ignored while closed)
+  void onReceive(const CanFrame& frame, uint32_t timestamp_ms);
+  // The host closed the port (DTR dropped) without 'C': close the
+  // session and drop any half-received command and pending output
+  void onDisconnect();
+
+  bool isOpen() const { return open_; }
+  bool listenOnly() const { return listen_only_; }
+  uint32_t bitrate() const { return bitrate_; }
+
+  // Pending output for the host
+  const uint8_t* output() const { return out_; }
+  size_t outputLength() const { return out_len_; }
+  void consume(size_t n);
+
+  // Frames that did not fit in the output buffer since the last 'F'
+  uint32_t overruns() const { return overruns_; }
+
+  // Encode "tiiildd..[tttt]\r" / "Tiiiiiiiildd..[tttt]\r"; returns length.
+  static size_t encodeFrame(const CanFrame& frame, bool timestamp,
+                            uint16_t timestamp_ms, char* out);
+  // Decode a t/T command (without CR); false on malformed input.
+  static bool decodeFrame(const char* cmd, size_t len, CanFrame* frame);
+
+  static const size_t kMaxFrameText = 1 + 8 + 1 + 16 + 4 + 1;
+
+private:
+  void handle(const char* cmd, size_t len);
+  void reply(const char* text, size_t len);
+  void ok() { reply("\r", 1); }
+  void error() { reply("\a", 1); }
+
+  CanTransport& can_;
+  CanRxFilter& filter_;
+  bool open_ = false;
+  bool listen_only_ = false;
+  bool timestamps_ = false;
+  const uint32_t bitrate_;
+  uint32_t overruns_ = 0;
+
+  char cmd_[32];
+  size_t cmd_len_ = 0;
+
+  uint8_t out_[512];
+  size_t out_len_ = 0;
+};
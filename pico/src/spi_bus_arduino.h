@@ -0,0 +1,36 @@
+#pragma once
+#include <Arduino.h>
+#include <SPI.h>
+#include "mcp2515.h"
+
+// SpiBus on top of the Arduino SPIClass; the transaction (clock, mode)
+// is held only while CS is asserted.
+class ArduinoSpiBus : public SpiBus {
+public:
+  ArduinoSpiBus(SPIClass& spi, int cs_pin, uint32_t hz = Mcp2515::kMaxSpiHz)
+    : spi_(spi), cs_(cs_pin), settings_(hz, MSBFIRST, SPI_MODE0) {}
+
+  void begin() {
+    pinMode(cs_, OUTPUT);
+    digitalWrite(cs_, HIGH);
+  }
+
+  void select() override {
+    spi_.beginTransaction(settings_);
+    digitalWrite(cs_, LOW);
+  }
+
+  void deselect() override {
+    digitalWrite(cs_, HIGH);
+    spi_.endTransaction();
+  }
+
+  void transfer(const uint8_t* tx, uint8_t* rx, size_t len) override {
+    spi_.transfer(tx, rx, len);
+  }
+
+private:
+  SPIClass& spi_;
+  int cs_;
+  SPISettings settings_;
+};
@@ -0,0 +1,62 @@
+#include "usb_frame.h"
+#include <string.h>
+
+uint8_t usbFrameCrc8(const uint8_t* data, size_t len, uint8_t crc) {
+  for (size_t i = 0; i < len; i++) {
+    crc ^= data[i];
+    for (int b = 0; b < 8; b++) {
+      crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+size_t usbFrameEncode(uint8_t type, const uint8_t* payload, uint8_t len, uint8_t* out) {
+  out[0] = USB_FRAME_SYNC;
+  out[1] = type;
+  out[2] = len;
+  if (len) memcpy(out + 3, payload, len);
+  out[3 + len] = usbFrameCrc8(out + 1, 2 + (size_t)len);
+  return (size_t)len + USB_FRAME_OVERHEAD;
+}
+
+void usbFrameDecoderInit(UsbFrameDecoder* d) {
+  d->have = 0;
+  d->replay_pos = 0;
+  d->replay_len = 0;
+}
+
+UsbFrameEvent usbFrameDecode(UsbFrameDecoder* d, uint8_t b) {
+  if (d->have == 0) {
+    if (b != USB_FRAME_SYNC) return USB_DEC_BYTE;
+    d->frame[d->have++] = b;
+    return USB_DEC_PENDING;
+  }
+  d->frame[d->have++] = b;
+  if (d->have < 3 || d->have < (size_t)d->frame[2] + USB_FRAME_OVERHEAD) return USB_DEC_PENDING;
+
+  const size_t len = d->frame[2];
+  const size_t have = d->have;
+  d->have = 0;
+  if (usbFrameCrc8(d->frame + 1, 2 + len) == d->frame[3 + len]) return USB_DEC_FRAME;
+
+  // Resynchronise: everything after the false sync byte is decoded again.
+  // Those bytes are the ones just before the unread part of the replay
+  // buffer, so a frame that started inside it only moves the read
+  // position back.
+  const size_t back = have - 1;
+  if (d->replay_pos < d->replay_len) {
+    d->replay_pos -= back;
+  } else {
+    memcpy(d->replay, d->frame + 1, back);
+    d->replay_pos = 0;
+    d->replay_len = back;
+  }
+  return USB_DEC_BAD_CRC;
+}
+
+bool usbFrameReplay(UsbFrameDecoder* d, uint8_t* b) {
+  if (d->replay_pos >= d->replay_len) return false;
+  *b = d->replay[d->replay_pos++];
+  return true;
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// Binary frames on the WebUSB stream, interleaved with the text lines
+// (PONG, ACK, ...):
+//
+//   [0xA5][type][len][payload: len bytes][crc8]
+//
+// The sync byte can still turn up outside a frame: the STM32's UART
+// output is forwarded as raw bytes, so line noise or a stray 0xA5 looks
+// like a frame start. The decoder then drops a frame with a bad CRC and
+// rescans the bytes after the false sync (see usbFrameReplay).
+//
+// crc8 (poly 0x07, init 0) covers type, len and payload. Multi-byte
+// payload fields are little-endian.
+static const uint8_t USB_FRAME_SYNC = 0xA5;
+static const size_t  USB_FRAME_OVERHEAD = 4;
+static const size_t  USB_FRAME_MAX_PAYLOAD = 255;
+
+enum UsbFrameType : uint8_t {
+  // Device -> browser
+  USB_FRAME_CAN_RX = 0x01,  // u8 count, count x CanRxRecord
+  // Device -> host debug CDC
+  USB_FRAME_LOG    = 0x10,  // LogRecord (see log.h)
+};
+
+// One received CAN frame inside USB_FRAME_CAN_RX (17 bytes):
+//   u32 timestamp_us, u32 id (bit 31: extended), u8 dlc, u8 data[8]
+static const size_t USB_CAN_RX_RECORD_SIZE = 17;
+static const size_t USB_CAN_RX_MAX_RECORDS =
+    (USB_FRAME_MAX_PAYLOAD - 1) / USB_CAN_RX_RECORD_SIZE;
+
+uint8_t usbFrameCrc8(const uint8_t* data, size_t len, uint8_t crc = 0);
+
+// Wrap a payload; `out` needs len + USB_FRAME_OVERHEAD bytes.
+// Returns the encoded size.
+size_t usbFrameEncode(uint8_t type, const uint8_t* payload, uint8_t len, uint8_t* out);
+
+// Incremental frame splitter for a stream that mixes frames with other
+// bytes; frames may be cut at any read boundary. Feed one byte at a time:
+//   USB_DEC_BYTE      not part of a frame, the caller keeps it
+//   USB_DEC_PENDING   consumed into a frame still being received
+//   USB_DEC_FRAME     frame complete and CRC good: type frame[1], length
+//                     frame[2], payload at frame + 3
+//   USB_DEC_BAD_CRC   frame complete but dropped
+// After each byte, the caller feeds whatever usbFrameReplay hands back
+// before the next byte of the stream:
+//
+//   handle(usbFrameDecode(d, b), b);
+//   while (usbFrameReplay(d, &r)) handle(usbFrameDecode(d, r), r);
+enum UsbFrameEvent : uint8_t {
+  USB_DEC_BYTE, USB_DEC_PENDING, USB_DEC_FRAME, USB_DEC_BAD_CRC,
+};
+
+struct UsbFrameDecoder {
+  uint8_t frame[USB_FRAME_MAX_PAYLOAD + USB_FRAME_OVERHEAD];
+  size_t have;  // bytes collected, 0 = not inside a frame
+  // Bytes after the sync of a frame that failed its CRC, to be decoded
+  // again: text, or the start of the real frame
+  uint8_t replay[USB_FRAME_MAX_PAYLOAD + USB_FRAME_OVERHEAD];
+  size_t replay_pos, replay_len;
+};
+
+void usbFrameDecoderInit(UsbFrameDecoder* d);
+UsbFrameEvent usbFrameDecode(UsbFrameDecoder* d, uint8_t b);
+// Next byte to decode again after a bad CRC; false when there is none
+bool usbFrameReplay(UsbFrameDecoder* d, uint8_t* b);
+
+static inline void putLe32(uint8_t* p, uint32_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+  p[2] = (uint8_t)(v >> 16);
+  p[3] = (uint8_t)(v >> 24);
+}
+
+static inline uint32_t getLe32(const uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
@@ -0,0 +1,153 @@
+#ifdef USB_GS_USB
+#include <Arduino.h>
+#include <string.h>
+#include "device/usbd_pvt.h"
+#include "usb_gs_device.h"
+
+// Adafruit TinyUSB only hosts its own class drivers, so gs_usb registers
+// an application driver (usbd_app_driver_get_cb) for its interface.
+
+static GsUsb* proto = nullptr;
+static uint8_t itf_num = 0xFF;
+static uint8_t ep_in = 0, ep_out = 0;
+static bool in_busy = false;
+static bool out_armed = false;
+
+static uint8_t out_buf[GsUsb::kFrameSizeTimestamp];
+static uint8_t in_buf[GsUsb::kFrameSizeTimestamp];
+static uint8_t ctrl_buf[64];
+
+static const uint16_t kBulkSize = 64;
+static const uint16_t kDescLen = TUD_VENDOR_DESC_LEN;
+
+bool UsbGsDevice::begin() {
+  proto = &proto_;
+  return TinyUSBDevice.addInterface(*this);
+}
+
+uint16_t UsbGsDevice::getInterfaceDescriptor(uint8_t itfnum_deprecated, uint8_t* buf,
+                                             uint16_t bufsize) {
+  (void)itfnum_deprecated;
+  if (!buf) return kDescLen;
+  if (bufsize < kDescLen) return 0;
+
+  itf_num = TinyUSBDevice.allocInterface(1);
+  ep_in = TinyUSBDevice.allocEndpoint(TUSB_DIR_IN);
+  ep_out = TinyUSBDevice.allocEndpoint(TUSB_DIR_OUT);
+  const uint8_t desc[] = {TUD_VENDOR_DESCRIPTOR(itf_num, 0, ep_out, ep_in, kBulkSize)};
+  memcpy(buf, desc, sizeof(desc));
+  return sizeof(desc);
+}
+
+// Only armed while the TX queue has room: the host is NAKed instead of
+// a frame being dropped without its echo
+static void armOut(uint8_t rhport) {
+  if (out_armed || !proto || !proto->txReady()) return;
+  out_armed = usbd_edpt_xfer(rhport, ep_out, out_buf, sizeof(out_buf));
+}
+
+static bool sendNext(uint8_t rhport) {
+  if (in_busy || !proto || !tud_mounted()) return false;
+  const size_t n = proto->nextInFrame(in_buf);
+  if (n == 0) return false;
+  if (!usbd_edpt_claim(rhport, ep_in)) return false;
+  in_busy = true;
+  if (!usbd_edpt_xfer(rhport, ep_in, in_buf, (uint16_t)n)) {
+    in_busy = false;
+    usbd_edpt_release(rhport, ep_in);
+    return false;
+  }
+  return true;
+}
+
+void UsbGsDevice::task() {
+  proto_.service(micros());
+  if (tud_mounted() && ep_out) armOut(0);
+  sendNext(0);
+}
+
+// ---- TinyUSB application class driver ----
+
+static void gsd_init(void) {
+  in_busy = false;
+  out_armed = false;
+}
+
+static void gsd_reset(uint8_t rhport) {
+  (void)rhport;
+  in_busy = false;
+  out_armed = false;
+}
+
+static uint16_t gsd_open(uint8_t rhport, tusb_desc_interface_t const* desc, uint16_t max_len) {
+  if (desc->bInterfaceNumber != itf_num || desc->bInterfaceClass != TUSB_CLASS_VENDOR_SPECIFIC) {
+    return 0;
+  }
+  const uint16_t len = sizeof(tusb_desc_interface_t) + 2 * sizeof(tusb_desc_endpoint_t);
+  if (max_len < len) return 0;
+
+  const uint8_t* p = tu_desc_next(desc);
+  uint8_t out_addr = 0, in_addr = 0;
+  TU_ASSERT(usbd_open_edpt_pair(rhport, p, 2, TUSB_XFER_BULK, &out_addr, &in_addr), 0);
+  armOut(rhport);
+  return len;
+}
+
+static bool gsd_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t const* request) {
+  if (request->bmRequestType_bit.type != TUSB_REQ_TYPE_VENDOR || !proto) return false;
+
+  if (request->bmRequestType_bit.direction == TUSB_DIR_IN) {
+    if (stage != CONTROL_STAGE_SETUP) return true;
+    const int n = proto->controlIn(request->bRequest, ctrl_buf,
+                                   tu_min16(request->wLength, sizeof(ctrl_buf)), micros());
+    if (n < 0) return false;
+    return tud_control_xfer(rhport, request, ctrl_buf, (uint16_t)n);
+  }
+
+  if (stage == CONTROL_STAGE_SETUP) {
+    if (request->wLength > sizeof(ctrl_buf)) return false;
+    return tud_control_xfer(rhport, request, ctrl_buf, request->wLength);
+  }
+  if (stage == CONTROL_STAGE_DATA) {
+    return proto->controlOut(request->bRequest, ctrl_buf, request->wLength);
+  }
+  return true;
+}
+
+static bool gsd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes) {
+  (void)result;
+  if (ep_addr == ep_out) {
+    // Accepted frames are echoed once sent; only short frames (no echo
+    // id) or frames while stopped are dropped
+    out_armed = false;
+    if (proto) proto->onHostFrame(out_buf, xferred_bytes, micros());
+    armOut(rhport);
+    sendNext(rhport);
+    return true;
+  }
+  if (ep_addr == ep_in) {
+    in_busy = false;
+    sendNext(rhport);
+    return true;
+  }
+  return false;
+}
+
+static usbd_class_driver_t const gs_driver = {
+#if CFG_TUSB_DEBUG >= 2
+  .name = "GS_USB",
+#endif
+  .init = gsd_init,
+  .reset = gsd_reset,
+  .open = gsd_open,
+  .control_xfer_cb = gsd_control_xfer_cb,
+  .xfer_cb = gsd_xfer_cb,
+  .sof = NULL,
+};
+
+extern "C" usbd_class_driver_t const* usbd_app_driver_get_cb(uint8_t* driver_count) {
+  *driver_count = 1;
+  return &gs_driver;
+}
+
+#endif // USB_GS_USB
@@ -0,0 +1,25 @@
+#pragma once
+#ifdef USB_GS_USB
+#include "Adafruit_TinyUSB.h"
+#include "gs_usb.h"
+
+// gs_usb vendor interface (one bulk IN/OUT pair) for Adafruit TinyUSB.
+// Linux's gs_usb driver binds to interface 0 of 1d50:606f, so this must
+// be the first interface added.
+class UsbGsDevice : public Adafruit_USBD_Interface {
+public:
+  explicit UsbGsDevice(GsUsb& proto) : proto_(proto) {}
+
+  bool begin();
+  // Retry queued host frames, re-arm bulk OUT once there is room, and
+  // push queued echoes / RX frames to the IN endpoint
+  void task();
+
+  uint16_t getInterfaceDescriptor(uint8_t itfnum_deprecated, uint8_t* buf,
+                                  uint16_t bufsize) override;
+
+private:
+  GsUsb& proto_;
+};
+
+#endif // USB_GS_USB
@@ -0,0 +1,94 @@
+// canFilterOptimize: the cover always contains the requested IDs, the
+// reported `accepted` count matches the configuration, and lists the
+// MCP2515 filters cannot express are refused.
+#include <unity.h>
+#include <random>
+#include "can_filter.h"
+
+void setUp() {}
+void tearDown() {}
+
+static uint32_t countAccepted(const CanFilterConfig& cfg) {
+  uint32_t n = 0;
+  for (uint16_t id = 0; id < 0x800; id++) {
+    if (canFilterAccepts(cfg, id)) n++;
+  }
+  return n;
+}
+
+static void checkCover(const uint32_t* ids, size_t count) {
+  CanFilterConfig cfg;
+  TEST_ASSERT_TRUE(canFilterOptimize(ids, count, &cfg));
+  TEST_ASSERT_FALSE(cfg.accept_all);
+  for (size_t i = 0; i < count; i++) TEST_ASSERT_TRUE(canFilterAccepts(cfg, (uint16_t)ids[i]));
+  TEST_ASSERT_EQUAL_UINT32(countAccepted(cfg), cfg.accepted);
+  TEST_ASSERT_GREATER_OR_EQUAL(1, cfg.accepted);
+}
+
+static void test_up_to_six_ids_are_exact() {
+  const uint32_t ids[] = {0x501, 0x502, 0x503, 0x504, 0x000, 0x7FF};
+  for (size_t n = 1; n <= 6; n++) {
+    CanFilterConfig cfg;
+    TEST_ASSERT_TRUE(canFilterOptimize(ids, n, &cfg));
+    TEST_ASSERT_EQUAL_UINT16(n, cfg.accepted);
+    checkCover(ids, n);
+  }
+}
+
+static void test_duplicates_count_once() {
+  const uint32_t ids[] = {0x100, 0x100, 0x200, 0x100};
+  CanFilterConfig cfg;
+  TEST_ASSERT_TRUE(canFilterOptimize(ids, 4, &cfg));
+  TEST_ASSERT_EQUAL_UINT16(2, cfg.accepted);
+}
+
+static void test_random_sets_up_to_32_ids() {
+  std::mt19937 rng(7);
+  uint32_t ids[32];
+  for (int round = 0; round < 300; round++) {
+    const size_t n = 1 + rng() % 32;
+    // Clustered sets (a node's ID block) and scattered ones
+    const uint32_t base = rng() & 0x7FF;
+    const bool clustered = rng() & 1;
+    for (size_t i = 0; i < n; i++) {
+      ids[i] = clustered ? ((base + rng() % 64) & 0x7FF) : (rng() & 0x7FF);
+    }
+    checkCover(ids, n);
+  }
+}
+
+static void test_contiguous_block_is_tight() {
+  // 0x500..0x50F: one mask clearing the low four bits covers it exactly
+  uint32_t ids[16];
+  for (uint32_t i = 0; i < 16; i++) ids[i] = 0x500 + i;
+  CanFilterConfig cfg;
+  TEST_ASSERT_TRUE(canFilterOptimize(ids, 16, &cfg));
+  TEST_ASSERT_EQUAL_UINT16(16, cfg.accepted);
+}
+
+static void test_unsupported_lists_fail() {
+  CanFilterConfig cfg;
+  uint32_t ids[33];
+  for (uint32_t i = 0; i < 33; i++) ids[i] = i;
+
+  TEST_ASSERT_FALSE(canFilterOptimize(ids, 0, &cfg));
+  TEST_ASSERT_TRUE(cfg.accept_all);
+  TEST_ASSERT_FALSE(canFilterOptimize(ids, 33, &cfg));
+  TEST_ASSERT_TRUE(cfg.accept_all);
+  TEST_ASSERT_TRUE(canFilterOptimize(ids, 32, &cfg));
+
+  const uint32_t extended[] = {0x501, 0x800};
+  TEST_ASSERT_FALSE(canFilterOptimize(extended, 2, &cfg));
+  TEST_ASSERT_TRUE(cfg.accept_all);
+  TEST_ASSERT_EQUAL_UINT16(0x800, cfg.accepted);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_up_to_six_ids_are_exact);
+  RUN_TEST(test_duplicates_count_once);
+  RUN_TEST(test_random_sets_up_to_32_ids);
+  RUN_TEST(test_contiguous_block_is_tight);
+  RUN_TEST(test_unsupported_lists_fail);
+  return UNITY_END();
+}
@@ -0,0 +1,107 @@
+// canEncodeBits / canDecodeBits: random frames survive the round trip,
+// stay within kCanMaxFrameBits and obey the stuff rule; damaged bit
+// streams are rejected.
+#include <unity.h>
+#include <string.h>
+#include <random>
+#include "can_wire.h"
+
+void setUp() {}
+void tearDown() {}
+
+static const int kFrames = 100000;
+
+static CanFrame randomFrame(std::mt19937& rng) {
+  CanFrame f;
+  f.extended = rng() & 1;
+  f.id = rng() & (f.extended ? 0x1FFFFFFF : 0x7FF);
+  f.dlc = (uint8_t)(rng() % 9);
+  for (uint8_t& b : f.data) b = 0;
+  // Mostly random payloads, plus all-equal ones that stuff every 5 bits
+  const uint32_t kind = rng() % 4;
+  for (uint8_t i = 0; i < f.dlc; i++) {
+    f.data[i] = kind == 0 ? 0x00 : kind == 1 ? 0xFF : (uint8_t)rng();
+  }
+  return f;
+}
+
+static void test_round_trip_random_frames() {
+  std::mt19937 rng(1);
+  uint8_t bits[kCanMaxFrameBits];
+  size_t longest = 0;
+  for (int i = 0; i < kFrames; i++) {
+    const CanFrame f = randomFrame(rng);
+    const size_t n = canEncodeBits(f, bits, sizeof(bits));
+    TEST_ASSERT_GREATER_THAN(0, n);
+    if (n > longest) longest = n;
+
+    // Never six equal bits before the fixed-form tail
+    int run = 0;
+    for (size_t k = 0; k + 13 < n; k++) {
+      run = (k > 0 && bits[k] == bits[k - 1]) ? run + 1 : 1;
+      TEST_ASSERT_LESS_OR_EQUAL(5, run);
+    }
+
+    CanFrame out;
+    TEST_ASSERT_TRUE(canDecodeBits(bits, n, &out));
+    TEST_ASSERT_EQUAL_HEX32(f.id, out.id);
+    TEST_ASSERT_EQUAL(f.extended, out.extended);
+    TEST_ASSERT_EQUAL_UINT8(f.dlc, out.dlc);
+    TEST_ASSERT_EQUAL_MEMORY(f.data, out.data, f.dlc);
+  }
+  TEST_ASSERT_LESS_OR_EQUAL(kCanMaxFrameBits, longest);
+}
+
+static void test_unstuffed_lengths() {
+  // Standard 8-byte frame: 108 bits + 3 intermission before stuffing
+  CanFrame f = {0x555, 8, false, {0x55, 0xAA, 0x55, 0xAA, 0x55, 0xAA, 0x55, 0xAA}};
+  uint8_t bits[kCanMaxFrameBits];
+  const size_t n = canEncodeBits(f, bits, sizeof(bits));
+  TEST_ASSERT_GREATER_OR_EQUAL(111, n);
+  TEST_ASSERT_LESS_OR_EQUAL(111 + 24, n);
+  // 1 Mbps: one bit per microsecond
+  TEST_ASSERT_EQUAL_UINT32(n * 1000, canFrameWireTimeNs(f, 1000000));
+  TEST_ASSERT_EQUAL_UINT32(0, canFrameWireTimeNs(f, 0));
+  // Too small a buffer is refused, not overrun
+  TEST_ASSERT_EQUAL(0, canEncodeBits(f, bits, n - 1));
+}
+
+static void test_stuff_and_crc_errors_are_rejected() {
+  std::mt19937 rng(2);
+  uint8_t bits[kCanMaxFrameBits];
+  unsigned flipped = 0, accepted = 0;
+  for (int i = 0; i < kFrames / 10; i++) {
+    const CanFrame f = randomFrame(rng);
+    const size_t n = canEncodeBits(f, bits, sizeof(bits));
+    // Flip one bit between SOF and the CRC delimiter
+    const size_t k = rng() % (n - 13);
+    bits[k] ^= 1;
+    CanFrame out;
+    flipped++;
+    if (canDecodeBits(bits, n, &out) &&
+        (out.id != f.id || out.dlc != f.dlc || memcmp(out.data, f.data, f.dlc))) {
+      accepted++;
+    }
+  }
+  // A single flipped bit is a CRC error, or a stuff error when it
+  // breaks or creates a run of five
+  TEST_ASSERT_EQUAL_UINT32(0, accepted);
+  TEST_ASSERT_EQUAL_UINT32(kFrames / 10, flipped);
+
+  // SOF must be dominant; truncated streams fail
+  const CanFrame f = {0x123, 2, false, {1, 2}};
+  size_t n = canEncodeBits(f, bits, sizeof(bits));
+  CanFrame out;
+  bits[0] = 1;
+  TEST_ASSERT_FALSE(canDecodeBits(bits, n, &out));
+  n = canEncodeBits(f, bits, sizeof(bits));
+  TEST_ASSERT_FALSE(canDecodeBits(bits, 30, &out));
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_round_trip_random_frames);
+  RUN_TEST(test_unstuffed_lengths);
+  RUN_TEST(test_stuff_and_crc_errors_are_rejected);
+  return UNITY_END();
+}
@@ -0,0 +1,71 @@
+// ClockSync: the offset estimate from ping exchanges, and the restart
+// when the host clock jumps to a new epoch (a browser reload).
+#include <unity.h>
+#include "clock_sync.h"
+
+void setUp() {}
+void tearDown() {}
+
+static const int64_t kOffsetUs = 7000000;  // device - host
+static const uint64_t kDelayUs = 400;      // round trip, split evenly
+static const uint64_t kHeldUs = 50;        // device t2 -> t3
+
+// One symmetric exchange starting at host time `t1`
+static bool exchange(ClockSync& cs, uint64_t t1, int64_t offset) {
+  const uint64_t t2 = t1 + offset + kDelayUs / 2;
+  const uint64_t t3 = t2 + kHeldUs;
+  const uint64_t t4 = t3 - offset + kDelayUs / 2;
+  return cs.addSample(t1, t2, t3, t4);
+}
+
+static void test_offset_from_exchanges() {
+  ClockSync cs;
+  TEST_ASSERT_FALSE(cs.valid());
+  for (int i = 0; i < 20; i++) TEST_ASSERT_TRUE(exchange(cs, 1000000 + i * 100000, kOffsetUs));
+  TEST_ASSERT_TRUE(cs.valid());
+  TEST_ASSERT_EQUAL_UINT32(kDelayUs, cs.lastDelayUs());
+  TEST_ASSERT_EQUAL_INT64(kOffsetUs, cs.offsetUs(3000000 + kOffsetUs));
+  TEST_ASSERT_EQUAL_UINT64(5000000 + kOffsetUs, cs.hostToDevice(5000000));
+  TEST_ASSERT_EQUAL_UINT32(0, cs.jumps());
+}
+
+static void test_inconsistent_exchange_is_rejected() {
+  ClockSync cs;
+  TEST_ASSERT_FALSE(cs.addSample(2000, 5000, 5100, 1000));  // t4 < t1
+  TEST_ASSERT_FALSE(cs.addSample(1000, 5000, 9000, 2000));  // held > round trip
+  TEST_ASSERT_FALSE(cs.valid());
+}
+
+static void test_host_epoch_change_restarts_estimate() {
+  ClockSync cs;
+  uint64_t host = 1000000;
+  for (int i = 0; i < 20; i++, host += 100000) exchange(cs, host, kOffsetUs);
+  // Reloaded page: host time starts again near zero while the device
+  // clock keeps counting, so the offset jumps by the old host time
+  const int64_t new_offset = kOffsetUs + (int64_t)host - 500;
+  TEST_ASSERT_TRUE(exchange(cs, 500, new_offset));
+  TEST_ASSERT_EQUAL_UINT32(1, cs.jumps());
+  TEST_ASSERT_EQUAL_UINT32(1, cs.samples());
+  TEST_ASSERT_EQUAL_INT64(new_offset, cs.offsetUs(500 + new_offset));
+  TEST_ASSERT_EQUAL_UINT64(100500 + new_offset, cs.hostToDevice(100500));
+}
+
+static void test_slow_exchange_is_not_a_jump() {
+  ClockSync cs;
+  uint64_t host = 1000000;
+  for (int i = 0; i < 20; i++, host += 100000) exchange(cs, host, kOffsetUs);
+  // 150 ms queued on the way back: within the delay/2 allowance
+  TEST_ASSERT_TRUE(cs.addSample(host, host + kOffsetUs, host + kOffsetUs + kHeldUs,
+                                host + kHeldUs + 150000));
+  TEST_ASSERT_EQUAL_UINT32(0, cs.jumps());
+  TEST_ASSERT_EQUAL_INT64(kOffsetUs, cs.offsetUs(host + kOffsetUs));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_offset_from_exchanges);
+  RUN_TEST(test_inconsistent_exchange_is_rejected);
+  RUN_TEST(test_host_epoch_change_restarts_estimate);
+  RUN_TEST(test_slow_exchange_is_not_a_jump);
+  return UNITY_END();
+}
@@ -0,0 +1,187 @@
+// Fixed-point filter kernels: the packed and scalar variants agree bit
+// for bit (rail inputs and accumulator wrap-around included), the
+// low-pass design passes DC and rejects the stopband, and the init and
+// "filt" parsers refuse what they cannot represent.
+#include <unity.h>
+#include <math.h>
+#include <string.h>
+#include "dsp_filter.h"
+#include "imu_filter.h"
+
+void setUp() {}
+void tearDown() {}
+
+static const int kSteps = 20000;
+
+// Deterministic xorshift so a failure reproduces
+static uint32_t rng_state;
+
+static uint32_t nextRandom() {
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 17;
+  rng_state ^= rng_state << 5;
+  return rng_state;
+}
+
+// Mostly the rails, so products and sums overflow, with random values between
+static int16_t railSample() {
+  switch (nextRandom() % 4) {
+    case 0: return INT16_MIN;
+    case 1: return INT16_MAX;
+    default: return (int16_t)nextRandom();
+  }
+}
+
+void test_dot_simd_matches_scalar() {
+  rng_state = 0x12345678;
+  int16_t a[64], b[64];
+  int mismatches = 0;
+  for (int k = 0; k < kSteps; k++) {
+    for (int i = 0; i < 64; i++) {
+      a[i] = railSample();
+      b[i] = railSample();
+    }
+    const uint16_t n = (uint16_t)(2 * (nextRandom() % 33));  // even, 0..64
+    const int32_t acc = (int32_t)nextRandom();
+    if (dspDotQ15Scalar(a, b, n, acc) != dspDotQ15Simd(a, b, n, acc)) mismatches++;
+  }
+  TEST_ASSERT_EQUAL_INT(0, mismatches);
+}
+
+void test_fir_simd_matches_scalar() {
+  rng_state = 0x9e3779b9;
+  int mismatches = 0;
+  for (uint8_t ntaps = 1; ntaps <= DSP_FIR_MAX_TAPS; ntaps++) {
+    int16_t taps[DSP_FIR_MAX_TAPS];
+    for (uint8_t i = 0; i < ntaps; i++) taps[i] = railSample();
+    FirQ15 scalar, simd;
+    TEST_ASSERT_TRUE(firQ15Init(&scalar, taps, ntaps));
+    TEST_ASSERT_TRUE(firQ15Init(&simd, taps, ntaps));
+    for (int k = 0; k < kSteps / 20; k++) {
+      const int16_t x = railSample();
+      if (firQ15StepScalar(&scalar, x) != firQ15StepSimd(&simd, x)) mismatches++;
+    }
+  }
+  TEST_ASSERT_EQUAL_INT(0, mismatches);
+}
+
+void test_biquad_q15_simd_matches_scalar() {
+  rng_state = 0xdeadbeef;
+  int mismatches = 0;
+  for (int run = 0; run < 20; run++) {
+    // Raw coefficients at the rails: no stable filter, but the two
+    // variants must still wrap and saturate the same way
+    BiquadQ15 scalar;
+    memset(&scalar, 0, sizeof(scalar));
+    scalar.b0 = railSample();
+    scalar.b1 = railSample();
+    scalar.b2 = railSample();
+    scalar.na1 = railSample();
+    scalar.na2 = railSample();
+    BiquadQ15 simd = scalar;
+    for (int k = 0; k < kSteps / 20; k++) {
+      const int16_t x = railSample();
+      if (biquadQ15StepScalar(&scalar, x) != biquadQ15StepSimd(&simd, x)) mismatches++;
+    }
+  }
+  TEST_ASSERT_EQUAL_INT(0, mismatches);
+}
+
+void test_design_lowpass() {
+  BiquadCoeffs c;
+  TEST_ASSERT_TRUE(dspDesignLowpass(10.0f, 100.0f, &c));
+  // Unity gain at DC: (b0 + b1 + b2) / (1 + a1 + a2)
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f, 1.0f, (c.b0 + c.b1 + c.b2) / (1.0f + c.a1 + c.a2));
+  // Zero at Nyquist: b0 - b1 + b2
+  TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.0f, c.b0 - c.b1 + c.b2);
+  TEST_ASSERT_EQUAL_FLOAT(c.b0, c.b2);
+
+  TEST_ASSERT_FALSE(dspDesignLowpass(0.0f, 100.0f, &c));
+  TEST_ASSERT_FALSE(dspDesignLowpass(-1.0f, 100.0f, &c));
+  TEST_ASSERT_FALSE(dspDesignLowpass(50.0f, 100.0f, &c));
+  TEST_ASSERT_FALSE(dspDesignLowpass(NAN, 100.0f, &c));
+}
+
+// Peak output of a Q31 low-pass driven by a tone at `cycles` per sample,
+// once the start-up transient (~0.3 s at the 0.5 Hz cutoff) has died out
+static double q31PeakGain(const BiquadCoeffs& c, double cycles) {
+  BiquadQ31 f;
+  TEST_ASSERT_TRUE(biquadQ31Init(&f, c));
+  const double amplitude = 1 << 28;
+  double peak = 0;
+  for (int k = 0; k < 10000; k++) {
+    const int32_t y = biquadQ31Step(&f, (int32_t)lrint(amplitude * cos(2 * M_PI * cycles * k)));
+    if (k >= 8000) peak = fmax(peak, fabs((double)y));
+  }
+  return peak / amplitude;
+}
+
+void test_biquad_q31_passes_dc_and_attenuates_stopband() {
+  // 0.5 Hz at 1 kHz: coefficients too fine for Q14, fine in Q30
+  BiquadCoeffs c;
+  TEST_ASSERT_TRUE(dspDesignLowpass(0.5f, 1000.0f, &c));
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 1.0f, (float)q31PeakGain(c, 0.0));
+  // Two decades above the cutoff: a second-order section gives ~-80 dB
+  TEST_ASSERT_LESS_THAN_FLOAT(1e-3f, (float)q31PeakGain(c, 50.0 / 1000.0));
+}
+
+void test_fir_odd_taps_are_zero_padded() {
+  FirQ15 f;
+  const int16_t taps[3] = {8192, 16384, 8192};
+  TEST_ASSERT_TRUE(firQ15Init(&f, taps, 3));
+  TEST_ASSERT_EQUAL_UINT8(4, f.ntaps);
+  TEST_ASSERT_EQUAL_INT16(0, f.taps[3]);
+
+  // The impulse response is the taps, then zeros (the pad adds nothing)
+  const int16_t expect[6] = {8192, 16384, 8192, 0, 0, 0};
+  for (int k = 0; k < 6; k++) {
+    TEST_ASSERT_EQUAL_INT16(expect[k], firQ15StepScalar(&f, k == 0 ? 32767 : 0));
+  }
+
+  int16_t many[DSP_FIR_MAX_TAPS + 1] = {0};
+  TEST_ASSERT_FALSE(firQ15Init(&f, many, 0));
+  TEST_ASSERT_FALSE(firQ15Init(&f, many, DSP_FIR_MAX_TAPS + 1));
+}
+
+void test_filter_bank_rejects_bad_specs() {
+  ImuFilterBank bank;
+  TEST_ASSERT_TRUE(bank.configure("acc,lp,10,100"));
+  TEST_ASSERT_EQUAL(IMU_FILTER_BIQUAD_Q15, bank.kind(IMU_AX));
+
+  static const char* const bad[] = {
+      "6,off",                 // no such channel
+      "acc",                   // no spec
+      "acc,lp,60,100",         // cutoff above Nyquist
+      "acc,lp,10",             // missing fs
+      "acc,lp,10,100,",        // trailing junk
+      "acc,lp,0.001,1000",     // |a1| too close to 2 for Q14
+      "acc,fir,",              // empty tap
+      "acc,fir,1.0",           // |h| must be below 1
+      "acc,fir,0.1,x",         // not a number
+      "acc,fir,0.1,0.1,0.1,0.1,0.1,0.1,0.1,0.1,0.1,0.1,0.1,0.1,0.1,0.1,0.1,0.1,"
+      "0.1,0.1,0.1,0.1,0.1,0.1,0.1,0.1,0.1,0.1,0.1,0.1,0.1,0.1,0.1,0.1,0.1",  // 33 taps
+      "acc,median",            // unknown kind
+  };
+  for (const char* spec : bad) {
+    TEST_ASSERT_FALSE_MESSAGE(bank.configure(spec), spec);
+    // A refused spec leaves every channel as it was
+    TEST_ASSERT_EQUAL_MESSAGE(IMU_FILTER_BIQUAD_Q15, bank.kind(IMU_AX), spec);
+    TEST_ASSERT_EQUAL_MESSAGE(IMU_FILTER_OFF, bank.kind(IMU_ALPHA), spec);
+  }
+
+  // The same cutoff fits Q30 coefficients
+  TEST_ASSERT_TRUE(bank.configure("all,lp31,0.001,1000"));
+  TEST_ASSERT_EQUAL(IMU_FILTER_BIQUAD_Q31, bank.kind(IMU_ALPHA));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_dot_simd_matches_scalar);
+  RUN_TEST(test_fir_simd_matches_scalar);
+  RUN_TEST(test_biquad_q15_simd_matches_scalar);
+  RUN_TEST(test_design_lowpass);
+  RUN_TEST(test_biquad_q31_passes_dc_and_attenuates_stopband);
+  RUN_TEST(test_fir_odd_taps_are_zero_padded);
+  RUN_TEST(test_filter_bank_rejects_bad_specs);
+  return UNITY_END();
+}
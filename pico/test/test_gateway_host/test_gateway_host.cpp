@@ -0,0 +1,229 @@
+// Native gateway "send" -> "dump" over an in-memory loopback bus: every
+// sample comes out with the values that went in, in group order, and its
+// 0x504 stamp maps to the sending clock through the SYNC/FUP pairs. The
+// send path runs the firmware's calibrate/decimate/filter pipeline, and
+// the same round trip runs over SocketCAN when vcan0 is up.
+#include <unity.h>
+#include <net/if.h>
+#include <stdio.h>
+#include <vector>
+#include "gateway_core.h"
+#include "imu_codec.h"
+#include "socketcan.h"
+
+// Scripted device clock: each read advances it by one step
+static const uint64_t kStepUs = 250;
+// Receiver clock = device clock + offset
+static const uint64_t kLocalOffsetUs = 5000000;
+
+static uint64_t device_now;
+static uint64_t deviceClock() { return device_now += kStepUs; }
+
+// vcan-style loopback: frames reach the reader as they are sent
+class LoopbackBus : public CanTransport {
+public:
+  explicit LoopbackBus(GatewayDump& dump) : dump_(dump) {}
+  bool begin(uint32_t) override { return true; }
+  bool sendBatch(const CanFrame* frames, uint8_t count) override {
+    for (uint8_t i = 0; i < count; i++) {
+      if (dump_.onFrame(frames[i], device_now + kLocalOffsetUs)) {
+        placed.push_back(dump_.tsync().sample());
+      }
+    }
+    return true;
+  }
+  bool receive(CanFrame*) override { return false; }
+  bool setAcceptanceIds(const uint32_t*, uint8_t) override { return true; }
+  const char* name() const override { return "loopback"; }
+
+  std::vector<CanTimeSyncReceiver::Sample> placed;
+
+private:
+  GatewayDump& dump_;
+};
+
+static float value(int k, int c) {
+  // Two decimals, as the web app sends them, signs mixed
+  return (float)((k * 37 + c * 11) % 2000 - 1000) / 100.0f;
+}
+
+void setUp() { device_now = 0; }
+void tearDown() {}
+
+static void runAndCheck(FILE* in, int samples, unsigned long skipped, bool binary) {
+  rewind(in);
+  GatewayDump dump(nullptr, "loop0");
+  LoopbackBus bus(dump);
+  ImuPipeline pipeline;
+  GatewaySendStats stats;
+  gatewaySend(bus, in, binary, deviceClock, pipeline, &stats);
+  fclose(in);
+
+  TEST_ASSERT_EQUAL_UINT32(samples, stats.samples);
+  TEST_ASSERT_EQUAL_UINT32(samples, stats.groups);
+  TEST_ASSERT_EQUAL_UINT32(0, stats.failed);
+  TEST_ASSERT_EQUAL_UINT32(skipped, stats.skipped);
+  TEST_ASSERT_EQUAL_UINT32(samples, dump.samples());
+  TEST_ASSERT_EQUAL_UINT32(0, dump.orderErrors());
+  // Samples span more than CAN_TSYNC_PERIOD_US: a second SYNC/FUP
+  TEST_ASSERT_EQUAL_UINT32(2, dump.tsync().syncs());
+  TEST_ASSERT_EQUAL_UINT32(0, dump.tsync().lostSamples());
+  TEST_ASSERT_EQUAL_UINT32(0, dump.tsync().unsynced());
+  TEST_ASSERT_EQUAL(samples, bus.placed.size());
+
+  for (int k = 0; k < samples; k++) {
+    const CanTimeSyncReceiver::Sample& s = bus.placed[k];
+    TEST_ASSERT_EQUAL_UINT8(k, s.seq);
+    for (int c = 0; c < IMU_CHANNELS; c++) TEST_ASSERT_EQUAL_FLOAT(value(k, c), s.values[c]);
+    // One clock read per sample, plus one for each FUP
+    if (k > 0) {
+      const uint32_t dt = (uint32_t)(s.device_us - bus.placed[k - 1].device_us);
+      TEST_ASSERT_TRUE(dt == kStepUs || dt == 2 * kStepUs);
+    }
+    // The FUP carries the clock read after the SYNC write, one step
+    // late: the receiver's mapping is off by exactly that step
+    TEST_ASSERT_EQUAL_UINT64(s.device_us + kLocalOffsetUs - kStepUs, s.local_us);
+  }
+  TEST_ASSERT_EQUAL_UINT64(kStepUs, bus.placed[0].device_us);
+  TEST_ASSERT_EQUAL_UINT64(3 * kStepUs, bus.placed[1].device_us);
+}
+
+static const int kSamples = 5000;  // 1.25 s of clock steps
+
+static void test_csv_send_dump_round_trip() {
+  FILE* in = tmpfile();
+  TEST_ASSERT_NOT_NULL(in);
+  for (int k = 0; k < kSamples; k++) {
+    fprintf(in, "%.2f,%.2f,%.2f,%.2f,%.2f,%.2f\r\n", value(k, 0), value(k, 1), value(k, 2),
+            value(k, 3), value(k, 4), value(k, 5));
+    // Malformed lines are counted and skipped, not sent
+    if (k == 10) fprintf(in, "1,2,three\n");
+  }
+  runAndCheck(in, kSamples, 1, false);
+}
+
+static void test_binary_send_dump_round_trip() {
+  FILE* in = tmpfile();
+  TEST_ASSERT_NOT_NULL(in);
+  for (int k = 0; k < kSamples; k++) {
+    float v[IMU_CHANNELS];
+    for (int c = 0; c < IMU_CHANNELS; c++) v[c] = value(k, c);
+    fwrite(v, sizeof(float), IMU_CHANNELS, in);
+  }
+  runAndCheck(in, kSamples, 0, true);
+}
+
+static void test_send_runs_the_pipeline() {
+  // Constant input, so the decimator's output settles on the corrected
+  // value whatever its phase
+  static const int kInputs = 400;
+  static const uint8_t kRatio = 4;
+  FILE* in = tmpfile();
+  TEST_ASSERT_NOT_NULL(in);
+  for (int k = 0; k < kInputs; k++) fprintf(in, "0.5,-0.25,1,5,-3,9.5\n");
+  rewind(in);
+
+  GatewayDump dump(nullptr, "loop0");
+  LoopbackBus bus(dump);
+  ImuPipeline pipeline;
+  ImuCalibration& cal = pipeline.calibration();
+  cal.bias[IMU_AX] = 1.0f;
+  cal.scale[IMU_AX] = 2.0f;
+  cal.bias[IMU_AZ] = 9.5f;
+  TEST_ASSERT_TRUE(pipeline.decimator().configure(kRatio));
+  TEST_ASSERT_TRUE(pipeline.filter().configure("acc,lp,50,250"));
+  GatewaySendStats stats;
+  gatewaySend(bus, in, false, deviceClock, pipeline, &stats);
+  fclose(in);
+
+  TEST_ASSERT_EQUAL_UINT32(kInputs, stats.samples);
+  TEST_ASSERT_EQUAL_UINT32(kInputs / kRatio, stats.groups);
+  TEST_ASSERT_EQUAL_UINT32(0, stats.failed);
+  TEST_ASSERT_EQUAL_UINT32(stats.groups, dump.samples());
+  TEST_ASSERT_EQUAL(stats.groups, bus.placed.size());
+
+  const float expect[IMU_CHANNELS] = {0.5f, -0.25f, 1.0f, (5.0f - 1.0f) * 2.0f, -3.0f, 0.0f};
+  for (size_t k = 0; k < bus.placed.size(); k++) {
+    const CanTimeSyncReceiver::Sample& s = bus.placed[k];
+    TEST_ASSERT_EQUAL_UINT8(k, s.seq);
+    if (k < 10) continue;  // filter start-up, timed from the priming sample
+    // Stamped at the decimator's output times: one per kRatio inputs
+    TEST_ASSERT_GREATER_OR_EQUAL(kRatio * kStepUs, s.device_us - bus.placed[k - 1].device_us);
+    for (int c = 0; c < IMU_CHANNELS; c++) TEST_ASSERT_FLOAT_WITHIN(0.01f, expect[c], s.values[c]);
+  }
+}
+
+// The round trip over a real SocketCAN interface: one socket sends, a
+// second one on the same vcan0 receives (vcan loops every frame back)
+static void test_vcan_send_dump_round_trip() {
+  if (!if_nametoindex("vcan0")) {
+    TEST_IGNORE_MESSAGE("vcan0 not up (ip link add dev vcan0 type vcan)");
+  }
+  SocketCan tx("vcan0"), rx("vcan0");
+  TEST_ASSERT_TRUE(rx.begin(0));
+  TEST_ASSERT_TRUE(tx.begin(0));
+
+  // Few enough frames to sit in the receive socket's buffer
+  static const int kVcanSamples = 20;
+  FILE* in = tmpfile();
+  TEST_ASSERT_NOT_NULL(in);
+  for (int k = 0; k < kVcanSamples; k++) {
+    fprintf(in, "%.2f,%.2f,%.2f,%.2f,%.2f,%.2f\n", value(k, 0), value(k, 1), value(k, 2),
+            value(k, 3), value(k, 4), value(k, 5));
+  }
+  rewind(in);
+  ImuPipeline pipeline;
+  GatewaySendStats stats;
+  gatewaySend(tx, in, false, deviceClock, pipeline, &stats);
+  fclose(in);
+  TEST_ASSERT_EQUAL_UINT32(kVcanSamples, stats.groups);
+  TEST_ASSERT_EQUAL_UINT32(0, stats.failed);
+
+  GatewayDump dump(nullptr, "vcan0");
+  std::vector<CanTimeSyncReceiver::Sample> placed;
+  CanFrame f;
+  while (rx.receiveWait(&f, 200)) {
+    if (dump.onFrame(f, device_now + kLocalOffsetUs)) placed.push_back(dump.tsync().sample());
+  }
+
+  TEST_ASSERT_EQUAL_UINT32(kVcanSamples, dump.samples());
+  TEST_ASSERT_EQUAL_UINT32(0, dump.orderErrors());
+  TEST_ASSERT_EQUAL_UINT32(1, dump.tsync().syncs());
+  TEST_ASSERT_EQUAL(kVcanSamples, placed.size());
+  for (int k = 0; k < kVcanSamples; k++) {
+    TEST_ASSERT_EQUAL_UINT8(k, placed[k].seq);
+    for (int c = 0; c < IMU_CHANNELS; c++) TEST_ASSERT_EQUAL_FLOAT(value(k, c), placed[k].values[c]);
+    if (k > 0) {
+      const uint32_t dt = (uint32_t)(placed[k].device_us - placed[k - 1].device_us);
+      TEST_ASSERT_TRUE(dt == kStepUs || dt == 2 * kStepUs);
+    }
+    // Everything is read after the send, so the SYNC's receive time is
+    // late by the whole run, but one offset maps every sample
+    TEST_ASSERT_EQUAL_INT64(placed[0].local_us - placed[0].device_us,
+                            placed[k].local_us - placed[k].device_us);
+  }
+}
+
+static void test_dump_counts_order_errors() {
+  GatewayDump dump(nullptr, "loop0");
+  const float v[IMU_CHANNELS] = {1, 2, 3, 4, 5, 6};
+  CanFrame frames[IMU_CAN_FRAMES];
+  imuPackFrames(v, frames);
+  // 0x501, 0x503 (0x502 lost), then a full group
+  dump.onFrame(frames[0], 0);
+  dump.onFrame(frames[2], 0);
+  for (const CanFrame& f : frames) dump.onFrame(f, 0);
+  TEST_ASSERT_EQUAL_UINT32(1, dump.orderErrors());
+  TEST_ASSERT_EQUAL_UINT32(1, dump.samples());
+  TEST_ASSERT_EQUAL_UINT32(5, dump.frames());
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_csv_send_dump_round_trip);
+  RUN_TEST(test_binary_send_dump_round_trip);
+  RUN_TEST(test_send_runs_the_pipeline);
+  RUN_TEST(test_vcan_send_dump_round_trip);
+  RUN_TEST(test_dump_counts_order_errors);
+  return UNITY_END();
+}
@@ -0,0 +1,306 @@
+// GsUsb against the Mcp2515 driver and register model, with a small
+// stand-in for Linux's gs_usb driver on the other side of the control
+// and bulk endpoints: probe (HOST_FORMAT, DEVICE_CONFIG, BT_CONST), bit
+// timing from the advertised limits as can_calc_bittiming() does it,
+// MODE start / reset, frames and echoes (including frames that wait for
+// a busy controller).
+#include <unity.h>
+#include <string.h>
+#include "can_rx_filter.h"
+#include "gs_usb.h"
+#include "mcp2515.h"
+#include "mcp2515_model.h"
+#include "usb_frame.h"
+
+static const uint32_t kGatewayIds[] = {0x100, 0x200};
+
+static Mcp2515Model* chip;
+static Mcp2515* can;
+static CanRxFilter* filter;
+static GsUsb* gs;
+
+void setUp() {
+  chip = new Mcp2515Model();
+  can = new Mcp2515(*chip);
+  filter = new CanRxFilter(*can);
+  gs = new GsUsb(*can, *filter, 1000000);
+  TEST_ASSERT_TRUE(can->begin(1000000));
+  TEST_ASSERT_TRUE(filter->setIds(kGatewayIds, 2));
+}
+
+void tearDown() {
+  delete gs;
+  delete filter;
+  delete can;
+  delete chip;
+}
+
+// Host side: what the kernel driver sends and expects
+struct HostDriver {
+  uint32_t clock = 0;
+  uint32_t tseg1_min = 0, tseg1_max = 0, tseg2_min = 0, tseg2_max = 0;
+  uint32_t brp_min = 0, brp_max = 0;
+  bool hw_timestamp = false;
+
+  bool probe() {
+    uint8_t buf[64];
+    putLe32(buf, 0x0000BEEF);
+    if (!gs->controlOut(GsUsb::BREQ_HOST_FORMAT, buf, 4)) return false;
+    if (gs->controlIn(GsUsb::BREQ_DEVICE_CONFIG, buf, sizeof(buf), 0) != 12) return false;
+    if (getLe32(buf + 4) != 2) return false;  // icount: one channel
+    if (gs->controlIn(GsUsb::BREQ_BT_CONST, buf, sizeof(buf), 0) != 40) return false;
+    hw_timestamp = getLe32(buf) & GsUsb::FEATURE_HW_TIMESTAMP;
+    clock = getLe32(buf + 4);
+    tseg1_min = getLe32(buf + 8);
+    tseg1_max = getLe32(buf + 12);
+    tseg2_min = getLe32(buf + 16);
+    tseg2_max = getLe32(buf + 20);
+    brp_min = getLe32(buf + 28);
+    brp_max = getLe32(buf + 32);
+    return true;
+  }
+
+  // Closest timing within the limits, 87.5 % sample point (CiA default),
+  // longest bit first like the kernel's search
+  bool bitTiming(uint32_t bitrate, uint32_t* tseg1, uint32_t* tseg2, uint32_t* brp) {
+    uint32_t best_err = UINT32_MAX;
+    for (uint32_t tq = 1 + tseg1_max + tseg2_max; tq >= 1 + tseg1_min + tseg2_min; tq--) {
+      uint32_t b = (clock + tq * bitrate / 2) / (tq * bitrate);
+      if (b < brp_min) b = brp_min;
+      if (b > brp_max) b = brp_max;
+      const uint32_t rate = clock / (b * tq);
+      const uint32_t err = rate > bitrate ? rate - bitrate : bitrate - rate;
+      if (err >= best_err) continue;
+      best_err = err;
+      *brp = b;
+      uint32_t t2 = tq - (tq * 875 + 500) / 1000;
+      if (t2 < tseg2_min) t2 = tseg2_min;
+      if (t2 > tseg2_max) t2 = tseg2_max;
+      uint32_t t1 = tq - 1 - t2;
+      if (t1 > tseg1_max) {
+        t1 = tseg1_max;
+        t2 = tq - 1 - t1;
+      }
+      *tseg1 = t1;
+      *tseg2 = t2;
+    }
+    return best_err != UINT32_MAX;
+  }
+
+  // ip link set can0 up type can bitrate <bitrate>
+  bool open(uint32_t bitrate) {
+    uint32_t tseg1, tseg2, brp;
+    if (!bitTiming(bitrate, &tseg1, &tseg2, &brp)) return false;
+    uint8_t buf[20];
+    putLe32(buf, tseg1 / 2);             // prop_seg
+    putLe32(buf + 4, tseg1 - tseg1 / 2);  // phase_seg1
+    putLe32(buf + 8, tseg2);
+    putLe32(buf + 12, 1);                 // sjw
+    putLe32(buf + 16, brp);
+    if (!gs->controlOut(GsUsb::BREQ_BITTIMING, buf, 20)) return false;
+    putLe32(buf, GsUsb::MODE_START);
+    putLe32(buf + 4, hw_timestamp ? (uint32_t)GsUsb::MODE_FLAG_HW_TIMESTAMP : 0u);
+    return gs->controlOut(GsUsb::BREQ_MODE, buf, 8);
+  }
+
+  bool close() {
+    uint8_t buf[8];
+    putLe32(buf, GsUsb::MODE_RESET);
+    putLe32(buf + 4, 0);
+    return gs->controlOut(GsUsb::BREQ_MODE, buf, 8);
+  }
+
+  bool xmit(uint32_t echo_id, const CanFrame& f, uint32_t id_flags = 0) {
+    uint8_t buf[GsUsb::kFrameSize] = {0};
+    putLe32(buf, echo_id);
+    putLe32(buf + 4, f.id | (f.extended ? (uint32_t)GsUsb::CAN_ID_EFF : 0u) | id_flags);
+    buf[8] = f.dlc;
+    memcpy(buf + 12, f.data, 8);
+    return gs->onHostFrame(buf, sizeof(buf), 1234);
+  }
+
+  // Bulk IN: false when nothing is queued
+  bool read(uint32_t* echo_id, CanFrame* f, uint32_t* timestamp_us) {
+    uint8_t buf[GsUsb::kFrameSizeTimestamp];
+    const size_t n = gs->nextInFrame(buf);
+    if (n == 0) return false;
+    TEST_ASSERT_EQUAL(hw_timestamp ? GsUsb::kFrameSizeTimestamp : GsUsb::kFrameSize, n);
+    *echo_id = getLe32(buf);
+    const uint32_t can_id = getLe32(buf + 4);
+    f->extended = (can_id & GsUsb::CAN_ID_EFF) != 0;
+    f->id = can_id & 0x1FFFFFFF;
+    f->dlc = buf[8];
+    memcpy(f->data, buf + 12, 8);
+    *timestamp_us = n == GsUsb::kFrameSizeTimestamp ? getLe32(buf + 20) : 0;
+    return true;
+  }
+};
+
+static CanFrame makeFrame(uint32_t id, uint8_t dlc) {
+  CanFrame f = {id, dlc, false, {0}};
+  for (uint8_t i = 0; i < dlc; i++) f.data[i] = (uint8_t)(0x30 + i);
+  return f;
+}
+
+// Gateway loop: move received frames to the adapter
+static void pump(uint32_t timestamp_us) {
+  CanFrame f;
+  while (can->receive(&f)) gs->onReceive(f, timestamp_us);
+}
+
+static void test_every_standard_rate_maps_exactly() {
+  HostDriver host;
+  TEST_ASSERT_TRUE(host.probe());
+  const uint32_t rates[] = {10000, 20000, 50000, 100000, 125000, 250000, 500000, 800000, 1000000};
+  for (uint32_t rate : rates) {
+TEST_ASSERT_TRUE_MESSAGE(host.open(rate), "standard rate refused");
+    TEST_ASSERT_EQUAL_UINT32(rate, gs->bitrate());
+    TEST_ASSERT_TRUE(host.close());
+  }
+}
+
+static void test_other_rates_are_refused() {
+  HostDriver host;
+  TEST_ASSERT_TRUE(host.probe());
+  const uint32_t resets = chip->resets();
+  TEST_ASSERT_FALSE(host.open(333333));
+  TEST_ASSERT_FALSE(host.open(83333));
+  TEST_ASSERT_FALSE(gs->started());
+  TEST_ASSERT_EQUAL_UINT32(resets, chip->resets());
+}
+
+static void test_session_keeps_controller_and_restores_gateway_list() {
+  HostDriver host;
+  TEST_ASSERT_TRUE(host.probe());
+  TEST_ASSERT_FALSE(chip->deliver(makeFrame(0x321, 2)));
+
+  // Same rate as the gateway: no controller reset
+  TEST_ASSERT_TRUE(host.open(1000000));
+  TEST_ASSERT_EQUAL_UINT32(1, chip->resets());
+  TEST_ASSERT_TRUE(gs->started());
+  TEST_ASSERT_TRUE(filter->isOpen());
+
+  // Bus -> host, with the hardware timestamp
+  TEST_ASSERT_TRUE(chip->deliver(makeFrame(0x321, 2)));
+  pump(5000);
+  uint32_t echo_id, ts;
+  CanFrame f;
+  TEST_ASSERT_TRUE(host.read(&echo_id, &f, &ts));
+  TEST_ASSERT_EQUAL_HEX32(GsUsb::ECHO_ID_RX, echo_id);
+  TEST_ASSERT_EQUAL_HEX32(0x321, f.id);
+  TEST_ASSERT_EQUAL_UINT8(2, f.dlc);
+  TEST_ASSERT_EQUAL_HEX8(0x31, f.data[1]);
+  TEST_ASSERT_EQUAL_UINT32(5000, ts);
+
+  // Host -> bus, and the echo that frees the driver's TX context
+  CanFrame ext = makeFrame(0x1ABCDE, 8);
+  ext.extended = true;
+  TEST_ASSERT_TRUE(host.xmit(7, ext));
+  CanFrame out;
+  TEST_ASSERT_TRUE(chip->transmit(&out));
+  TEST_ASSERT_EQUAL_HEX32(0x1ABCDE, out.id);
+  TEST_ASSERT_TRUE(out.extended);
+  TEST_ASSERT_TRUE(host.read(&echo_id, &f, &ts));
+  TEST_ASSERT_EQUAL_UINT32(7, echo_id);
+  TEST_ASSERT_EQUAL_HEX32(0x1ABCDE, f.id);
+  TEST_ASSERT_TRUE(f.extended);
+  TEST_ASSERT_FALSE(host.read(&echo_id, &f, &ts));
+
+  TEST_ASSERT_TRUE(host.close());
+  TEST_ASSERT_FALSE(filter->isOpen());
+  TEST_ASSERT_FALSE(chip->deliver(makeFrame(0x321, 2)));
+  TEST_ASSERT_TRUE(chip->deliver(makeFrame(0x100, 2)));
+  // Stopped: nothing reaches the host, host frames are refused
+  pump(6000);
+  TEST_ASSERT_FALSE(host.read(&echo_id, &f, &ts));
+  TEST_ASSERT_FALSE(host.xmit(8, ext));
+}
+
+static void test_rate_change_reprograms_and_restores_filter() {
+  HostDriver host;
+  TEST_ASSERT_TRUE(host.probe());
+  TEST_ASSERT_TRUE(host.open(500000));
+  TEST_ASSERT_EQUAL_UINT32(2, chip->resets());
+  TEST_ASSERT_EQUAL_HEX8(Mcp2515::kBitrate500k_16MHz.cnf2, chip->reg(0x29));
+  TEST_ASSERT_TRUE(chip->deliver(makeFrame(0x321, 0)));
+  // Restart at the same rate (ip link down/up) does not reset again
+  TEST_ASSERT_TRUE(host.close());
+  TEST_ASSERT_TRUE(host.open(500000));
+  TEST_ASSERT_EQUAL_UINT32(2, chip->resets());
+  TEST_ASSERT_TRUE(host.close());
+
+  CanFrame f;
+  while (can->receive(&f)) {}
+  TEST_ASSERT_FALSE(chip->deliver(makeFrame(0x321, 0)));
+  TEST_ASSERT_TRUE(chip->deliver(makeFrame(0x200, 0)));
+}
+
+static void test_every_host_frame_is_echoed() {
+  HostDriver host;
+  TEST_ASSERT_TRUE(host.probe());
+  TEST_ASSERT_TRUE(host.open(1000000));
+
+  // All of the driver's TX contexts at once, with the controller's TX
+  // buffers and queue full and the bus not taking anything yet: the
+  // frames it has no room for wait, in order
+  while (can->send(makeFrame(0x050, 0))) {}
+  uint32_t echo_id, ts;
+  CanFrame f;
+  for (uint32_t i = 0; i < GsUsb::kTxSlots; i++) {
+    TEST_ASSERT_TRUE(gs->txReady());
+    TEST_ASSERT_TRUE(host.xmit(100 + i, makeFrame(0x400 + i, 1),
+                               i == 4 ? (uint32_t)GsUsb::CAN_ID_RTR : 0u));
+  }
+  TEST_ASSERT_TRUE(gs->txPending() > 0);
+
+  // RX traffic in between does not take the echoes' room
+  for (int i = 0; i < 40; i++) gs->onReceive(makeFrame(0x321, 0), 0);
+
+  uint32_t next_echo = 100;
+  uint32_t next_id = 0x400;
+  for (int guard = 0; guard < 200 && next_echo < 100 + GsUsb::kTxSlots; guard++) {
+    CanFrame out;
+    if (chip->transmit(&out) && out.id != 0x050) {
+      if (next_id == 0x404) next_id++;  // the RTR frame is echoed only
+      TEST_ASSERT_EQUAL_HEX32(next_id, out.id);
+      next_id++;
+    }
+    can->pollTx();
+    gs->service(2000);
+    while (host.read(&echo_id, &f, &ts)) {
+      if (echo_id == GsUsb::ECHO_ID_RX) continue;
+      TEST_ASSERT_EQUAL_UINT32(next_echo, echo_id);
+      next_echo++;
+    }
+  }
+  TEST_ASSERT_EQUAL_UINT32(100 + GsUsb::kTxSlots, next_echo);
+  // The last echoes come back once their frames are queued in the driver
+  CanFrame out;
+  for (; chip->transmit(&out); can->pollTx()) {
+    if (out.id == 0x050) continue;
+    if (next_id == 0x404) next_id++;
+    TEST_ASSERT_EQUAL_HEX32(next_id++, out.id);
+  }
+  TEST_ASSERT_EQUAL_HEX32(0x400 + GsUsb::kTxSlots, next_id);
+  TEST_ASSERT_EQUAL_UINT32(0, gs->txPending());
+
+  // Frames still waiting at close are dropped with the driver's contexts
+  while (can->send(makeFrame(0x050, 0))) {}
+  TEST_ASSERT_TRUE(host.xmit(200, makeFrame(0x410, 1)));
+  TEST_ASSERT_TRUE(host.xmit(201, makeFrame(0x411, 1)));
+  TEST_ASSERT_TRUE(host.xmit(202, makeFrame(0x412, 1)));
+  TEST_ASSERT_TRUE(host.xmit(203, makeFrame(0x413, 1)));
+  TEST_ASSERT_TRUE(gs->txPending() > 0);
+  TEST_ASSERT_TRUE(host.close());
+  TEST_ASSERT_EQUAL_UINT32(0, gs->txPending());
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_every_standard_rate_maps_exactly);
+  RUN_TEST(test_other_rates_are_refused);
+  RUN_TEST(test_session_keeps_controller_and_restores_gateway_list);
+  RUN_TEST(test_rate_change_reprograms_and_restores_filter);
+  RUN_TEST(test_every_host_frame_is_echoed);
+  return UNITY_END();
+}
@@ -0,0 +1,174 @@
+// ImuCalibrator / imuCalib*: bias and scale recovered from simulated
+// poses and rest captures, the flash record round trip and its
+// rejections, and drift estimates across the orientation wrap.
+#include <unity.h>
+#include <math.h>
+#include <string.h>
+#include <random>
+#include "imu_calib.h"
+
+void setUp() {}
+void tearDown() {}
+
+static const float kBias[3] = {0.35f, -0.2f, 0.5f};
+static const float kGain[3] = {1.03f, 0.97f, 1.01f};  // raw = true * gain + bias
+
+// Feed `n` samples of a device at rest; `g` is the true acceleration
+static void capture(ImuCalibrator& c, const double g[3], uint16_t n, std::mt19937& rng,
+                    float noise = 0.02f) {
+  std::normal_distribution<float> gauss(0.0f, noise);
+  for (uint16_t k = 0; k < n; k++) {
+    float v[IMU_CHANNELS] = {0.1f, 0.2f, 0.3f};
+    for (int a = 0; a < 3; a++) v[IMU_AX + a] = (float)g[a] * kGain[a] + kBias[a] + gauss(rng);
+    const bool done = c.push(v, 1000000 + k * 10000ull);
+    TEST_ASSERT_EQUAL(k + 1 == n, done);
+  }
+}
+
+static void test_still_capture_recovers_bias() {
+  std::mt19937 rng(3);
+  ImuCalibrator c;
+  TEST_ASSERT_TRUE(c.start(ImuCalibrator::CAPTURE_STILL, 500));
+  const double rest[3] = {0, 0, 0};  // linear acceleration streamed
+  capture(c, rest, 500, rng);
+  TEST_ASSERT_EQUAL(ImuCalibrator::CAPTURE_STILL, c.lastKind());
+  TEST_ASSERT_TRUE(c.still());
+  for (int a = 0; a < 3; a++) TEST_ASSERT_FLOAT_WITHIN(0.005f, kBias[a], c.mean()[IMU_AX + a]);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 0.02f * sqrtf(3), c.motionRms());
+}
+
+static void test_pose_fit_recovers_bias_and_scale() {
+  std::mt19937 rng(4);
+  ImuCalibrator c;
+  // Each face up and down, plus two tilted poses
+  const double s = IMU_GRAVITY / sqrt(3.0);
+  const double poses[8][3] = {
+    {IMU_GRAVITY, 0, 0}, {-IMU_GRAVITY, 0, 0}, {0, IMU_GRAVITY, 0},
+    {0, -IMU_GRAVITY, 0}, {0, 0, IMU_GRAVITY}, {0, 0, -IMU_GRAVITY},
+    {s, s, s}, {-s, s, -s},
+  };
+  for (uint8_t i = 0; i < 8; i++) {
+    TEST_ASSERT_TRUE(c.start(ImuCalibrator::CAPTURE_POSE, 200, i));
+    capture(c, poses[i], 200, rng);
+    TEST_ASSERT_EQUAL_UINT8(i + 1, c.poses());
+    if (i < 5) {
+      ImuCalibration cal;
+      float residual;
+      TEST_ASSERT_FALSE(c.fit(&cal, &residual));  // fewer than six poses
+    }
+  }
+
+  ImuCalibration cal;
+  imuCalibIdentity(&cal);
+  float residual = -1;
+  TEST_ASSERT_TRUE(c.fit(&cal, &residual));
+  for (int a = 0; a < 3; a++) {
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, kBias[a], cal.bias[IMU_AX + a]);
+    TEST_ASSERT_FLOAT_WITHIN(0.002f, 1.0f / kGain[a], cal.scale[IMU_AX + a]);
+  }
+  TEST_ASSERT_LESS_THAN_FLOAT(0.01f, residual);
+  // Orientation stays identity
+  for (int a = 0; a < IMU_AX; a++) {
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, cal.bias[a]);
+    TEST_ASSERT_EQUAL_FLOAT(1.0f, cal.scale[a]);
+  }
+
+  // Applied to a raw pose, the correction gives back the true value
+  float v[IMU_CHANNELS] = {1, 2, 3};
+  for (int a = 0; a < 3; a++) v[IMU_AX + a] = (float)poses[6][a] * kGain[a] + kBias[a];
+  imuCalibApply(cal, v);
+  for (int a = 0; a < 3; a++) TEST_ASSERT_FLOAT_WITHIN(0.02f, (float)poses[6][a], v[IMU_AX + a]);
+  TEST_ASSERT_EQUAL_FLOAT(2.0f, v[IMU_BETA]);
+}
+
+static void test_moving_pose_is_not_kept() {
+  std::mt19937 rng(5);
+  ImuCalibrator c;
+  TEST_ASSERT_TRUE(c.start(ImuCalibrator::CAPTURE_POSE, 100, 0));
+  const double up[3] = {0, 0, IMU_GRAVITY};
+  capture(c, up, 100, rng, 2.0f);
+  TEST_ASSERT_FALSE(c.still());
+  TEST_ASSERT_EQUAL_UINT8(0, c.poses());
+}
+
+static void test_record_round_trip_and_rejections() {
+  ImuCalibration cal;
+  for (int i = 0; i < IMU_CHANNELS; i++) {
+    cal.bias[i] = 0.125f * (i - 2);
+    cal.scale[i] = 1.0f + 0.01f * i;
+  }
+  uint8_t rec[IMU_CALIB_RECORD_SIZE];
+  imuCalibPack(cal, rec);
+
+  ImuCalibration out;
+  imuCalibIdentity(&out);
+  TEST_ASSERT_TRUE(imuCalibUnpack(rec, &out));
+  TEST_ASSERT_EQUAL_MEMORY(&cal, &out, sizeof(cal));
+
+  // Every single-byte corruption is caught; the output is left alone
+  for (size_t i = 0; i < IMU_CALIB_RECORD_SIZE; i++) {
+    uint8_t bad[IMU_CALIB_RECORD_SIZE];
+    memcpy(bad, rec, sizeof(bad));
+    bad[i] ^= 0x10;
+    ImuCalibration untouched;
+    imuCalibIdentity(&untouched);
+    TEST_ASSERT_FALSE(imuCalibUnpack(bad, &untouched));
+    TEST_ASSERT_EQUAL_FLOAT(1.0f, untouched.scale[IMU_AX]);
+  }
+
+  // Erased flash
+  uint8_t erased[IMU_CALIB_RECORD_SIZE];
+  memset(erased, 0xFF, sizeof(erased));
+  TEST_ASSERT_FALSE(imuCalibUnpack(erased, &out));
+
+  // Well-formed records with unusable values
+  ImuCalibration bad = cal;
+  bad.scale[IMU_AY] = 0.0f;
+  imuCalibPack(bad, rec);
+  TEST_ASSERT_FALSE(imuCalibUnpack(rec, &out));
+  bad = cal;
+  bad.bias[IMU_AZ] = NAN;
+  imuCalibPack(bad, rec);
+  TEST_ASSERT_FALSE(imuCalibUnpack(rec, &out));
+}
+
+static void test_drift_follows_the_wrap() {
+  // Alpha runs through 2pi -> 0, beta through pi -> -pi and gamma
+  // backwards through -pi/2, over a 10 s capture at 100 Hz
+  const float rate[3] = {0.05f, 0.02f, -0.01f};  // rad/s
+  const float start[3] = {6.1f, 3.0f, -1.5f};
+  ImuCalibrator c;
+  TEST_ASSERT_TRUE(c.start(ImuCalibrator::CAPTURE_STILL, 1001));
+  for (int k = 0; k <= 1000; k++) {
+    const float t = k * 0.01f;
+    float v[IMU_CHANNELS] = {0};
+    v[IMU_ALPHA] = fmodf(start[0] + rate[0] * t, 2 * (float)M_PI);
+    float b = start[1] + rate[1] * t;
+    if (b >= (float)M_PI) b -= 2 * (float)M_PI;
+    v[IMU_BETA] = b;
+    v[IMU_GAMMA] = start[2] + rate[2] * t;
+    c.push(v, 5000000 + k * 10000ull);
+  }
+  TEST_ASSERT_EQUAL(ImuCalibrator::CAPTURE_NONE, c.capturing());
+  for (int i = 0; i < 3; i++) TEST_ASSERT_FLOAT_WITHIN(1e-4f, rate[i], c.driftRate()[i]);
+}
+
+static void test_start_limits() {
+  ImuCalibrator c;
+  TEST_ASSERT_FALSE(c.start(ImuCalibrator::CAPTURE_NONE, 100));
+  TEST_ASSERT_FALSE(c.start(ImuCalibrator::CAPTURE_STILL, 1));
+  TEST_ASSERT_FALSE(c.start(ImuCalibrator::CAPTURE_POSE, 100, ImuCalibrator::kMaxPoses));
+  const float v[IMU_CHANNELS] = {0};
+  TEST_ASSERT_FALSE(c.push(v, 0));
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_still_capture_recovers_bias);
+  RUN_TEST(test_pose_fit_recovers_bias_and_scale);
+  RUN_TEST(test_moving_pose_is_not_kept);
+  RUN_TEST(test_record_round_trip_and_rejections);
+  RUN_TEST(test_drift_follows_the_wrap);
+  RUN_TEST(test_start_limits);
+  return UNITY_END();
+}
@@ -0,0 +1,135 @@
+// ImuDecimator at ratios 2, 4 and 8: unity DC gain, a flat passband,
+// stopband attenuation for everything that would alias, and output
+// timestamps at the FIR's group delay.
+#include <unity.h>
+#include <math.h>
+#include "imu_decimator.h"
+#include "imu_filter.h"
+
+void setUp() {}
+void tearDown() {}
+
+static const uint8_t kRatios[] = {2, 4, 8};
+static const uint64_t kStartUs = 1000000;
+static const uint64_t kPeriodUs = 1000;  // 1 kHz input
+static const float kAmplitude = 20.0f;   // m/s^2, within the Q15 full scale
+
+// Gain in dB of a tone at `cycles` per input sample, after the start-up
+// transient. ax/ay carry sine/cosine so the amplitude of each output is
+// exact whatever phase the decimation lands on.
+static double toneGainDb(ImuDecimator& d, double cycles) {
+  d.reset();
+  double peak = 0;
+  for (int k = 0; k < 4000; k++) {
+    float in[IMU_CHANNELS] = {0};
+    in[IMU_AX] = kAmplitude * (float)sin(2 * M_PI * cycles * k);
+    in[IMU_AY] = kAmplitude * (float)cos(2 * M_PI * cycles * k);
+    float out[IMU_CHANNELS];
+    uint64_t t;
+    if (d.push(in, kStartUs + k * kPeriodUs, out, &t) && k > 500) {
+      peak = fmax(peak, hypot(out[IMU_AX], out[IMU_AY]));
+    }
+  }
+  return 20 * log10(peak / kAmplitude + 1e-12);
+}
+
+static void test_dc_gain_is_unity() {
+  for (uint8_t r : kRatios) {
+    ImuDecimator d;
+    TEST_ASSERT_TRUE(d.configure(r));
+    TEST_ASSERT_EQUAL_UINT16(8 * r, d.taps());
+    int outputs = 0;
+    for (int k = 0; k < 50 * r; k++) {
+      const float in[IMU_CHANNELS] = {10, 20, 30, 9.81f, -3.5f, 0.25f};
+      float out[IMU_CHANNELS];
+      uint64_t t;
+      if (!d.push(in, kStartUs + k * kPeriodUs, out, &t)) continue;
+      outputs++;
+      // One Q15 step of the acceleration full scale
+      const float lsb = IMU_ACCELERATION_FULL_SCALE / 32768;
+      for (int c = 0; c < IMU_CHANNELS; c++) TEST_ASSERT_FLOAT_WITHIN(lsb, in[c], out[c]);
+    }
+    TEST_ASSERT_EQUAL(50, outputs);
+  }
+}
+
+static void test_passband_is_flat() {
+  for (uint8_t r : kRatios) {
+    ImuDecimator d;
+    TEST_ASSERT_TRUE(d.configure(r));
+    // Up to 40 % of the output Nyquist
+    for (double f = 0.02; f <= 0.2; f += 0.02) {
+      const double g = toneGainDb(d, f / r);
+      TEST_ASSERT_FLOAT_WITHIN(0.5f, 0.0f, (float)g);
+    }
+  }
+}
+
+static void test_stopband_attenuation() {
+  for (uint8_t r : kRatios) {
+    ImuDecimator d;
+    TEST_ASSERT_TRUE(d.configure(r));
+    // From 0.7 output-rate cycles (past the transition band, which ends
+    // where an alias would reach the passband) up to the input Nyquist
+    double worst = -200;
+    for (double f = 0.7; f < r / 2.0; f += 0.01) worst = fmax(worst, toneGainDb(d, f / r));
+    TEST_ASSERT_LESS_THAN_FLOAT(-40.0f, (float)worst);
+  }
+}
+
+static void test_timestamps_at_group_delay() {
+  for (uint8_t r : kRatios) {
+    ImuDecimator d;
+    TEST_ASSERT_TRUE(d.configure(r));
+    // (taps - 1) / 2 inputs behind the newest one
+    const double delay_us = (d.taps() - 1) / 2.0 * kPeriodUs;
+    const double cycles = 0.05 / r;
+    uint64_t last_t = 0;
+    int outputs = 0;
+    for (int k = 0; k < 400 * r; k++) {
+      float in[IMU_CHANNELS] = {0};
+      in[IMU_ALPHA] = (float)k;
+      in[IMU_AX] = kAmplitude * (float)sin(2 * M_PI * cycles * k);
+      const uint64_t now = kStartUs + k * kPeriodUs;
+      float out[IMU_CHANNELS];
+      uint64_t t;
+      if (!d.push(in, now, out, &t)) continue;
+      outputs++;
+      TEST_ASSERT_EQUAL((k + 1) % r, 0);
+      // Until the window has filled, the primed history repeats the
+      // first sample and its time
+      if (k < d.taps()) continue;
+      TEST_ASSERT_FLOAT_WITHIN(0.5f, (float)((double)now - delay_us), (float)t);
+      if (last_t) TEST_ASSERT_EQUAL_UINT64(r * kPeriodUs, t - last_t);
+      last_t = t;
+      // The filtered tone is in phase with its timestamp ...
+      const double at = ((double)t - kStartUs) / kPeriodUs;
+      TEST_ASSERT_FLOAT_WITHIN(0.05f * kAmplitude, kAmplitude * sin(2 * M_PI * cycles * at),
+                               out[IMU_AX]);
+      // ... and the picked angle is the input half a sample after it
+      TEST_ASSERT_FLOAT_WITHIN(0.5f, (float)at, out[IMU_ALPHA]);
+    }
+    TEST_ASSERT_EQUAL(400, outputs);
+  }
+}
+
+static void test_configure_limits() {
+  ImuDecimator d;
+  TEST_ASSERT_FALSE(d.configure(0));
+  TEST_ASSERT_FALSE(d.configure(ImuDecimator::kMaxRatio + 1));
+  TEST_ASSERT_FALSE(d.configure(4, 3));
+  TEST_ASSERT_FALSE(d.configure(4, ImuDecimator::kMaxTapsPerPhase + 2));
+  TEST_ASSERT_EQUAL_UINT8(1, d.ratio());
+  TEST_ASSERT_TRUE(d.configure(4, 4));
+  TEST_ASSERT_EQUAL_UINT16(16, d.taps());
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_dc_gain_is_unity);
+  RUN_TEST(test_passband_is_flat);
+  RUN_TEST(test_stopband_attenuation);
+  RUN_TEST(test_timestamps_at_group_delay);
+  RUN_TEST(test_configure_limits);
+  return UNITY_END();
+}
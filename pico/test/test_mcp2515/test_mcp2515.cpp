@@ -0,0 +1,330 @@
+// Mcp2515 driver against the register-level model (host/mcp2515_model.h):
+// bring-up, the LOAD TX / RTS send path, READ RX BUFFER and the
+// acceptance filters as the chip would apply them.
+#include <unity.h>
+#include <string.h>
+#include "mcp2515.h"
+#include "mcp2515_model.h"
+
+static Mcp2515Model* chip;
+static Mcp2515* can;
+
+void setUp() {
+  chip = new Mcp2515Model();
+  can = new Mcp2515(*chip);
+}
+
+void tearDown() {
+  delete can;
+  delete chip;
+}
+
+static CanFrame makeFrame(uint32_t id, uint8_t dlc, bool extended = false) {
+  CanFrame f = {id, dlc, extended, {0}};
+  for (uint8_t i = 0; i < dlc; i++) f.data[i] = (uint8_t)(id * 7 + i);
+  return f;
+}
+
+static void assertFrame(const CanFrame& want, const CanFrame& got) {
+  TEST_ASSERT_EQUAL_HEX32(want.id, got.id);
+  TEST_ASSERT_EQUAL(want.extended, got.extended);
+  TEST_ASSERT_EQUAL_UINT8(want.dlc, got.dlc);
+  TEST_ASSERT_EQUAL_MEMORY(want.data, got.data, want.dlc);
+}
+
+static void test_begin_programs_timing_and_enters_normal_mode() {
+  chip->mode_delay = 3;  // CANSTAT lags like the real oscillator start
+  TEST_ASSERT_TRUE(can->begin(500000));
+  TEST_ASSERT_EQUAL_UINT32(1, chip->resets());
+  TEST_ASSERT_EQUAL_HEX8(Mcp2515::MODE_NORMAL, chip->mode());
+  TEST_ASSERT_EQUAL_HEX8(Mcp2515::kBitrate500k_16MHz.cnf1, chip->reg(0x2A));
+  TEST_ASSERT_EQUAL_HEX8(Mcp2515::kBitrate500k_16MHz.cnf2, chip->reg(0x29));
+  TEST_ASSERT_EQUAL_HEX8(Mcp2515::kBitrate500k_16MHz.cnf3, chip->reg(0x28));
+  TEST_ASSERT_EQUAL_HEX8(0x03, chip->reg(Mcp2515::REG_CANINTE));
+  // Receive any frame, RXB0 rolls over into RXB1
+  TEST_ASSERT_EQUAL_HEX8(0x64, chip->reg(Mcp2515::REG_RXB0CTRL));
+  TEST_ASSERT_EQUAL_HEX8(0x60, chip->reg(Mcp2515::REG_RXB1CTRL));
+}
+
+static void test_begin_fails_without_a_chip_answer() {
+  chip->mode_delay = 1000;  // never reaches configuration mode in time
+  TEST_ASSERT_FALSE(can->begin(1000000));
+}
+
+static void test_begin_rejects_nonstandard_bitrate_without_reset() {
+  TEST_ASSERT_FALSE(can->begin(333333));
+  TEST_ASSERT_EQUAL_UINT32(0, chip->resets());
+}
+
+static void test_bit_timing_tables_give_their_rates() {
+  // CNF1: SJW | BRP-1; CNF2: PHSEG1-1 << 3 | PRSEG-1; CNF3: PHSEG2-1
+  const struct { uint32_t bitrate; Mcp2515::BitTiming t; } tables[] = {
+    {1000000, Mcp2515::kBitrate1M_16MHz},   {800000, Mcp2515::kBitrate800k_16MHz},
+    {500000, Mcp2515::kBitrate500k_16MHz},  {250000, Mcp2515::kBitrate250k_16MHz},
+    {125000, Mcp2515::kBitrate125k_16MHz},  {100000, Mcp2515::kBitrate100k_16MHz},
+    {50000, Mcp2515::kBitrate50k_16MHz},    {20000, Mcp2515::kBitrate20k_16MHz},
+    {10000, Mcp2515::kBitrate10k_16MHz},
+  };
+  for (const auto& e : tables) {
+    const uint32_t brp = (e.t.cnf1 & 0x3F) + 1;
+    const uint32_t prseg = (e.t.cnf2 & 0x07) + 1;
+    const uint32_t phseg1 = ((e.t.cnf2 >> 3) & 0x07) + 1;
+    const uint32_t phseg2 = (e.t.cnf3 & 0x07) + 1;
+    const uint32_t tq = 1 + prseg + phseg1 + phseg2;
+    // TQ = 2 * BRP / 16 MHz
+    TEST_ASSERT_EQUAL_UINT32(e.bitrate, 8000000 / (brp * tq));
+    TEST_ASSERT_EQUAL_UINT32(0, 8000000 % (brp * tq));
+    // Datasheet 5.3: PHSEG2 >= 2, PRSEG + PHSEG1 >= PHSEG2
+    TEST_ASSERT_GREATER_OR_EQUAL(2, phseg2);
+    TEST_ASSERT_GREATER_OR_EQUAL(phseg2, prseg + phseg1);
+    TEST_ASSERT_TRUE(e.t.cnf2 & 0x80);  // PHSEG2 from CNF3
+  }
+}
+
+static void test_send_round_trips_standard_and_extended_frames() {
+  TEST_ASSERT_TRUE(can->begin(1000000));
+  for (uint8_t dlc = 0; dlc <= 8; dlc++) {
+    const CanFrame frames[2] = {makeFrame(0x123 + dlc, dlc), makeFrame(0x1ABCDE0 + dlc, dlc, true)};
+    for (const CanFrame& f : frames) {
+      TEST_ASSERT_TRUE(can->send(f));
+      CanFrame out;
+      TEST_ASSERT_TRUE(chip->transmit(&out));
+      assertFrame(f, out);
+      TEST_ASSERT_TRUE(can->waitTxDone());
+    }
+  }
+}
+
+static void test_send_batch_is_one_transaction_per_frame() {
+  TEST_ASSERT_TRUE(can->begin(1000000));
+  const CanFrame frames[3] = {makeFrame(0x501, 8), makeFrame(0x502, 8), makeFrame(0x503, 8)};
+  can->resetStats();
+  const uint32_t before = chip->spiBytes();
+  TEST_ASSERT_TRUE(can->sendBatch(frames, 3));
+  // READ STATUS, three LOAD TX BUFFER (1 + 13 bytes) and one RTS
+  TEST_ASSERT_EQUAL_UINT32(5, can->spiTransactions());
+  TEST_ASSERT_EQUAL_UINT32(2 + 3 * 14 + 1, can->spiBytes());
+  TEST_ASSERT_EQUAL_UINT32(can->spiBytes(), chip->spiBytes() - before);
+  TEST_ASSERT_EQUAL_UINT8(3, chip->txPending());
+}
+
+static void test_send_batch_leaves_in_array_order() {
+  TEST_ASSERT_TRUE(can->begin(1000000));
+  const CanFrame frames[3] = {makeFrame(0x503, 8), makeFrame(0x501, 4), makeFrame(0x502, 2)};
+  TEST_ASSERT_TRUE(can->sendBatch(frames, 3));
+  for (const CanFrame& f : frames) {
+    CanFrame out;
+    TEST_ASSERT_TRUE(chip->transmit(&out));
+    assertFrame(f, out);
+  }
+  TEST_ASSERT_FALSE(chip->transmit(nullptr));
+}
+
+static void test_batches_leave_in_call_order() {
+  // IMU groups and their 0x504 stamps queued faster than the bus takes
+  // them: no frame may overtake an earlier one when a buffer frees up
+  TEST_ASSERT_TRUE(can->begin(1000000));
+  const CanFrame group[3] = {makeFrame(0x501, 8), makeFrame(0x502, 8), makeFrame(0x503, 8)};
+  const CanFrame stamp = makeFrame(0x504, 5);
+  for (int round = 0; round < 4; round++) {
+    TEST_ASSERT_TRUE(can->sendBatch(group, 3));
+    TEST_ASSERT_TRUE(can->send(stamp));
+  }
+  std::vector<CanFrame> sent;
+  CanFrame out;
+  for (int guard = 0; guard < 100 && sent.size() < 16; guard++) {
+    if (chip->transmit(&out)) sent.push_back(out);
+    can->pollTx();
+  }
+  TEST_ASSERT_EQUAL(16, sent.size());
+  for (size_t i = 0; i < sent.size(); i++) {
+    TEST_ASSERT_EQUAL_HEX32(0x501 + i % 4, sent[i].id);
+  }
+  assertFrame(stamp, sent.back());
+  TEST_ASSERT_EQUAL(0, can->txQueued());
+}
+
+static void test_send_does_not_wait_for_busy_buffers() {
+  TEST_ASSERT_TRUE(can->begin(1000000));
+  // TXB0 busy: the next frames go into the lower-priority TXB1/TXB2
+  // right away, the fourth waits in the queue
+  for (uint32_t id = 0x100; id <= 0x400; id += 0x100) {
+    can->resetStats();
+    TEST_ASSERT_TRUE(can->send(makeFrame(id, 1)));
+    TEST_ASSERT_TRUE(can->spiTransactions() <= 3);  // READ STATUS, LOAD TX, RTS
+  }
+  TEST_ASSERT_EQUAL_UINT8(3, chip->txPending());
+  TEST_ASSERT_EQUAL(1, can->txQueued());
+
+  // TXB0 leaves; TXB1/TXB2 still pending, so TXB0 must stay empty
+  CanFrame out;
+  uint8_t buffer;
+  TEST_ASSERT_TRUE(chip->transmit(&out, &buffer));
+  TEST_ASSERT_EQUAL_HEX32(0x100, out.id);
+  can->pollTx();
+  TEST_ASSERT_EQUAL(1, can->txQueued());
+  TEST_ASSERT_TRUE(chip->transmit(&out));
+  TEST_ASSERT_EQUAL_HEX32(0x200, out.id);
+  TEST_ASSERT_TRUE(chip->transmit(&out));
+  TEST_ASSERT_EQUAL_HEX32(0x300, out.id);
+  can->pollTx();
+  TEST_ASSERT_EQUAL(0, can->txQueued());
+  TEST_ASSERT_TRUE(chip->transmit(&out, &buffer));
+  TEST_ASSERT_EQUAL_HEX32(0x400, out.id);
+  TEST_ASSERT_EQUAL_UINT8(0, buffer);
+}
+
+static void test_wait_tx_done_drains_the_queue() {
+  TEST_ASSERT_TRUE(can->begin(1000000));
+  const CanFrame f = makeFrame(0x100, 1);
+  TEST_ASSERT_TRUE(can->send(f));
+  // Nothing drains TXB0: the wait gives up, the frame stays loaded
+  TEST_ASSERT_FALSE(can->waitTxDone());
+  TEST_ASSERT_EQUAL_UINT8(1, chip->txPending());
+
+  // With the bus moving, the wait feeds the queue until all has left
+  chip->auto_tx = 3;
+  for (uint32_t i = 0; i < 10; i++) TEST_ASSERT_TRUE(can->send(makeFrame(0x200 + i, 2)));
+  TEST_ASSERT_TRUE(can->waitTxDone());
+  TEST_ASSERT_EQUAL_UINT8(0, chip->txPending());
+  TEST_ASSERT_EQUAL(0, can->txQueued());
+  const std::vector<CanFrame>& sent = chip->sent();
+  TEST_ASSERT_EQUAL(11, sent.size());
+  assertFrame(f, sent[0]);
+  for (size_t i = 1; i < sent.size(); i++) TEST_ASSERT_EQUAL_HEX32(0x200 + i - 1, sent[i].id);
+}
+
+static void test_send_batch_is_refused_whole_when_the_queue_is_full() {
+  TEST_ASSERT_TRUE(can->begin(1000000));
+  CanFrame frames[4];
+  for (int i = 0; i < 4; i++) frames[i] = makeFrame(0x300 + i, 8);
+  // Three go straight into the buffers, the rest fills the queue
+  for (size_t i = 0; i < Mcp2515::kTxBuffers + Mcp2515::kTxQueue - 2; i++) {
+    TEST_ASSERT_TRUE(can->send(frames[0]));
+  }
+  TEST_ASSERT_EQUAL(Mcp2515::kTxQueue - 2, can->txQueued());
+  TEST_ASSERT_FALSE(can->sendBatch(frames, 3));
+  TEST_ASSERT_EQUAL(Mcp2515::kTxQueue - 2, can->txQueued());
+  TEST_ASSERT_TRUE(can->sendBatch(frames, 2));
+  TEST_ASSERT_TRUE(can->sendBatch(frames, 0));
+  // begin() resets the controller and drops what was queued for it
+  TEST_ASSERT_TRUE(can->begin(1000000));
+  TEST_ASSERT_EQUAL(0, can->txQueued());
+  TEST_ASSERT_EQUAL_UINT8(0, chip->txPending());
+}
+
+static void test_receive_reads_rxb0_then_rxb1_and_clears_flags() {
+  TEST_ASSERT_TRUE(can->begin(1000000));
+  CanFrame out;
+  TEST_ASSERT_FALSE(can->receive(&out));
+
+  const CanFrame a = makeFrame(0x10, 8), b = makeFrame(0x1234567, 3, true), c = makeFrame(0x30, 1);
+  TEST_ASSERT_TRUE(chip->deliver(a));
+  TEST_ASSERT_TRUE(chip->deliver(b));   // rolls over into RXB1
+  TEST_ASSERT_FALSE(chip->deliver(c));  // both buffers full
+  TEST_ASSERT_EQUAL_UINT32(1, chip->overflows());
+
+  TEST_ASSERT_TRUE(can->receive(&out));
+  assertFrame(a, out);
+  TEST_ASSERT_TRUE(can->receive(&out));
+  assertFrame(b, out);
+  TEST_ASSERT_FALSE(can->receive(&out));
+  TEST_ASSERT_EQUAL_HEX8(0x00, chip->reg(Mcp2515::REG_CANINTF) & 0x03);
+}
+
+// Every standard ID through the chip's filters: the requested ones must
+// arrive, and exactly `accepted` IDs may pass in total
+static void checkFilterCover(const uint32_t* ids, uint8_t count) {
+  TEST_ASSERT_TRUE(can->setAcceptanceIds(ids, count));
+  TEST_ASSERT_EQUAL_HEX8(Mcp2515::MODE_NORMAL, chip->mode());
+  const CanFilterConfig& cfg = can->acceptance();
+  TEST_ASSERT_FALSE(cfg.accept_all);
+
+  bool passed[0x800] = {false};
+  uint32_t total = 0;
+  for (uint32_t id = 0; id < 0x800; id++) {
+    // Data bytes must not matter (EID8/EID0 masks stay clear)
+    CanFrame f = makeFrame(id, 8);
+    f.data[0] = (uint8_t)(id * 13);
+    f.data[1] = (uint8_t)~id;
+    if (!chip->deliver(f)) continue;
+    CanFrame out;
+    TEST_ASSERT_TRUE(can->receive(&out));
+    TEST_ASSERT_EQUAL_HEX32(id, out.id);
+    TEST_ASSERT_TRUE(canFilterAccepts(cfg, (uint16_t)id));
+    passed[id] = true;
+    total++;
+  }
+  for (uint8_t i = 0; i < count; i++) TEST_ASSERT_TRUE(passed[ids[i]]);
+  TEST_ASSERT_EQUAL_UINT32(cfg.accepted, total);
+  // Extended frames never match the standard filters
+  TEST_ASSERT_FALSE(chip->deliver(makeFrame(ids[0] << 18, 8, true)));
+}
+
+static void test_filters_exact_for_six_ids() {
+  TEST_ASSERT_TRUE(can->begin(1000000));
+  const uint32_t ids[] = {0x501, 0x502, 0x503, 0x504, 0x100, 0x7FF};
+  checkFilterCover(ids, 6);
+  TEST_ASSERT_EQUAL_UINT16(6, can->acceptance().accepted);
+}
+
+static void test_filters_cover_larger_sets() {
+  TEST_ASSERT_TRUE(can->begin(1000000));
+  const uint32_t ten[] = {0x080, 0x081, 0x0A0, 0x0A1, 0x200, 0x300, 0x301, 0x450, 0x451, 0x6FF};
+  checkFilterCover(ten, 10);
+  uint32_t many[32];
+  for (int i = 0; i < 32; i++) many[i] = (uint32_t)((i * 0x35 + 0x11) & 0x7FF);
+  checkFilterCover(many, 32);
+}
+
+static void test_filters_keep_bit_timing_and_clear_to_accept_all() {
+  TEST_ASSERT_TRUE(can->begin(250000));
+  const uint32_t ids[] = {0x501};
+  checkFilterCover(ids, 1);
+  TEST_ASSERT_EQUAL_HEX8(Mcp2515::kBitrate250k_16MHz.cnf1, chip->reg(0x2A));
+  TEST_ASSERT_TRUE(can->setAcceptanceIds(nullptr, 0));
+  TEST_ASSERT_TRUE(can->acceptance().accept_all);
+  TEST_ASSERT_TRUE(chip->deliver(makeFrame(0x123, 8)));
+}
+
+static void test_filters_refuse_unsupported_lists() {
+  TEST_ASSERT_TRUE(can->begin(1000000));
+  const uint32_t ids[] = {0x501, 0x502};
+  TEST_ASSERT_TRUE(can->setAcceptanceIds(ids, 2));
+  const CanFilterConfig before = can->acceptance();
+
+  const uint32_t extended[] = {0x501, 0x18FF0001};
+  uint32_t many[33];
+  for (uint32_t i = 0; i < 33; i++) many[i] = 0x100 + i;
+  TEST_ASSERT_FALSE(can->setAcceptanceIds(extended, 2));
+  TEST_ASSERT_FALSE(can->setAcceptanceIds(many, 33));
+
+  // Still the old filter, in the driver and in the chip
+  TEST_ASSERT_EQUAL_MEMORY(&before, &can->acceptance(), sizeof(before));
+  TEST_ASSERT_EQUAL_HEX8(Mcp2515::MODE_NORMAL, chip->mode());
+  TEST_ASSERT_TRUE(chip->deliver(makeFrame(0x501, 8)));
+  CanFrame out;
+  TEST_ASSERT_TRUE(can->receive(&out));
+  TEST_ASSERT_FALSE(chip->deliver(makeFrame(0x123, 8)));
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_begin_programs_timing_and_enters_normal_mode);
+  RUN_TEST(test_begin_fails_without_a_chip_answer);
+  RUN_TEST(test_begin_rejects_nonstandard_bitrate_without_reset);
+  RUN_TEST(test_bit_timing_tables_give_their_rates);
+  RUN_TEST(test_send_round_trips_standard_and_extended_frames);
+  RUN_TEST(test_send_batch_is_one_transaction_per_frame);
+  RUN_TEST(test_send_batch_leaves_in_array_order);
+  RUN_TEST(test_batches_leave_in_call_order);
+  RUN_TEST(test_send_does_not_wait_for_busy_buffers);
+  RUN_TEST(test_wait_tx_done_drains_the_queue);
+  RUN_TEST(test_send_batch_is_refused_whole_when_the_queue_is_full);
+  RUN_TEST(test_receive_reads_rxb0_then_rxb1_and_clears_flags);
+  RUN_TEST(test_filters_exact_for_six_ids);
+  RUN_TEST(test_filters_cover_larger_sets);
+  RUN_TEST(test_filters_keep_bit_timing_and_clear_to_accept_all);
+  RUN_TEST(test_filters_refuse_unsupported_lists);
+  return UNITY_END();
+}
@@ -0,0 +1,190 @@
+// Slcan against the Mcp2515 driver and register model, driven the way
+// slcand does it: S8 / O, frames both ways, C. The gateway's acceptance
+// list and bit rate must survive the session, including one that ends
+// with the port closing instead of C.
+#include <unity.h>
+#include <string.h>
+#include <string>
+#include "can_rx_filter.h"
+#include "mcp2515.h"
+#include "mcp2515_model.h"
+#include "slcan.h"
+
+static const uint32_t kGatewayIds[] = {0x100, 0x200};
+
+static Mcp2515Model* chip;
+static Mcp2515* can;
+static CanRxFilter* filter;
+static Slcan* slcan;
+
+void setUp() {
+  chip = new Mcp2515Model();
+  can = new Mcp2515(*chip);
+  filter = new CanRxFilter(*can);
+  slcan = new Slcan(*can, *filter, 1000000);
+  TEST_ASSERT_TRUE(can->begin(1000000));
+  TEST_ASSERT_TRUE(filter->setIds(kGatewayIds, 2));
+}
+
+void tearDown() {
+  delete slcan;
+  delete filter;
+  delete can;
+  delete chip;
+}
+
+// Send one command line and return everything the adapter answered
+static std::string command(const char* text) {
+  std::string line = std::string(text) + "\r";
+  slcan->feed((const uint8_t*)line.data(), line.size());
+  std::string out((const char*)slcan->output(), slcan->outputLength());
+  slcan->consume(out.size());
+  return out;
+}
+
+// What the gateway loop does: move received frames to the adapter
+static std::string pump(uint32_t timestamp_ms = 0) {
+  CanFrame f;
+  while (can->receive(&f)) slcan->onReceive(f, timestamp_ms);
+  std::string out((const char*)slcan->output(), slcan->outputLength());
+  slcan->consume(out.size());
+  return out;
+}
+
+static CanFrame makeFrame(uint32_t id, uint8_t dlc) {
+  CanFrame f = {id, dlc, false, {0}};
+  for (uint8_t i = 0; i < dlc; i++) f.data[i] = (uint8_t)(0x10 + i);
+  return f;
+}
+
+static void test_session_sees_all_frames_and_restores_gateway_list() {
+  // Before the session only the gateway's IDs get through
+  TEST_ASSERT_FALSE(chip->deliver(makeFrame(0x321, 2)));
+
+  TEST_ASSERT_EQUAL_STRING("\r", command("S8").c_str());
+  TEST_ASSERT_EQUAL_STRING("\r", command("O").c_str());
+  TEST_ASSERT_TRUE(filter->isOpen());
+  // No reset: the bus was already at 1 Mbit/s
+  TEST_ASSERT_EQUAL_UINT32(1, chip->resets());
+
+  TEST_ASSERT_TRUE(chip->deliver(makeFrame(0x321, 2)));
+  TEST_ASSERT_EQUAL_STRING("t32121011\r", pump().c_str());
+
+  // Host -> bus
+  TEST_ASSERT_EQUAL_STRING("z\r", command("t12330102AA").c_str());
+  CanFrame out;
+  TEST_ASSERT_TRUE(chip->transmit(&out));
+  TEST_ASSERT_EQUAL_HEX32(0x123, out.id);
+  TEST_ASSERT_EQUAL_UINT8(3, out.dlc);
+  TEST_ASSERT_EQUAL_HEX8(0xAA, out.data[2]);
+
+  // The gateway cannot narrow the filter under the host
+  TEST_ASSERT_FALSE(filter->setIds(kGatewayIds, 1));
+
+  TEST_ASSERT_EQUAL_STRING("\r", command("C").c_str());
+  TEST_ASSERT_FALSE(filter->isOpen());
+  TEST_ASSERT_FALSE(chip->deliver(makeFrame(0x321, 2)));
+  TEST_ASSERT_TRUE(chip->deliver(makeFrame(0x200, 2)));
+  TEST_ASSERT_EQUAL_UINT8(2, filter->count());
+
+  // A closed adapter forwards nothing and refuses frames
+  TEST_ASSERT_EQUAL_STRING("", pump().c_str());
+  TEST_ASSERT_EQUAL_STRING("\a", command("t1230").c_str());
+}
+
+static void test_other_bitrate_is_refused() {
+  // The controller is shared with the gateway at 1 Mbit/s
+  TEST_ASSERT_EQUAL_STRING("\a", command("S6").c_str());
+  TEST_ASSERT_EQUAL_UINT32(1000000, slcan->bitrate());
+  TEST_ASSERT_EQUAL_STRING("\r", command("O").c_str());
+  TEST_ASSERT_EQUAL_UINT32(1, chip->resets());
+  TEST_ASSERT_EQUAL_HEX8(Mcp2515::kBitrate1M_16MHz.cnf2, chip->reg(0x29));
+  TEST_ASSERT_EQUAL_STRING("\r", command("C").c_str());
+  TEST_ASSERT_FALSE(chip->deliver(makeFrame(0x321, 0)));
+  TEST_ASSERT_TRUE(chip->deliver(makeFrame(0x100, 0)));
+}
+
+static void test_listen_only_refuses_frames() {
+  TEST_ASSERT_EQUAL_STRING("\r", command("L").c_str());
+  TEST_ASSERT_TRUE(slcan->listenOnly());
+  TEST_ASSERT_EQUAL_STRING("\a", command("t12330102AA").c_str());
+  TEST_ASSERT_EQUAL_STRING("\a", command("T1ABCDEF01FF").c_str());
+  TEST_ASSERT_FALSE(chip->transmit(nullptr));
+  // Receiving still works
+  TEST_ASSERT_TRUE(chip->deliver(makeFrame(0x321, 1)));
+  TEST_ASSERT_EQUAL_STRING("t321110\r", pump().c_str());
+  TEST_ASSERT_EQUAL_STRING("\r", command("C").c_str());
+
+  // A normal open afterwards transmits again
+  TEST_ASSERT_EQUAL_STRING("\r", command("O").c_str());
+  TEST_ASSERT_FALSE(slcan->listenOnly());
+  TEST_ASSERT_EQUAL_STRING("z\r", command("t1230").c_str());
+  TEST_ASSERT_EQUAL_STRING("\r", command("C").c_str());
+}
+
+static void test_disconnect_restores_gateway_list() {
+  TEST_ASSERT_EQUAL_STRING("\r", command("O").c_str());
+  TEST_ASSERT_TRUE(filter->isOpen());
+  TEST_ASSERT_TRUE(chip->deliver(makeFrame(0x321, 1)));
+  CanFrame f;
+  while (can->receive(&f)) slcan->onReceive(f, 0);
+  // Half a command and unread output when the port goes away
+  slcan->feed((const uint8_t*)"t12", 3);
+
+  slcan->onDisconnect();
+  TEST_ASSERT_FALSE(slcan->isOpen());
+  TEST_ASSERT_FALSE(filter->isOpen());
+  TEST_ASSERT_EQUAL(0, slcan->outputLength());
+  TEST_ASSERT_FALSE(chip->deliver(makeFrame(0x321, 0)));
+  TEST_ASSERT_TRUE(chip->deliver(makeFrame(0x200, 0)));
+  TEST_ASSERT_TRUE(filter->setIds(kGatewayIds, 1));
+
+  // The next session starts clean
+  TEST_ASSERT_EQUAL_STRING("V1013\r", command("V").c_str());
+}
+
+static void test_commands_and_errors() {
+  TEST_ASSERT_EQUAL_STRING("V1013\r", command("V").c_str());
+  TEST_ASSERT_EQUAL_STRING("NPICO\r", command("N").c_str());
+  TEST_ASSERT_EQUAL_STRING("\a", command("S9").c_str());
+  TEST_ASSERT_EQUAL_STRING("\r", command("Z1").c_str());
+  TEST_ASSERT_EQUAL_STRING("\r", command("O").c_str());
+  TEST_ASSERT_EQUAL_STRING("\a", command("O").c_str());
+  TEST_ASSERT_EQUAL_STRING("\a", command("S4").c_str());  // no bitrate change while open
+  TEST_ASSERT_EQUAL_STRING("\a", command("t12").c_str());
+  TEST_ASSERT_EQUAL_STRING("\a", command("t8000").c_str());  // ID above 0x7FF
+
+  // Timestamps wrap at 60 s
+  TEST_ASSERT_TRUE(chip->deliver(makeFrame(0x100, 1)));
+  TEST_ASSERT_EQUAL_STRING("t10011004D2\r", pump(61234).c_str());
+  TEST_ASSERT_EQUAL_STRING("\r", command("C").c_str());
+}
+
+static void test_frame_text_round_trip() {
+  char text[Slcan::kMaxFrameText];
+  for (uint8_t dlc = 0; dlc <= 8; dlc++) {
+    for (bool ext : {false, true}) {
+      CanFrame f = makeFrame(ext ? 0x1ABCDEF0 : 0x7FF, dlc);
+      f.extended = ext;
+      const size_t n = Slcan::encodeFrame(f, false, 0, text);
+      TEST_ASSERT_EQUAL('\r', text[n - 1]);
+      CanFrame out;
+      TEST_ASSERT_TRUE(Slcan::decodeFrame(text, n - 1, &out));
+      TEST_ASSERT_EQUAL_HEX32(f.id, out.id);
+      TEST_ASSERT_EQUAL(ext, out.extended);
+      TEST_ASSERT_EQUAL_UINT8(dlc, out.dlc);
+      TEST_ASSERT_EQUAL_MEMORY(f.data, out.data, dlc);
+    }
+  }
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_session_sees_all_frames_and_restores_gateway_list);
+  RUN_TEST(test_other_bitrate_is_refused);
+  RUN_TEST(test_listen_only_refuses_frames);
+  RUN_TEST(test_disconnect_restores_gateway_list);
+  RUN_TEST(test_commands_and_errors);
+  RUN_TEST(test_frame_text_round_trip);
+  return UNITY_END();
+}
@@ -0,0 +1,128 @@
+// usbFrameDecode: frames split out of a stream of text and raw bytes,
+// cut at every read boundary, and resynchronisation after a stray sync
+// byte or a damaged frame.
+#include <unity.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "usb_frame.h"
+
+void setUp() {}
+void tearDown() {}
+
+struct Decoded {
+  std::string text;                 // bytes outside frames
+  std::vector<std::vector<uint8_t>> frames;  // payloads with a good CRC
+  int bad_crc = 0;
+};
+
+static void handle(UsbFrameDecoder* d, uint8_t b, Decoded* out) {
+  const UsbFrameEvent ev = usbFrameDecode(d, b);
+  if (ev == USB_DEC_BYTE) out->text += (char)b;
+  if (ev == USB_DEC_BAD_CRC) out->bad_crc++;
+  if (ev == USB_DEC_FRAME) out->frames.emplace_back(d->frame + 3, d->frame + 3 + d->frame[2]);
+}
+
+static Decoded decode(const std::vector<uint8_t>& stream) {
+  Decoded out;
+  UsbFrameDecoder d;
+  usbFrameDecoderInit(&d);
+  for (uint8_t b : stream) {
+    handle(&d, b, &out);
+    uint8_t r;
+    while (usbFrameReplay(&d, &r)) handle(&d, r, &out);
+  }
+  return out;
+}
+
+static void append(std::vector<uint8_t>* s, const char* text) {
+  s->insert(s->end(), text, text + strlen(text));
+}
+
+static void appendFrame(std::vector<uint8_t>* s, uint8_t len, uint8_t fill) {
+  uint8_t payload[USB_FRAME_MAX_PAYLOAD];
+  uint8_t out[USB_FRAME_MAX_PAYLOAD + USB_FRAME_OVERHEAD];
+  for (uint8_t i = 0; i < len; i++) payload[i] = (uint8_t)(fill + i);
+  const size_t n = usbFrameEncode(USB_FRAME_CAN_RX, payload, len, out);
+  s->insert(s->end(), out, out + n);
+}
+
+static void test_frames_and_text_are_split() {
+  std::vector<uint8_t> s;
+  append(&s, "PONG,1,2,3\n");
+  appendFrame(&s, 18, 0x10);
+  append(&s, "ACK\n");
+  appendFrame(&s, 0, 0);
+  appendFrame(&s, 255, 0xA5);
+  const Decoded d = decode(s);
+  TEST_ASSERT_EQUAL(0, d.bad_crc);
+  TEST_ASSERT_TRUE(d.text == "PONG,1,2,3\nACK\n");
+  TEST_ASSERT_EQUAL(3, (int)d.frames.size());
+  TEST_ASSERT_EQUAL(18, (int)d.frames[0].size());
+  TEST_ASSERT_EQUAL_HEX8(0x11, d.frames[0][1]);
+  TEST_ASSERT_EQUAL(0, (int)d.frames[1].size());
+  TEST_ASSERT_EQUAL(255, (int)d.frames[2].size());
+}
+
+static void test_stray_sync_byte_resynchronises() {
+  // A raw UART byte 0xA5 ahead of text: its "length" swallows the text
+  // and the start of the real frame, which must still come out
+  std::vector<uint8_t> s;
+  s.push_back(USB_FRAME_SYNC);
+  append(&s, "\x01\x08OK\n");
+  appendFrame(&s, 17, 0x40);
+  append(&s, "ACK\n");
+  const Decoded d = decode(s);
+  TEST_ASSERT_EQUAL(1, d.bad_crc);
+  TEST_ASSERT_TRUE(d.text == "\x01\x08OK\nACK\n");
+  TEST_ASSERT_EQUAL(1, (int)d.frames.size());
+  TEST_ASSERT_EQUAL(17, (int)d.frames[0].size());
+  TEST_ASSERT_EQUAL_HEX8(0x40, d.frames[0][0]);
+}
+
+static void test_damaged_frame_does_not_take_the_next_one() {
+  // Two frames, the first with a corrupted payload byte and a length
+  // that also reaches into the second
+  std::vector<uint8_t> s;
+  appendFrame(&s, 4, 0x20);
+  s[2] = 40;
+  appendFrame(&s, 30, 0x60);
+  appendFrame(&s, 30, 0x70);
+  std::vector<uint8_t> tail;
+  append(&tail, "END\n");
+  s.insert(s.end(), tail.begin(), tail.end());
+  const Decoded d = decode(s);
+  TEST_ASSERT_TRUE(d.bad_crc >= 1);
+  TEST_ASSERT_EQUAL(2, (int)d.frames.size());
+  TEST_ASSERT_EQUAL_HEX8(0x60, d.frames[0][0]);
+  TEST_ASSERT_EQUAL_HEX8(0x70, d.frames[1][0]);
+  TEST_ASSERT_TRUE(d.text.size() >= 4);
+  TEST_ASSERT_TRUE(d.text.compare(d.text.size() - 4, 4, "END\n") == 0);
+}
+
+static void test_nested_false_syncs() {
+  // Several stray sync bytes in a row, each pointing into the next
+  std::vector<uint8_t> s;
+  for (int i = 0; i < 5; i++) {
+    s.push_back(USB_FRAME_SYNC);
+    s.push_back(0x01);
+    s.push_back(3);
+  }
+  appendFrame(&s, 9, 0x01);
+  append(&s, "X\n");
+  const Decoded d = decode(s);
+  TEST_ASSERT_TRUE(d.bad_crc >= 1);
+  TEST_ASSERT_EQUAL(1, (int)d.frames.size());
+  TEST_ASSERT_EQUAL(9, (int)d.frames[0].size());
+  TEST_ASSERT_EQUAL_HEX8(0x09, d.frames[0][8]);
+  TEST_ASSERT_TRUE(d.text.compare(d.text.size() - 2, 2, "X\n") == 0);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_frames_and_text_are_split);
+  RUN_TEST(test_stray_sync_byte_resynchronises);
+  RUN_TEST(test_damaged_frame_does_not_take_the_next_one);
+  RUN_TEST(test_nested_false_syncs);
+  return UNITY_END();
+}
@@ -0,0 +1,26 @@
+#!/bin/sh
+# Build the firmware's USB codec as a standalone WebAssembly module for
+# the web app (docx/public/codec.wasm). Needs the Emscripten SDK on PATH:
+#   . /path/to/emsdk/emsdk_env.sh && ./pico/wasm/build.sh
+# With --optional (what `npm run build` in docx passes) a missing em++
+# is only a warning: the site is built without the module and the app
+# falls back to its TypeScript codec. The Pages workflow builds it
+# without --optional, so the deployed site always has it.
+set -e
+cd "$(dirname "$0")"
+
+if ! command -v em++ >/dev/null 2>&1; then
+  if [ "$1" = "--optional" ]; then
+    echo "build.sh: em++ not found, building without codec.wasm (TypeScript codec)" >&2
+    exit 0
+  fi
+  echo "build.sh: em++ not found, source emsdk_env.sh first" >&2
+  exit 1
+fi
+
+mkdir -p ../../docx/public
+em++ -std=gnu++17 -O3 -flto \
+  -I ../src \
+  codec_wasm.cpp ../src/imu_codec.cpp ../src/usb_frame.cpp \
+  --no-entry -sSTANDALONE_WASM -sINITIAL_MEMORY=1MB -sALLOW_MEMORY_GROWTH=0 \
+  -o ../../docx/public/codec.wasm
@@ -0,0 +1,114 @@
+// The firmware's USB codec built for the web app (see build.sh): sample
+// lines come from imuFormatCsv and the device stream is split by
+// usbFrameDecode, so both sides run the same code as the Pico.
+//
+// No allocation: the module owns fixed buffers that JS reads and writes
+// through views on its memory.
+//
+//   codec_samples()   double[CODEC_BATCH_MAX * CODEC_SAMPLE_STRIDE] in:
+//                     t_us, alpha, beta, gamma, ax, ay, az per sample
+//   codec_encode(n, seq)  CSV lines for n samples into codec_out(),
+//                     numbered from seq; returns the byte count
+//   codec_in()        uint8[CODEC_IN_SIZE] device stream bytes in
+//   codec_feed(n)     splits n bytes into events at codec_events(),
+//                     returns the byte count; each event is
+//                     [kind][type][len][len bytes], kind 0 = text line
+//                     (type 0), kind 1 = frame with a good CRC
+#include <emscripten/emscripten.h>
+#include <string.h>
+#include "imu_codec.h"
+#include "usb_frame.h"
+
+static const uint32_t CODEC_BATCH_MAX = 32;  // SAMPLE_BATCH_MAX in usbProtocol.ts
+static const uint32_t CODEC_SAMPLE_STRIDE = 1 + IMU_CHANNELS;
+static const uint32_t CODEC_IN_SIZE = 512;
+// A text line longer than this is cut
+static const uint32_t CODEC_LINE_MAX = 255;
+// Largest time SampleEncoder writes exactly (2^53)
+static const double CODEC_TIME_LIMIT = 9007199254740992.0;
+
+static double samples[CODEC_BATCH_MAX * CODEC_SAMPLE_STRIDE];
+static char out[CODEC_BATCH_MAX * IMU_CSV_MAX_LINE];
+static uint8_t in[CODEC_IN_SIZE];
+// Worst case is a burst of one-byte lines, each 3 header bytes + 1,
+// including the bytes of a frame from an earlier call that fails its CRC
+// and is decoded again
+static uint8_t events[4 * (CODEC_IN_SIZE + USB_FRAME_MAX_PAYLOAD) + CODEC_LINE_MAX +
+                      USB_FRAME_MAX_PAYLOAD];
+
+static UsbFrameDecoder decoder;
+static uint8_t line[CODEC_LINE_MAX];
+static uint32_t line_len;
+static uint32_t crc_errors;
+
+// One byte of the device stream into events at events + *len
+static void decodeByte(uint8_t b, uint32_t* len) {
+  const UsbFrameEvent ev = usbFrameDecode(&decoder, b);
+  if (ev == USB_DEC_BAD_CRC) crc_errors++;
+  if (ev == USB_DEC_FRAME) {
+    const uint8_t flen = decoder.frame[2];
+    events[(*len)++] = 1;
+    events[(*len)++] = decoder.frame[1];
+    events[(*len)++] = flen;
+    memcpy(events + *len, decoder.frame + 3, flen);
+    *len += flen;
+  }
+  if (ev != USB_DEC_BYTE) return;
+
+  if (b == '\n') {
+    if (line_len) {
+      events[(*len)++] = 0;
+      events[(*len)++] = 0;
+      events[(*len)++] = (uint8_t)line_len;
+      memcpy(events + *len, line, line_len);
+      *len += line_len;
+      line_len = 0;
+    }
+  } else if (b != '\r' && b < 0x80 && line_len < CODEC_LINE_MAX) {
+    line[line_len++] = b;
+  }
+}
+
+extern "C" {
+
+EMSCRIPTEN_KEEPALIVE double* codec_samples() { return samples; }
+EMSCRIPTEN_KEEPALIVE char* codec_out() { return out; }
+EMSCRIPTEN_KEEPALIVE uint8_t* codec_in() { return in; }
+EMSCRIPTEN_KEEPALIVE uint8_t* codec_events() { return events; }
+EMSCRIPTEN_KEEPALIVE uint32_t codec_crc_errors() { return crc_errors; }
+
+EMSCRIPTEN_KEEPALIVE uint32_t codec_encode(uint32_t count, uint32_t seq) {
+  if (count > CODEC_BATCH_MAX) count = CODEC_BATCH_MAX;
+  size_t len = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    const double* s = samples + i * CODEC_SAMPLE_STRIDE;
+    // Rounded half up like SampleEncoder's Math.round; times outside
+    // [0, 2^53) read 0 there too
+    uint64_t t = 0;
+    if (s[0] > 0 && s[0] < CODEC_TIME_LIMIT) {
+      t = (uint64_t)s[0];
+      if (s[0] - (double)t >= 0.5) t++;
+    }
+    len += imuFormatCsv(s + 1, t, seq + i, out + len, sizeof(out) - len);
+  }
+  return (uint32_t)len;
+}
+
+EMSCRIPTEN_KEEPALIVE void codec_reset() {
+  usbFrameDecoderInit(&decoder);
+  line_len = 0;
+  crc_errors = 0;
+}
+
+EMSCRIPTEN_KEEPALIVE uint32_t codec_feed(uint32_t n) {
+  if (n > CODEC_IN_SIZE) n = CODEC_IN_SIZE;
+  uint32_t len = 0;
+  for (uint32_t i = 0; i < n; i++) {
+    decodeByte(in[i], &len);
+    uint8_t r;
+    while (usbFrameReplay(&decoder, &r)) decodeByte(r, &len);
+  }
+  return len;
+}
+
+}  // extern "C"